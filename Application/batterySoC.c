@@ -0,0 +1,167 @@
+/******************************************************************************
+
+ @file  batterySoC.c
+
+ @brief This file contains the coulomb counting state of charge estimator.
+        It is updated once per analytics sample from the analytics task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include "batterySoC.h"
+#include "fixedPoint.h"
+#include "configStore.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+// Remaining charge to 0.01 %, a multiply and shift instead of a division per sample
+#define BATTERY_SOC_RATIO_Q32           FIXEDPOINT_Q32(10000.0 / BATTERY_SOC_FULL_CHARGE)
+
+// The charge must fit int32_t with room for one sample of any current above full
+typedef char batterySoC_chargeRangeCheck[(BATTERY_SOC_FULL_CHARGE < INT32_MAX - 32768) ? 1 : -1];
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int32_t  charge = BATTERY_SOC_FULL_CHARGE;                   // remaining charge in mA x sampling periods
+static uint16_t soc = 10000;                                        // state of charge in 0.01 %
+static uint16_t savedSoc = 10000;                                   // state of charge last saved to the config store
+
+/**********************************************************************
+ *  Local functions
+ */
+static uint8_t batterySoC_load(void);
+static void batterySoC_save(void);
+
+/*********************************************************************
+ * @fn      batterySoC_init
+ *
+ * @brief   Restore the state of charge saved at the last power off.  The voltage based level is used
+ *          instead if none has been saved, or if the battery is at rest and its level is more than
+ *          BATTERY_SOC_RESYNC away from the saved value (charged or swapped while off).
+ *
+ * @param   voltageLevel - voltage based battery level in %
+ *          batteryCurrent_mA - battery current in mA
+ *
+ * @return  none
+ */
+void batterySoC_init( int16_t voltageLevel, int16_t batteryCurrent_mA )
+{
+    int32_t voltageCharge;
+    if (voltageLevel < 0)
+    {
+        voltageLevel = 0;
+    }
+    voltageCharge = (int32_t) voltageLevel * BATTERY_SOC_CHARGE_PER_PERCENT;
+    if (batterySoC_load())
+    {
+        int32_t gap = (int32_t) soc - (int32_t) voltageLevel * 100;
+        if (((gap > BATTERY_SOC_RESYNC) || (gap < -BATTERY_SOC_RESYNC)) &&
+            (batteryCurrent_mA <= BATTERY_SOC_REST_CURRENT_MA) && (batteryCurrent_mA >= -BATTERY_SOC_REST_CURRENT_MA))
+        {
+            charge = voltageCharge;
+        }
+    }
+    else
+    {
+        charge = voltageCharge;
+    }
+    soc = (uint16_t) fixedPoint_mulRecipRound(charge, BATTERY_SOC_RATIO_Q32);
+    savedSoc = soc;
+}
+/*********************************************************************
+ * @fn      batterySoC_update
+ *
+ * @brief   Count the charge drawn in one sampling period and, at rest, correct it towards the voltage
+ *          based level.  The state of charge is saved each time it moves by BATTERY_SOC_SAVE_STEP.
+ *
+ * @param   batteryCurrent_mA - battery current in mA, negative when charging (regen braking)
+ *          voltageLevel - voltage based battery level in %, compensated for the voltage drop under load
+ *
+ * @return  none
+ */
+void batterySoC_update( int16_t batteryCurrent_mA, int16_t voltageLevel )
+{
+    charge -= batteryCurrent_mA;
+    if ((batteryCurrent_mA <= BATTERY_SOC_REST_CURRENT_MA) && (batteryCurrent_mA >= -BATTERY_SOC_REST_CURRENT_MA))
+    {
+        if (voltageLevel < 0)
+        {
+            voltageLevel = 0;
+        }
+        charge += ((int32_t) voltageLevel * BATTERY_SOC_CHARGE_PER_PERCENT - charge) >> BATTERY_SOC_BLEND_SHIFT;
+    }
+    if (charge < 0)
+    {
+        charge = 0;
+    }
+    else if (charge > BATTERY_SOC_FULL_CHARGE)
+    {
+        charge = BATTERY_SOC_FULL_CHARGE;
+    }
+    soc = (uint16_t) fixedPoint_mulRecipRound(charge, BATTERY_SOC_RATIO_Q32);
+    if ((soc + BATTERY_SOC_SAVE_STEP <= savedSoc) || (soc >= savedSoc + BATTERY_SOC_SAVE_STEP))
+    {
+        batterySoC_save();
+    }
+}
+/*********************************************************************
+ * @fn      batterySoC_get
+ *
+ * @brief   State of charge
+ *
+ * @param   none
+ *
+ * @return  state of charge in 0.01 %, 0 to 10000
+ */
+uint16_t batterySoC_get( void )
+{
+    return soc;
+}
+/*********************************************************************
+ * @fn      batterySoC_getPercent
+ *
+ * @brief   State of charge rounded to a whole percent
+ *
+ * @param   none
+ *
+ * @return  state of charge in %, 0 to 100
+ */
+uint8_t batterySoC_getPercent( void )
+{
+    return (uint8_t) ((soc + 50) / 100);
+}
+/*********************************************************************
+ * @fn      batterySoC_load
+ *
+ * @brief   Load the state of charge from the config store
+ *
+ * @param   none
+ *
+ * @return  1 if a saved state of charge was loaded, 0 if none has been saved or it is out of range
+ */
+static uint8_t batterySoC_load(void)
+{
+    uint32_t saved = configStore_get(CONFIG_STORE_KEY_BATTERY_SOC);
+    if (saved > 10000)
+    {
+        return 0;
+    }
+    soc = (uint16_t) saved;
+    charge = (int32_t) (((int64_t) soc * BATTERY_SOC_FULL_CHARGE + 5000) / 10000);
+    return 1;
+}
+/*********************************************************************
+ * @fn      batterySoC_save
+ *
+ * @brief   Save the current state of charge.  The config store defers the flash write.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void batterySoC_save(void)
+{
+    savedSoc = soc;
+    configStore_set(CONFIG_STORE_KEY_BATTERY_SOC, soc);
+}
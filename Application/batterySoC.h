@@ -0,0 +1,61 @@
+/**********************************************************************************************
+ * batterySoC.h
+ *
+ * Description:    Battery state of charge by coulomb counting, corrected towards the voltage
+ *                 based level while the battery is near rest.
+ *
+ *                 Each analytics sample subtracts the battery current from the remaining charge
+ *                 (one add, no division).  When |current| <= BATTERY_SOC_REST_CURRENT_MA the
+ *                 voltage based level is trusted and the charge moves 1 / 2^BATTERY_SOC_BLEND_SHIFT
+ *                 of the way towards it - a first order complementary filter.  Under load only the
+ *                 current is used, so the level no longer follows the voltage sag.
+ *
+ *                 The state of charge is saved to the config store every BATTERY_SOC_SAVE_STEP and
+ *                 restored at power on.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_BATTERYSOC_H_
+#define APPLICATION_BATTERYSOC_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include "periodicCommunication.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define BATTERY_SOC_CAPACITY_MAH        9600            // Cest Power 37V 9.6Ah battery pack
+#define BATTERY_SOC_REST_CURRENT_MA     500             // voltage based level is blended in at or below this current
+#define BATTERY_SOC_BLEND_SHIFT         7               // gain 1/128 per rest sample: time constant 128 x 300 ms = 38 s
+#define BATTERY_SOC_RESYNC              2000            // 20.00 % - at power on a larger gap to the rest voltage level restarts from voltage
+#define BATTERY_SOC_SAVE_STEP           100             // 1.00 % - change of state of charge between saves
+#define BATTERY_SOC_NONE                0xFFFF          // config store value before a state of charge has been saved
+
+// Charge is counted in mA x PERIODIC_COMMUNICATION_HF_SAMPLING_TIME so each sample adds the current as is
+#define BATTERY_SOC_FULL_CHARGE         ((int32_t) ((uint64_t) BATTERY_SOC_CAPACITY_MAH * 3600000 / PERIODIC_COMMUNICATION_HF_SAMPLING_TIME))
+#define BATTERY_SOC_CHARGE_PER_PERCENT  (BATTERY_SOC_FULL_CHARGE / 100)
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void batterySoC_init( int16_t voltageLevel, int16_t batteryCurrent_mA );
+extern void batterySoC_update( int16_t batteryCurrent_mA, int16_t voltageLevel );
+extern uint16_t batterySoC_get( void );
+extern uint8_t batterySoC_getPercent( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_BATTERYSOC_H_ */
@@ -0,0 +1,664 @@
+/******************************************************************************
+
+ @file  blackBox.c
+
+ @brief This file contains the crash and fault black box.  Records are staged
+        from any context; the analytics task programs them into the black box
+        flash ring, a fatal path programs them itself.  The report is read
+        from flash by the BLE application task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <xdc/std.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include "blackBox.h"
+#include "nvsJob.h"
+#include "Controller.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define BLACK_BOX_STAGING_MASK          (BLACK_BOX_STAGING_RECORDS - 1)
+#define BLACK_BOX_SECTOR_RECORDS        (BLACK_BOX_SLOTS - 1)                               // records per sector, after the header
+#define BLACK_BOX_RING_RECORDS          (BLACK_BOX_SECTORS * BLACK_BOX_SECTOR_RECORDS)
+
+// Records are programmed and reported as they are laid out in RAM, and the Controller characteristic holds the report
+typedef char blackBox_recordSizeCheck[(sizeof(blackBox_record_t) == BLACK_BOX_RECORD_SIZE) ? 1 : -1];
+typedef char blackBox_headerSizeCheck[(sizeof(blackBox_report_t) == BLACK_BOX_REPORT_HEADER) ? 1 : -1];
+typedef char blackBox_charLenCheck[(CONTROLLER_BLACK_BOX_LEN == BLACK_BOX_REPORT_LEN) ? 1 : -1];
+typedef char blackBox_stagingCheck[((BLACK_BOX_STAGING_RECORDS & BLACK_BOX_STAGING_MASK) == 0) ? 1 : -1];
+typedef char blackBox_sectorsCheck[(BLACK_BOX_SECTORS >= 2) ? 1 : -1];
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static blackBox_nvsManager_t *blackBox_nvsManager = NULL;
+static blackBox_record_t staging[BLACK_BOX_STAGING_RECORDS];
+static volatile uint32_t stagedHead = 0;                            // records staged since boot
+static volatile uint32_t stagedTail = 0;                            // records programmed since boot
+static volatile uint16_t dropped = 0;                               // records dropped since boot, staging full
+static uint8_t  mounted = 0;
+static uint8_t  panicked = 0;
+static uint8_t  sector = 0;                                         // sector being written
+static uint16_t slot = 1;                                           // next slot to program in it
+static uint32_t sectorSequence = 0;                                 // sequence number of the sector being written
+static uint8_t  nextErased = 0;                                     // the sector after it is erased ahead
+static uint16_t stored = 0;                                         // records in flash, newest back
+// Latest values, put in every record
+static volatile uint8_t  throttlePercent = 0;
+static volatile int16_t  IQ = 0;
+static volatile uint16_t rpm = 0;
+static volatile uint16_t busVoltage_mV = 0;
+static volatile uint8_t  flags = 0;
+static uint8_t  lastStm32Error = 0;
+static uint8_t  lastStm32Exception = 0;
+static uint8_t  telemetryCount = 0;
+// Report being read
+static uint32_t reportHead = 0;                                     // stagedHead when the read started
+static uint8_t  reportCount = 0;
+static uint16_t reportKept = 0;
+static uint32_t reportTime_ms = 0;
+
+/**********************************************************************
+ *  Local functions
+ */
+static uint32_t blackBox_time( void );
+static uint8_t blackBox_check( const blackBox_record_t *record );
+static void blackBox_stage( uint8_t type, uint8_t code, uint8_t detail );
+static uint8_t blackBox_isBlank( const blackBox_record_t *record );
+static size_t blackBox_slotOffset( uint8_t recordSector, uint16_t recordSlot );
+static void blackBox_format( uint8_t newSector );
+static void blackBox_eraseNext( void );
+static void blackBox_readRecord( uint8_t k, blackBox_record_t *record );
+
+/*********************************************************************
+ * @fn      blackBox_registerNVS
+ *
+ * @brief   Register the NVS functions of the black box area.
+ *          Must be registered before blackBox_init.
+ *
+ * @param   nvsManager - NVS manager
+ *
+ * @return  none
+ */
+void blackBox_registerNVS( blackBox_nvsManager_t *nvsManager )
+{
+    blackBox_nvsManager = nvsManager;
+}
+/*********************************************************************
+ * @fn      blackBox_init
+ *
+ * @brief   Mount the black box ring: find the sector with the highest sequence number, the first
+ *          blank slot in it, and the full sectors before it.  A blank or foreign area is formatted
+ *          (start up only).  Records a boot.  The NVS must be open; without NVS functions (no
+ *          region, or one too small for the layout) the ring is not mounted and nothing is recorded.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void blackBox_init( void )
+{
+    blackBox_record_t record;
+    uint32_t sequence;
+    uint16_t lo;
+    uint16_t hi;
+    uint16_t mid;
+    uint8_t s;
+    uint8_t i;
+    uint8_t found = 0;
+
+    if (blackBox_nvsManager == NULL)
+    {
+        return;
+    }
+    for (s = 0; s < BLACK_BOX_SECTORS; s++)
+    {
+        blackBox_nvsManager->blackBox_NVS_Read(blackBox_slotOffset(s, 0), &record, sizeof(record));
+        if ((record.type == BLACK_BOX_TYPE_SECTOR) && (record.check == blackBox_check(&record)) &&
+            ((found == 0) || (record.time_ms > sectorSequence)))
+        {
+            found = 1;
+            sector = s;
+            sectorSequence = record.time_ms;
+        }
+    }
+    if (found == 0)
+    {
+        blackBox_nvsManager->blackBox_NVS_Erase(blackBox_slotOffset(0, 0));
+        sectorSequence = 0;
+        blackBox_format(0);
+    }
+    else
+    {
+        lo = 1;                                                     // records are programmed in order: the blank slots are at the end
+        hi = BLACK_BOX_SLOTS;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            blackBox_nvsManager->blackBox_NVS_Read(blackBox_slotOffset(sector, mid), &record, sizeof(record));
+            if (blackBox_isBlank(&record) == 1)
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+        slot = lo;
+        stored = slot - 1;
+        sequence = sectorSequence;
+        s = sector;
+        for (i = 1; i < BLACK_BOX_SECTORS; i++)                     // back from the newest, up to the first sector erased ahead or foreign
+        {
+            s = (s + BLACK_BOX_SECTORS - 1) % BLACK_BOX_SECTORS;
+            sequence--;
+            blackBox_nvsManager->blackBox_NVS_Read(blackBox_slotOffset(s, 0), &record, sizeof(record));
+            if ((record.type != BLACK_BOX_TYPE_SECTOR) || (record.check != blackBox_check(&record)) ||
+                (record.time_ms != sequence))
+            {
+                break;
+            }
+            stored += BLACK_BOX_SECTOR_RECORDS;                     // a sector before the newest is full
+        }
+    }
+    nextErased = 0;                                                 // not known - erased again when needed
+    mounted = 1;
+    blackBox_stage(BLACK_BOX_TYPE_BOOT, 0, 0);
+}
+/*********************************************************************
+ * @fn      blackBox_event
+ *
+ * @brief   Record an event with the latest telemetry.  O(1), may be called from any context.
+ *
+ * @param   type - BLACK_BOX_TYPE_xxx
+ *          code - event code
+ *          detail - event detail
+ *
+ * @return  none
+ */
+void blackBox_event( uint8_t type, uint8_t code, uint8_t detail )
+{
+    blackBox_stage(type, code, detail);
+}
+/*********************************************************************
+ * @fn      blackBox_error
+ *
+ * @brief   Record an STM32 error or exception.  The same code again before the next telemetry
+ *          record only sets the flag, so a burst of errors does not fill the staging ring.
+ *          May be called from any context.
+ *
+ * @param   type - BLACK_BOX_TYPE_STM32_ERROR or BLACK_BOX_TYPE_STM32_EXCEPTION
+ *          code - STM32MCP error or exception code
+ *
+ * @return  none
+ */
+void blackBox_error( uint8_t type, uint8_t code )
+{
+    uint8_t flag = (type == BLACK_BOX_TYPE_STM32_ERROR) ? BLACK_BOX_FLAG_STM32_ERROR : BLACK_BOX_FLAG_STM32_EXCEPTION;
+    uint8_t *last = (type == BLACK_BOX_TYPE_STM32_ERROR) ? &lastStm32Error : &lastStm32Exception;
+    uint8_t repeat;
+    UInt key;
+
+    key = Hwi_disable();
+    repeat = ((flags & flag) != 0) && (*last == code);
+    flags |= flag;
+    *last = code;
+    Hwi_restore(key);
+    if (repeat == 0)
+    {
+        blackBox_stage(type, code, 0);
+    }
+}
+/*********************************************************************
+ * @fn      blackBox_setDrive
+ *
+ * @brief   Latest throttle and commanded IQ.  A rider input error is recorded when it starts.
+ *          Called from the brake and throttle callback.
+ *
+ * @param   throttle - throttle position in percent
+ *          commandIQ - commanded IQ, negative = regen
+ *          riderInputError - brake and throttle error message, BRAKE_AND_THROTTLE_NORMAL (0) if none
+ *
+ * @return  none
+ */
+void blackBox_setDrive( uint8_t throttle, int16_t commandIQ, uint8_t riderInputError )
+{
+    uint8_t start;
+    UInt key;
+
+    throttlePercent = throttle;
+    IQ = commandIQ;
+    key = Hwi_disable();
+    start = (riderInputError != 0) && ((flags & BLACK_BOX_FLAG_RIDER_INPUT) == 0);
+    if (riderInputError != 0)
+    {
+        flags |= BLACK_BOX_FLAG_RIDER_INPUT;
+    }
+    else
+    {
+        flags &= ~BLACK_BOX_FLAG_RIDER_INPUT;
+    }
+    Hwi_restore(key);
+    if (start == 1)
+    {
+        blackBox_stage(BLACK_BOX_TYPE_RIDER_INPUT, riderInputError, 0);
+    }
+}
+/*********************************************************************
+ * @fn      blackBox_telemetry
+ *
+ * @brief   Latest motor telemetry, called for every high frequency sample.  Every
+ *          BLACK_BOX_TELEMETRY_DIVIDER samples a telemetry record is staged and the flags that
+ *          count since the previous one are cleared.
+ *
+ * @param   motorRpm - motor speed
+ *          voltage_mV - bus (battery) voltage
+ *
+ * @return  none
+ */
+void blackBox_telemetry( uint16_t motorRpm, uint16_t voltage_mV )
+{
+    UInt key;
+
+    rpm = motorRpm;
+    busVoltage_mV = voltage_mV;
+    telemetryCount++;
+    if (telemetryCount < BLACK_BOX_TELEMETRY_DIVIDER)
+    {
+        return;
+    }
+    telemetryCount = 0;
+    blackBox_stage(BLACK_BOX_TYPE_TELEMETRY, 0, 0);
+    key = Hwi_disable();
+    flags &= ~(BLACK_BOX_FLAG_STM32_ERROR | BLACK_BOX_FLAG_STM32_EXCEPTION | BLACK_BOX_FLAG_DROPPED);
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      blackBox_panic
+ *
+ * @brief   Program the staged records into the erased slots left in the sector being written,
+ *          without erasing and without the NVS driver.  Fatal paths only (assert, RTOS error):
+ *          nothing else is recorded once it has been called.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void blackBox_panic( void )
+{
+    uint32_t count;
+    uint32_t contiguous;
+    UInt key;
+
+    if ((mounted == 0) || (panicked == 1))
+    {
+        return;
+    }
+    panicked = 1;
+    key = Hwi_disable();
+    while ((stagedHead != stagedTail) && (slot < BLACK_BOX_SLOTS))
+    {
+        count = stagedHead - stagedTail;
+        contiguous = BLACK_BOX_STAGING_RECORDS - (stagedTail & BLACK_BOX_STAGING_MASK);
+        count = (count > contiguous) ? contiguous : count;
+        count = (count > (uint32_t) (BLACK_BOX_SLOTS - slot)) ? (uint32_t) (BLACK_BOX_SLOTS - slot) : count;
+        blackBox_nvsManager->blackBox_NVS_PanicProgram(blackBox_slotOffset(sector, slot),
+                                                       &staging[stagedTail & BLACK_BOX_STAGING_MASK],
+                                                       count * sizeof(blackBox_record_t));
+        stagedTail += count;
+        slot += count;
+        stored += count;
+    }
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      blackBox_taskFxn
+ *
+ * @brief   Make at most one flash erase, or program up to BLACK_BOX_PROGRAM_RECORDS staged
+ *          records.  The sector after the one being written is erased ahead, when fewer than
+ *          BLACK_BOX_STAGING_RECORDS slots are left and nothing is waiting (paced by
+ *          nvsJob_claimStep), so the staged records always find erased flash.  Analytics task only.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void blackBox_taskFxn( void )
+{
+    uint32_t count;
+    uint32_t contiguous;
+    UInt key;
+
+    if ((mounted == 0) || (panicked == 1))
+    {
+        return;
+    }
+    if (slot >= BLACK_BOX_SLOTS)
+    {
+        if (stagedHead == stagedTail)
+        {
+            return;                                                 // move on when there is something to write
+        }
+        if (nextErased == 0)
+        {
+            blackBox_eraseNext();
+            return;
+        }
+        blackBox_format((sector + 1) % BLACK_BOX_SECTORS);
+    }
+    count = stagedHead - stagedTail;
+    if (count == 0)
+    {
+        if ((nextErased == 0) && (BLACK_BOX_SLOTS - slot < BLACK_BOX_STAGING_RECORDS) && (nvsJob_claimStep() == 1))
+        {
+            blackBox_eraseNext();
+        }
+        return;
+    }
+    contiguous = BLACK_BOX_STAGING_RECORDS - (stagedTail & BLACK_BOX_STAGING_MASK);
+    count = (count > contiguous) ? contiguous : count;
+    count = (count > BLACK_BOX_PROGRAM_RECORDS) ? BLACK_BOX_PROGRAM_RECORDS : count;
+    count = (count > (uint32_t) (BLACK_BOX_SLOTS - slot)) ? (uint32_t) (BLACK_BOX_SLOTS - slot) : count;
+    blackBox_nvsManager->blackBox_NVS_Program(blackBox_slotOffset(sector, slot),
+                                              &staging[stagedTail & BLACK_BOX_STAGING_MASK],
+                                              count * sizeof(blackBox_record_t));
+    key = Hwi_disable();                                            // the report reader runs in a higher priority task
+    stagedTail += count;
+    slot += count;
+    stored += count;
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      blackBox_flush
+ *
+ * @brief   Program every staged record now, erasing if needed.  Analytics task only (power off).
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void blackBox_flush( void )
+{
+    while ((mounted == 1) && (panicked == 0) && (stagedHead != stagedTail))
+    {
+        blackBox_taskFxn();
+    }
+}
+/*********************************************************************
+ * @fn      blackBox_read
+ *
+ * @brief   Fill part of the report for the Controller black box characteristic.  A read from
+ *          offset 0 fixes which records the report holds, so the rest of a long read returns the
+ *          same records while new ones are added.  BLE application task.
+ *
+ * @param   offset - offset in the report
+ *          pValue - destination
+ *          len - bytes to fill
+ *
+ * @return  none
+ */
+void blackBox_read( uint16_t offset, uint8_t *pValue, uint16_t len )
+{
+    blackBox_report_t header;
+    blackBox_record_t record;
+    uint32_t kept;
+    uint16_t position;
+    uint16_t within;
+    uint16_t size;
+    UInt key;
+
+    if (offset == 0)
+    {
+        key = Hwi_disable();
+        reportHead = stagedHead;
+        kept = stored + (stagedHead - stagedTail);
+        Hwi_restore(key);
+        reportKept = (kept > UINT16_MAX) ? UINT16_MAX : (uint16_t) kept;
+        reportCount = (kept > BLACK_BOX_REPORT_RECORDS) ? BLACK_BOX_REPORT_RECORDS : (uint8_t) kept;
+        reportTime_ms = blackBox_time();
+    }
+    while (len > 0)
+    {
+        position = offset;
+        if (position < BLACK_BOX_REPORT_HEADER)
+        {
+            memset(&header, 0, sizeof(header));
+            header.recordSize = sizeof(blackBox_record_t);
+            header.count = reportCount;
+            header.dropped = dropped;
+            header.kept = reportKept;
+            header.time_ms = reportTime_ms;
+            header.eraseMax_us = nvsJob_getBlockMaxUs();
+            within = position;
+            size = BLACK_BOX_REPORT_HEADER - within;
+            size = (size > len) ? len : size;
+            memcpy(pValue, (uint8_t *) &header + within, size);
+        }
+        else
+        {
+            blackBox_readRecord((position - BLACK_BOX_REPORT_HEADER) / BLACK_BOX_RECORD_SIZE, &record);
+            within = (position - BLACK_BOX_REPORT_HEADER) % BLACK_BOX_RECORD_SIZE;
+            size = BLACK_BOX_RECORD_SIZE - within;
+            size = (size > len) ? len : size;
+            memcpy(pValue, (uint8_t *) &record + within, size);
+        }
+        offset += size;
+        pValue += size;
+        len -= size;
+    }
+}
+/*********************************************************************
+ * @fn      blackBox_time
+ *
+ * @brief   Powered-on time from the RTOS clock
+ *
+ * @param   none
+ *
+ * @return  time in milli-seconds
+ */
+static uint32_t blackBox_time( void )
+{
+    return (uint32_t) (((uint64_t) Clock_getTicks() * Clock_tickPeriod) / 1000);
+}
+/*********************************************************************
+ * @fn      blackBox_check
+ *
+ * @brief   Check byte of a record: the complement of the sum of its other bytes, so a blank
+ *          (all 0xFF) or torn record does not pass
+ *
+ * @param   record - record
+ *
+ * @return  check byte
+ */
+static uint8_t blackBox_check( const blackBox_record_t *record )
+{
+    const uint8_t *bytes = (const uint8_t *) record;
+    uint8_t sum = 0;
+    uint8_t i;
+    for (i = 0; i < sizeof(blackBox_record_t); i++)
+    {
+        if (i != offsetof(blackBox_record_t, check))
+        {
+            sum += bytes[i];
+        }
+    }
+    return (uint8_t) ~sum;
+}
+/*********************************************************************
+ * @fn      blackBox_stage
+ *
+ * @brief   Build a record from the latest values and copy it into the staging ring.  A record is
+ *          dropped, and counted, when the ring is full.
+ *
+ * @param   type - BLACK_BOX_TYPE_xxx
+ *          code - event code
+ *          detail - event detail
+ *
+ * @return  none
+ */
+static void blackBox_stage( uint8_t type, uint8_t code, uint8_t detail )
+{
+    blackBox_record_t record;
+    UInt key;
+
+    record.type = type;
+    record.code = code;
+    record.detail = detail;
+    record.flags = flags;
+    record.time_ms = blackBox_time();
+    record.throttlePercent = throttlePercent;
+    record.IQ = IQ;
+    record.rpm = rpm;
+    record.busVoltage_mV = busVoltage_mV;
+    record.check = blackBox_check(&record);
+
+    key = Hwi_disable();
+    if (stagedHead - stagedTail >= BLACK_BOX_STAGING_RECORDS)
+    {
+        if (dropped < UINT16_MAX)
+        {
+            dropped++;
+        }
+        flags |= BLACK_BOX_FLAG_DROPPED;
+        Hwi_restore(key);
+        return;
+    }
+    staging[stagedHead & BLACK_BOX_STAGING_MASK] = record;
+    stagedHead++;
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      blackBox_isBlank
+ *
+ * @brief   Erased flash
+ *
+ * @param   record - slot read from flash
+ *
+ * @return  1 if every byte is 0xFF
+ */
+static uint8_t blackBox_isBlank( const blackBox_record_t *record )
+{
+    const uint8_t *bytes = (const uint8_t *) record;
+    uint8_t i;
+    for (i = 0; i < sizeof(blackBox_record_t); i++)
+    {
+        if (bytes[i] != 0xFF)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+/*********************************************************************
+ * @fn      blackBox_slotOffset
+ *
+ * @brief   Offset of a slot in the black box area
+ *
+ * @param   recordSector - sector
+ *          recordSlot - slot in the sector, 0 is the header
+ *
+ * @return  offset
+ */
+static size_t blackBox_slotOffset( uint8_t recordSector, uint16_t recordSlot )
+{
+    return ((size_t) recordSector * BLACK_BOX_SECTOR_SIZE) + ((size_t) recordSlot * BLACK_BOX_RECORD_SIZE);
+}
+/*********************************************************************
+ * @fn      blackBox_format
+ *
+ * @brief   Start writing an erased sector: program its header with the next sequence number
+ *
+ * @param   newSector - erased sector
+ *
+ * @return  none
+ */
+static void blackBox_format( uint8_t newSector )
+{
+    blackBox_record_t header;
+    UInt key;
+
+    memset(&header, 0, sizeof(header));
+    header.type = BLACK_BOX_TYPE_SECTOR;
+    header.time_ms = sectorSequence + 1;
+    header.check = blackBox_check(&header);
+    blackBox_nvsManager->blackBox_NVS_Program(blackBox_slotOffset(newSector, 0), &header, sizeof(header));
+    key = Hwi_disable();
+    sectorSequence++;
+    sector = newSector;
+    slot = 1;
+    nextErased = 0;
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      blackBox_eraseNext
+ *
+ * @brief   Erase the sector after the one being written - the oldest records are dropped
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void blackBox_eraseNext( void )
+{
+    uint16_t kept;
+    UInt key;
+
+    nvsJob_blockStart();
+    blackBox_nvsManager->blackBox_NVS_Erase(blackBox_slotOffset((sector + 1) % BLACK_BOX_SECTORS, 0));
+    nvsJob_blockEnd();
+    kept = (slot - 1) + (BLACK_BOX_SECTORS - 2) * BLACK_BOX_SECTOR_RECORDS;
+    key = Hwi_disable();
+    nextErased = 1;
+    if (stored > kept)
+    {
+        stored = kept;
+    }
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      blackBox_readRecord
+ *
+ * @brief   Record of the report, from the staging ring or from flash.  Record 0 is the newest
+ *          when the read started; a record erased since is returned as zeros.
+ *
+ * @param   k - record of the report
+ *          record - destination
+ *
+ * @return  none
+ */
+static void blackBox_readRecord( uint8_t k, blackBox_record_t *record )
+{
+    uint32_t number = reportHead - 1 - k;                           // record number since boot, may wrap below 0 (before boot)
+    int32_t back;
+    uint32_t position;
+    uint16_t flashRecords;
+    UInt key;
+
+    memset(record, 0, sizeof(blackBox_record_t));
+    if (k >= reportCount)
+    {
+        return;
+    }
+    key = Hwi_disable();
+    back = (int32_t) (stagedTail - number);                         // 1 = newest record in flash
+    position = ((uint32_t) sector * BLACK_BOX_SECTOR_RECORDS) + (slot - 1);
+    flashRecords = stored;
+    if (back <= 0)
+    {
+        *record = staging[number & BLACK_BOX_STAGING_MASK];
+    }
+    Hwi_restore(key);
+    if ((back <= 0) || (back > flashRecords) || (blackBox_nvsManager == NULL))
+    {
+        return;
+    }
+    position = (position + BLACK_BOX_RING_RECORDS - (uint32_t) back) % BLACK_BOX_RING_RECORDS;
+    blackBox_nvsManager->blackBox_NVS_Read(blackBox_slotOffset(position / BLACK_BOX_SECTOR_RECORDS,
+                                                               1 + (position % BLACK_BOX_SECTOR_RECORDS)),
+                                           record, sizeof(blackBox_record_t));
+}
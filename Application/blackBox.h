@@ -0,0 +1,136 @@
+/**********************************************************************************************
+ * blackBox.h
+ *
+ * Description:    Crash and fault black box.
+ *
+ *                 Compact telemetry (throttle, IQ, rpm, bus voltage, error flags) every
+ *                 BLACK_BOX_TELEMETRY_DIVIDER high frequency samples, and every boot, assert, RTOS
+ *                 error, STM32 error or exception and rider input fault, with the powered-on time,
+ *                 are kept in a ring of fixed size records over BLACK_BOX_SECTORS flash sectors.
+ *
+ *                 Recording costs the same from any context: the record is copied into a RAM
+ *                 staging ring, nothing else.  The analytics task programs the staged records (no
+ *                 erase) and erases the oldest sector ahead of need, outside the hot path.  A fatal
+ *                 path (assert, RTOS error) calls blackBox_panic, which programs what is staged into
+ *                 the erased flash left, without the NVS driver.
+ *
+ *                 Each sector starts with a header record holding its sequence number; the sector
+ *                 with the highest one is written, and the first blank slot in it (binary search) is
+ *                 the next to program.  A record carries a check byte so a torn record is skipped.
+ *                 The App reads the newest BLACK_BOX_REPORT_RECORDS records in one (long) read of
+ *                 the Controller black box characteristic, built from flash as it is read.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_BLACKBOX_H_
+#define APPLICATION_BLACKBOX_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define BLACK_BOX_SECTORS               2               // records are kept in a ring over this many flash sectors
+#define BLACK_BOX_SECTOR_SIZE           0x1000
+#define BLACK_BOX_RECORD_SIZE           16
+#define BLACK_BOX_SLOTS                 (BLACK_BOX_SECTOR_SIZE / BLACK_BOX_RECORD_SIZE)     // the first slot of a sector is its header
+#define BLACK_BOX_STAGING_RECORDS       16              // power of 2 - records waiting for the analytics task
+#define BLACK_BOX_PROGRAM_RECORDS       4               // staged records programmed per call
+#define BLACK_BOX_TELEMETRY_DIVIDER     2               // a telemetry record every 2 high frequency samples (0.6 s)
+#define BLACK_BOX_REPORT_RECORDS        31              // newest records in the report
+
+#define BLACK_BOX_TYPE_TELEMETRY        0x01
+#define BLACK_BOX_TYPE_BOOT             0x02
+#define BLACK_BOX_TYPE_ASSERT           0x03            // code: assert cause, detail: assert subcause (hal_assert.h)
+#define BLACK_BOX_TYPE_RTOS_ERROR       0x04            // code, detail: Error_getCode low and high byte
+#define BLACK_BOX_TYPE_STM32_ERROR      0x05            // code: STM32MCP error code
+#define BLACK_BOX_TYPE_STM32_EXCEPTION  0x06            // code: STM32MCP exception code
+#define BLACK_BOX_TYPE_RIDER_INPUT      0x07            // code: brake and throttle error message (BRAKE_ERROR, THROTTLE_ERROR)
+#define BLACK_BOX_TYPE_POWER_OFF        0x08
+#define BLACK_BOX_TYPE_SECTOR           0x7E            // sector header - time_ms holds the sector sequence number
+
+#define BLACK_BOX_FLAG_RIDER_INPUT      0x01            // brake or throttle sensor error
+#define BLACK_BOX_FLAG_STM32_ERROR      0x02            // STM32 error since the previous telemetry record
+#define BLACK_BOX_FLAG_STM32_EXCEPTION  0x04            // STM32 exception since the previous telemetry record
+#define BLACK_BOX_FLAG_DROPPED          0x08            // records dropped (staging full) since the previous telemetry record
+
+// Black box report (Controller black box characteristic, little endian) - blackBox_report_t header, then records
+//      [0] record size (1)  [1] records in the report (1)  [2] records dropped since boot (2)
+//      [4] records kept, flash and staged (2)  [6] reserved (2)  [8] powered-on time of the report ms (4)
+//      [12] longest flash erase of the NVS logs since boot us (4), see nvsJob.h
+//      [16] records, newest first (16): type BLACK_BOX_TYPE_xxx (1), code (1), detail (1),
+//           flags BLACK_BOX_FLAG_xxx (1), powered-on time ms (4), throttle % (1), check (1),
+//           IQ (2, signed, negative = regen), rpm (2), bus voltage mV (2)
+#define BLACK_BOX_REPORT_HEADER         16
+#define BLACK_BOX_REPORT_LEN            (BLACK_BOX_REPORT_HEADER + BLACK_BOX_RECORD_SIZE * BLACK_BOX_REPORT_RECORDS)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+    uint8_t  type;                                          // BLACK_BOX_TYPE_xxx, 0xFF blank
+    uint8_t  code;
+    uint8_t  detail;
+    uint8_t  flags;                                         // BLACK_BOX_FLAG_xxx
+    uint32_t time_ms;                                       // powered-on time (there is no real time clock)
+    uint8_t  throttlePercent;
+    uint8_t  check;                                         // ~(sum of the other bytes)
+    int16_t  IQ;                                            // last commanded
+    uint16_t rpm;
+    uint16_t busVoltage_mV;
+}blackBox_record_t;
+
+typedef struct
+{
+    uint8_t  recordSize;                                    // sizeof(blackBox_record_t)
+    uint8_t  count;                                         // records filled
+    uint16_t dropped;
+    uint16_t kept;
+    uint16_t reserved;
+    uint32_t time_ms;
+    uint32_t eraseMax_us;                                   // nvsJob_getBlockMaxUs
+}blackBox_report_t;
+
+typedef void (*blackBox_NVS_Read)(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize);
+typedef void (*blackBox_NVS_Program)(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
+typedef void (*blackBox_NVS_Erase)(size_t nvsOffset);
+typedef struct
+{
+    blackBox_NVS_Read       blackBox_NVS_Read;
+    blackBox_NVS_Program    blackBox_NVS_Program;           // program erased flash
+    blackBox_NVS_Erase      blackBox_NVS_Erase;             // erase one sector
+    blackBox_NVS_Program    blackBox_NVS_PanicProgram;      // program erased flash without the NVS driver - fatal paths only
+}blackBox_nvsManager_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void blackBox_registerNVS( blackBox_nvsManager_t *nvsManager );
+extern void blackBox_init( void );
+extern void blackBox_event( uint8_t type, uint8_t code, uint8_t detail );
+extern void blackBox_error( uint8_t type, uint8_t code );
+extern void blackBox_setDrive( uint8_t throttle, int16_t commandIQ, uint8_t riderInputError );
+extern void blackBox_telemetry( uint16_t motorRpm, uint16_t voltage_mV );
+extern void blackBox_panic( void );
+extern void blackBox_taskFxn( void );
+extern void blackBox_flush( void );
+extern void blackBox_read( uint16_t offset, uint8_t *pValue, uint16_t len );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_BLACKBOX_H_ */
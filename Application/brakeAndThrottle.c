@@ -12,10 +12,27 @@
 #include "Dashboard.h"
 #include "motorControl.h"
 #include "ledControl.h"
+#include "brakeLatency.h"
+#include "configStore.h"
 #include <stdint.h>
 /*********************************************************************
  * CONSTANTS
  */
+/* Compile time guard: the brake and throttle path is integer only.  Array size goes negative if a tunable is not an integer
+ * in range (a float constant is rejected by the '%' operator).  This file is also built with --float_operations_allowed=none */
+typedef char brakeAndThrottle_integerGuard[((THROTTLEPERCENTREDUCTION % BRAKE_AND_THROTTLE_PERCENT_SCALE) == THROTTLEPERCENTREDUCTION) ? 1 : -1];
+// The Dashboard characteristic must hold the whole calibration report
+typedef char brakeAndThrottle_calibrationLenCheck[(DASHBOARD_CALIBRATION_LEN == BRAKE_AND_THROTTLE_CALIBRATION_REPORT_LEN) ? 1 : -1];
+// The event queue index wraps with a mask
+typedef char brakeAndThrottle_eventQueueCheck[((BRAKE_AND_THROTTLE_EVT_QUEUE_SIZE & (BRAKE_AND_THROTTLE_EVT_QUEUE_SIZE - 1)) == 0) ? 1 : -1];
+#if BRAKE_AND_THROTTLE_REGEN_ENABLE
+/* Regen brake curve: regen IQ (negative) at brakePercent = 0, 10, 20 ... 100 %, linearly interpolated in between.
+ * Zero up to 10 % so the brake light threshold (BRAKEPERCENTTHRESHOLD) can be crossed without regen. */
+static const int16_t brakeAndThrottle_regenCurve[BRAKE_AND_THROTTLE_REGEN_CURVE_POINTS] =
+{
+    0, 0, -800, -1800, -2900, -4000, -5000, -5900, -6700, -7400, -BRAKE_AND_THROTTLE_REGEN_IQ_MAX
+};
+#endif
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -25,6 +42,8 @@ uint16_t adc2Result;            // for debugging only. adc2 = throttle signal
 uint16_t throttlePercent;       // Actual throttle applied in percentage
 uint16_t throttlePercent0;
 uint16_t IQValue;               // Iq value command sent to STM32 / motor Controller
+int16_t  regenIQValue = 0;      // Regen Iq command (<= 0) sent to STM32 in place of IQValue while braking
+int16_t  motorSpeed = 0;        // latest motor speed measured by the motor controller in RPM, negative when rolling backwards
 uint16_t brakePercent;          // Actual brake applied in percentage
 uint16_t brakeStatus = 0;
 uint16_t brakeADCAvg;
@@ -42,6 +61,7 @@ uint8_t speedModeChgFlag = 0;    // SpeedModeChgFlag = 1 when speed mode has cha
 /*********************************************************************
  * LOCAL VARIABLES
  */
+static volatile uint8_t motorSpeedAge = BRAKE_AND_THROTTLE_SPEED_MAX_AGE + 1;    // samples since motorSpeed was measured
 static brakeAndThrottle_timerManager_t  *brake_timerManager;
 static brakeAndThrottle_adcManager_t    *brake_adc1Manager;
 static brakeAndThrottle_adcManager_t    *brake_adc2Manager;
@@ -53,11 +73,54 @@ static uint16_t brakeADCValues[BRAKE_AND_THROTTLE_SAMPLES];
 static uint8_t  throttleIndex = 0;
 static uint16_t throttleADCValues[BRAKE_AND_THROTTLE_SAMPLES];
 
+// Calibration range in use and the reciprocal scale of each range
+static uint16_t throttleCalL = THROTTLE_ADC_CALIBRATE_L;
+static uint16_t throttleCalH = THROTTLE_ADC_CALIBRATE_H;
+static uint16_t brakeCalL = BRAKE_ADC_CALIBRATE_L;
+static uint16_t brakeCalH = BRAKE_ADC_CALIBRATE_H;
+static uint32_t throttleScale;
+static uint32_t brakeScale;
+
+// Guided calibration
+static uint8_t  calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_DEFAULT;
+static uint8_t  calibrationPrevState = BRAKE_AND_THROTTLE_CALIBRATION_DEFAULT;   // state to return to on abort
+static uint8_t  calibrationCommand = BRAKE_AND_THROTTLE_CALIBRATION_CMD_NONE;     // set from the App, handled at the next sample
+static uint8_t  calibrationCount = 0;
+static uint16_t calThrottleMin;
+static uint16_t calThrottleMax;
+static uint16_t calBrakeMin;
+static uint16_t calBrakeMax;
+
+// Rider input events
+static brakeAndThrottle_eventCB_t brakeAndThrottle_subscribers[BRAKE_AND_THROTTLE_EVT_SUBSCRIBERS_MAX];
+static uint8_t  brakeAndThrottle_subscriberCount = 0;
+static brakeAndThrottle_event_t brakeAndThrottle_eventQueue[BRAKE_AND_THROTTLE_EVT_QUEUE_SIZE];
+static uint8_t  eventHead = 0;                                  // next event to dispatch
+static uint8_t  eventTail = 0;                                  // next free entry
+static uint16_t eventOverflow = 0;                              // events dropped on a full queue, for debugging
+static uint8_t  throttleEngaged = 0;
+static uint8_t  brakePressed = 0;
+static uint8_t  hardBrake = 0;
+static uint8_t  faultErrorMsg = BRAKE_AND_THROTTLE_NORMAL;      // last error code published
 
 /**********************************************************************
  *  Local functions
  */
 static void brakeAndThrottle_getSpeedModeParams();
+#if BRAKE_AND_THROTTLE_REGEN_ENABLE
+static int16_t brakeAndThrottle_regenTarget(uint16_t brakePercent);
+#endif
+static uint32_t brakeAndThrottle_calibrationScale(uint16_t calL, uint16_t calH);
+static uint8_t brakeAndThrottle_calibrationRangeValid(uint16_t calL, uint16_t calH, uint16_t thresholdL, uint16_t thresholdH);
+static void brakeAndThrottle_applyCalibration(uint16_t tL, uint16_t tH, uint16_t bL, uint16_t bH);
+static void brakeAndThrottle_loadCalibration();
+static void brakeAndThrottle_saveCalibration();
+static void brakeAndThrottle_calibrationSample();
+static void brakeAndThrottle_finishCalibration();
+static void brakeAndThrottle_publishCalibration();
+static void brakeAndThrottle_postEvent(uint8_t event, uint8_t value);
+static void brakeAndThrottle_detectEvents();
+static void brakeAndThrottle_dispatchEvents();
 
 /*********************************************************************
  * @fn      brake_init
@@ -70,14 +133,20 @@ static void brakeAndThrottle_getSpeedModeParams();
  */
 void brakeAndThrottle_init()
 {
-    speedMode = BRAKE_AND_THROTTLE_SPEED_MODE_LEISURE; // load and Read NVSinternal and get the last speed mode
+    speedMode = configStore_get(CONFIG_STORE_KEY_SPEED_MODE);     // the last speed mode, saved in NVS internal
+    if (speedMode > BRAKE_AND_THROTTLE_SPEED_MODE_SPORTS)
+    {
+        speedMode = BRAKE_AND_THROTTLE_SPEED_MODE_LEISURE;
+    }
     brakeAndThrottle_getSpeedModeParams();
+    brakeAndThrottle_loadCalibration();     // per unit calibration from the config store, or the factory defaults
     uint8_t ii;
     for (ii = 0; ii < BRAKE_AND_THROTTLE_SAMPLES; ii++)
     {
-        brakeADCValues[ii] = BRAKE_ADC_CALIBRATE_L;
-        throttleADCValues[ii] = THROTTLE_ADC_CALIBRATE_L;
+        brakeADCValues[ii] = brakeCalL;
+        throttleADCValues[ii] = throttleCalL;
     }
+    brakeAndThrottle_publishCalibration();
 
 }
 /*********************************************************************
@@ -190,6 +259,57 @@ uint16_t brakeAndThrottle_getBrakePercent()
 {
     return brakePercent;
 }
+/*********************************************************************
+ * @fn      brakeAndThrottle_getRegenIQ
+ *
+ * @brief   To get the regen IQ currently commanded (0 when not regen braking)
+ *
+ * @param   none
+ *
+ * @return  the regen IQ, negative or zero
+ */
+int16_t brakeAndThrottle_getRegenIQ()
+{
+    return regenIQValue;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_setMotorSpeed
+ *
+ * @brief   Measured motor speed from the motor controller, used to disable regen near standstill and
+ *          when rolling backwards.  Used for BRAKE_AND_THROTTLE_SPEED_MAX_AGE samples.
+ *
+ * @param   rpm - measured motor speed in RPM, negative when rolling backwards
+ *
+ * @return  none
+ */
+void brakeAndThrottle_setMotorSpeed(int32_t rpm)
+{
+    motorSpeed = (rpm > INT16_MAX) ? INT16_MAX : ((rpm < INT16_MIN) ? INT16_MIN : (int16_t) rpm);
+    motorSpeedAge = 0;
+}
+#if BRAKE_AND_THROTTLE_REGEN_ENABLE
+/*********************************************************************
+ * @fn      brakeAndThrottle_regenTarget
+ *
+ * @brief   Map brakePercent to the regen IQ target through brakeAndThrottle_regenCurve
+ *
+ * @param   brakePercent - 0 to 100 %
+ *
+ * @return  regen IQ target, negative or zero
+ */
+static int16_t brakeAndThrottle_regenTarget(uint16_t brakePercent)
+{
+    uint8_t index = brakePercent / BRAKE_AND_THROTTLE_REGEN_CURVE_STEP;
+    if (index >= BRAKE_AND_THROTTLE_REGEN_CURVE_POINTS - 1)
+    {
+        return brakeAndThrottle_regenCurve[BRAKE_AND_THROTTLE_REGEN_CURVE_POINTS - 1];
+    }
+    int32_t low  = brakeAndThrottle_regenCurve[index];
+    int32_t high = brakeAndThrottle_regenCurve[index + 1];
+    int32_t frac = brakePercent - index * BRAKE_AND_THROTTLE_REGEN_CURVE_STEP;
+    return (int16_t) (low + (high - low) * frac / BRAKE_AND_THROTTLE_REGEN_CURVE_STEP);
+}
+#endif
 
 
 /*********************************************************************
@@ -255,7 +375,7 @@ void brakeAndThrottle_getSpeedModeParams()
 void brakeAndThrottle_toggleSpeedMode()
 {
     speedModeChgFlag = 1;
-    if (adc2Result <= THROTTLE_ADC_CALIBRATE_L)                                     // Only allow speed mode change when no throttle is applied
+    if (adc2Result <= throttleCalL)                                                 // Only allow speed mode change when no throttle is applied
     {
         if(speedMode == BRAKE_AND_THROTTLE_SPEED_MODE_AMBLE)                       // Amble mode to Leisure mode
         {
@@ -282,6 +402,7 @@ void brakeAndThrottle_toggleSpeedMode()
             allowableSpeed = BRAKE_AND_THROTTLE_MAXSPEED_AMBLE;
         }
         //Save the current setting
+        configStore_set(CONFIG_STORE_KEY_SPEED_MODE, speedMode);
         ledControl_setSpeedMode(speedMode);  // update speed mode displayed on dash board
         motorcontrol_setGatt(DASHBOARD_SERV_UUID, DASHBOARD_SPEED_MODE, DASHBOARD_SPEED_MODE_LEN, (uint8_t *) &speedMode);  //update speed mode on client (App)
 
@@ -370,6 +491,7 @@ void brakeAndThrottle_ADC_conversion()
      *******************************************************************************************************************************/
     uint16_t adc1Result;                           // adc1Result is a holder of the ADC reading
     brake_adc1Manager -> brakeAndThrottle_ADC_Convert( &adc1Result );
+    brakeLatency_mark(BRAKE_LATENCY_STAGE_ADC_SAMPLE);
     brakeADCValues[ brakeIndex++ ] = adc1Result;
     if (brakeIndex >= BRAKE_AND_THROTTLE_SAMPLES)
     {
@@ -402,6 +524,11 @@ void brakeAndThrottle_ADC_conversion()
     //uint16_t
     throttleADCAvg = throttleADCTotal/BRAKE_AND_THROTTLE_SAMPLES;
 
+    /*******************************************************************************************************************************
+     *      Calibration - handles App commands and, while calibrating, records the lowest / highest averages
+     *******************************************************************************************************************************/
+    brakeAndThrottle_calibrationSample();
+
     /*******************************************************************************************************************************
      *      Error Checking
      *      Check whether brake ADC reading is logical, if illogical, brakeAndThrottle_errorMsg = error (!=0)
@@ -419,15 +546,15 @@ void brakeAndThrottle_ADC_conversion()
     }
     /*******************************************************************************************************************************
      *      Brake Signal Calibration
-     *      Truncates the average brake ADC signals to within BRAKE_ADC_CALIBRATE_L and BRAKE_ADC_CALIBRATE_H
+     *      Truncates the average brake ADC signals to within brakeCalL and brakeCalH
      *******************************************************************************************************************************/
-    if(brakeADCAvg > BRAKE_ADC_CALIBRATE_H)
+    if(brakeADCAvg > brakeCalH)
     {
-        brakeADCAvg = BRAKE_ADC_CALIBRATE_H;
+        brakeADCAvg = brakeCalH;
     }
-    if(brakeADCAvg < BRAKE_ADC_CALIBRATE_L)
+    if(brakeADCAvg < brakeCalL)
     {
-        brakeADCAvg = BRAKE_ADC_CALIBRATE_L;
+        brakeADCAvg = brakeCalL;
     }
     /*******************************************************************************************************************************
      *      Error Checking
@@ -446,28 +573,31 @@ void brakeAndThrottle_ADC_conversion()
     }
     /*******************************************************************************************************************************
      *      Throttle Signal Calibration
-     *      Truncates the average throttle ADC signals to within THROTTLE_ADC_CALIBRATE_L and THROTTLE_ADC_CALIBRATE_H
+     *      Truncates the average throttle ADC signals to within throttleCalL and throttleCalH
      *******************************************************************************************************************************/
-    if(throttleADCAvg > THROTTLE_ADC_CALIBRATE_H)
+    if(throttleADCAvg > throttleCalH)
     {
-        throttleADCAvg = THROTTLE_ADC_CALIBRATE_H;
+        throttleADCAvg = throttleCalH;
     }
-    if(throttleADCAvg < THROTTLE_ADC_CALIBRATE_L)
+    if(throttleADCAvg < throttleCalL)
     {
-        throttleADCAvg = THROTTLE_ADC_CALIBRATE_L;
+        throttleADCAvg = throttleCalL;
     }
     /********************************************************************************************************************************
      *  brakePercent is in percentage - has value between 0 - 100 %
+     *  multiply-shift by the reciprocal of the calibration span (see brakeAndThrottle_calibrationScale)
      ********************************************************************************************************************************/
     //uint16_t
-    brakePercent = (uint16_t) ((brakeADCAvg - BRAKE_ADC_CALIBRATE_L) * 100 / (BRAKE_ADC_CALIBRATE_H - BRAKE_ADC_CALIBRATE_L));
+    brakePercent = (uint16_t) (((uint32_t) (brakeADCAvg - brakeCalL) * brakeScale) >> BRAKE_AND_THROTTLE_CALIBRATION_SHIFT);
 
     /********************** Brake Power Off Protect State Machine  *******************************************************************************
      *              if brake is pressed, i.e. brakePercent is greater than a certain value (15%), for safety purposes,
      *              dashboard will instruct motor controller to cut power to motor.
      *              Once power to motor is cut, both the brake & throttle must be released before power delivery can be resumed
+     *              Throttle release is tested in integer percent: throttlePercent x 100 < throttlePercent0 x THROTTLEPERCENTREDUCTION
+     *              (both sides <= 10000), which is exactly equivalent to throttlePercent < 0.7 x throttlePercent0
     **********************************************************************************************************************************************/
-    if ((brakeStatus == 1) && (throttlePercent >= throttlePercent0 * THROTTLEPERCENTREDUCTION)) {                           // condition when rider has not release the throttle
+    if ((brakeStatus == 1) && (throttlePercent * BRAKE_AND_THROTTLE_PERCENT_SCALE >= throttlePercent0 * THROTTLEPERCENTREDUCTION)) {                           // condition when rider has not release the throttle
         if ((throttlePercent0 == 0) && (brakePercent <= BRAKEPERCENTTHRESHOLD)) {
             brakeStatus = 0;                                                                                                // if brake is not pulled
         }
@@ -477,58 +607,491 @@ void brakeAndThrottle_ADC_conversion()
     }
     else if ((brakeStatus == 0) && (brakePercent > BRAKEPERCENTTHRESHOLD)) {                                                // condition when rider pulls on the brake
         brakeStatus = 1;
+        brakeLatency_mark(BRAKE_LATENCY_STAGE_BRAKE_STATUS);
         throttlePercent0 = throttlePercent;
     }
-    else if ((throttlePercent < throttlePercent0 * THROTTLEPERCENTREDUCTION) && (brakePercent <= BRAKEPERCENTTHRESHOLD)) {  // condition when rider releases the throttle && brake is released
+    else if ((throttlePercent * BRAKE_AND_THROTTLE_PERCENT_SCALE < throttlePercent0 * THROTTLEPERCENTREDUCTION) && (brakePercent <= BRAKEPERCENTTHRESHOLD)) {  // condition when rider releases the throttle && brake is released
         brakeStatus = 0;
     }
 
-    if (brakeStatus == 1){
-        // send instruction to STM32 to activate brake light
-        // for regen-brake, send brakePercent to STM32
+#if BRAKE_AND_THROTTLE_REGEN_ENABLE
+    /********************************************************************************************************************************
+     *  Regen brake: regenIQValue follows the curve target, rate limited to
+     *  BRAKE_AND_THROTTLE_REGEN_APPLY_STEP / BRAKE_AND_THROTTLE_REGEN_RELEASE_STEP per sampling period.
+     *  Zero at once when the brake is released, below BRAKE_AND_THROTTLE_REGEN_MIN_RPM (rolling backwards included) or when
+     *  the measured speed is older than BRAKE_AND_THROTTLE_SPEED_MAX_AGE samples.  Released on error.
+     ********************************************************************************************************************************/
+    if (motorSpeedAge <= BRAKE_AND_THROTTLE_SPEED_MAX_AGE) {
+        motorSpeedAge++;
+    }
+    if ((brakeStatus == 0) || (motorSpeedAge > BRAKE_AND_THROTTLE_SPEED_MAX_AGE) || (motorSpeed < BRAKE_AND_THROTTLE_REGEN_MIN_RPM)) {
+        regenIQValue = 0;
     }
     else {
-        // brake light off
-        // regen-brake off
+        int16_t regenTarget = 0;
+        if (brakeAndThrottle_errorMsg == BRAKE_AND_THROTTLE_NORMAL) {
+            regenTarget = brakeAndThrottle_regenTarget(brakePercent);
+        }
+        if (regenIQValue - regenTarget > BRAKE_AND_THROTTLE_REGEN_APPLY_STEP) {
+            regenIQValue -= BRAKE_AND_THROTTLE_REGEN_APPLY_STEP;
+        }
+        else if (regenTarget - regenIQValue > BRAKE_AND_THROTTLE_REGEN_RELEASE_STEP) {
+            regenIQValue += BRAKE_AND_THROTTLE_REGEN_RELEASE_STEP;
+        }
+        else {
+            regenIQValue = regenTarget;
+        }
     }
+#endif
     /********************************************************************************************************************************
      *  throttkePercent is in percentage - has value between 0 - 100 %
      ********************************************************************************************************************************/
     //uint16_t
-    throttlePercent = (uint16_t) ((throttleADCAvg - THROTTLE_ADC_CALIBRATE_L) * 100 / (THROTTLE_ADC_CALIBRATE_H - THROTTLE_ADC_CALIBRATE_L));
+    throttlePercent = (uint16_t) (((uint32_t) (throttleADCAvg - throttleCalL) * throttleScale) >> BRAKE_AND_THROTTLE_CALIBRATION_SHIFT);
 
     if (brakeAndThrottle_errorMsg == 0) {
         if (brakeStatus == 1){
             IQValue = 0;
+            brakeLatency_mark(BRAKE_LATENCY_STAGE_IQ_ZERO);
         }
         else {
-            IQValue = BRAKE_AND_THROTTLE_TORQUEIQ_MAX * reductionRatio * throttlePercent / 10000;
+            IQValue = (uint16_t) ((uint32_t) BRAKE_AND_THROTTLE_TORQUEIQ_MAX * reductionRatio * throttlePercent /
+                                  (BRAKE_AND_THROTTLE_PERCENT_SCALE * BRAKE_AND_THROTTLE_PERCENT_SCALE));
         }
     }
     else {
         IQValue = 0;
     }
+    if (calibrationState == BRAKE_AND_THROTTLE_CALIBRATION_RUNNING) {      // no drive and no regen while calibrating
+        IQValue = 0;
+        regenIQValue = 0;
+    }
 
     /********************************************************************************************************************************
      * Send the throttle signal to STM32 Motor Controller (Dynamic Current)
      ********************************************************************************************************************************/
     //brakeAndThrottle_CBs -> brakeAndThrottle_CB(allowableSpeed, throttlePercent, brakeAndThrottle_errorMsg);
-    brakeAndThrottle_CBs -> brakeAndThrottle_CB(allowableSpeed, IQValue,brakeAndThrottle_errorMsg);
+    // While braking the dynamic current frame carries the regen IQ (negative) instead of IQValue
+    brakeAndThrottle_CBs -> brakeAndThrottle_CB(allowableSpeed, (brakeStatus == 1) ? regenIQValue : (int16_t) IQValue, brakeAndThrottle_errorMsg);
+    /********************************************************************************************************************************
+     *  Rider input events - edges of throttle, brake, hard brake and sensor fault are queued and handed to the subscribers
+     *  after the motor command has been sent (e.g. tail light on brake pressed / released)
+     ********************************************************************************************************************************/
+    brakeAndThrottle_detectEvents();
+    brakeAndThrottle_dispatchEvents();
     /********************************************************************************************************************************
      *      The following is a safety critical routine/condition
      *      Firmware only allows speed mode change when throttle is not pressed concurrently/fully released
      *      If speed mode is changed && throttle is not pressed or is released,
      *      firmware will then send instructions to STM32 and assigns speed mode parameters
      ********************************************************************************************************************************/
-    if ((speedModeChgFlag == 1) && (adc2Result <= THROTTLE_ADC_CALIBRATE_L)) {
+    if ((speedModeChgFlag == 1) && (adc2Result <= throttleCalL)) {
         motorcontrol_speedModeChgCB(speedModeIQmax, allowableSpeed, rampRate);
         speedModeChgFlag = 0;
     }
 
-    //Sends brake signal to the controller for tail light toggling
-    //Do it as you like !!!
+    brakeLatency_publish();             // update the brake latency report on the App when a trace has completed
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_calibrationScale
+ *
+ * @brief   Reciprocal of the calibration span, rounded up so that the multiply-shift gives the same result
+ *          as (ADCAvg - L) * 100 / (H - L) for any span below 2^12
+ *
+ * @param   calL, calH - calibration range
+ *
+ * @return  ceil(100 * 2^BRAKE_AND_THROTTLE_CALIBRATION_SHIFT / (calH - calL))
+ */
+static uint32_t brakeAndThrottle_calibrationScale(uint16_t calL, uint16_t calH)
+{
+    uint32_t span = calH - calL;
+    return (((uint32_t) BRAKE_AND_THROTTLE_PERCENT_SCALE << BRAKE_AND_THROTTLE_CALIBRATION_SHIFT) + span - 1) / span;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_calibrationRangeValid
+ *
+ * @brief   A calibration range must lie within the error thresholds and span at least
+ *          BRAKE_AND_THROTTLE_CALIBRATION_MIN_SPAN
+ *
+ * @param   calL, calH - calibration range
+ *          thresholdL, thresholdH - error thresholds of the signal
+ *
+ * @return  1 if valid, 0 otherwise
+ */
+static uint8_t brakeAndThrottle_calibrationRangeValid(uint16_t calL, uint16_t calH, uint16_t thresholdL, uint16_t thresholdH)
+{
+    return ((calL >= thresholdL) && (calH <= thresholdH) && (calH >= calL + BRAKE_AND_THROTTLE_CALIBRATION_MIN_SPAN));
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_applyCalibration
+ *
+ * @brief   Use a new calibration range and precompute its reciprocal scale
+ *
+ * @param   tL, tH - throttle range
+ *          bL, bH - brake range
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_applyCalibration(uint16_t tL, uint16_t tH, uint16_t bL, uint16_t bH)
+{
+    throttleCalL = tL;
+    throttleCalH = tH;
+    brakeCalL = bL;
+    brakeCalH = bH;
+    throttleScale = brakeAndThrottle_calibrationScale(tL, tH);
+    brakeScale = brakeAndThrottle_calibrationScale(bL, bH);
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_loadCalibration
+ *
+ * @brief   Load the calibration ranges from the config store.  The factory defaults are used if no
+ *          calibration has been saved (value 0) or a saved range is out of range.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_loadCalibration()
+{
+    uint32_t throttleCal = configStore_get(CONFIG_STORE_KEY_THROTTLE_CALIBRATION);
+    uint32_t brakeCal = configStore_get(CONFIG_STORE_KEY_BRAKE_CALIBRATION);
+    uint16_t tL = (uint16_t) throttleCal;
+    uint16_t tH = (uint16_t) (throttleCal >> 16);
+    uint16_t bL = (uint16_t) brakeCal;
+    uint16_t bH = (uint16_t) (brakeCal >> 16);
+
+    brakeAndThrottle_applyCalibration(THROTTLE_ADC_CALIBRATE_L, THROTTLE_ADC_CALIBRATE_H, BRAKE_ADC_CALIBRATE_L, BRAKE_ADC_CALIBRATE_H);
+    calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_DEFAULT;
+    if ((brakeAndThrottle_calibrationRangeValid(tL, tH, THROTTLE_ADC_THRESHOLD_L, THROTTLE_ADC_THRESHOLD_H)) &&
+        (brakeAndThrottle_calibrationRangeValid(bL, bH, BRAKE_ADC_THRESHOLD_L, BRAKE_ADC_THRESHOLD_H)))
+    {
+        brakeAndThrottle_applyCalibration(tL, tH, bL, bH);
+        calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_STORED;
+    }
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_saveCalibration
+ *
+ * @brief   Save the calibration ranges in use to the config store.  The factory defaults are saved
+ *          as 0 (no calibration).  The config store defers the flash write to the analytics task.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_saveCalibration()
+{
+    if (calibrationState == BRAKE_AND_THROTTLE_CALIBRATION_STORED)
+    {
+        configStore_set(CONFIG_STORE_KEY_THROTTLE_CALIBRATION, BRAKE_AND_THROTTLE_CALIBRATION_PACK(throttleCalL, throttleCalH));
+        configStore_set(CONFIG_STORE_KEY_BRAKE_CALIBRATION, BRAKE_AND_THROTTLE_CALIBRATION_PACK(brakeCalL, brakeCalH));
+    }
+    else
+    {
+        configStore_set(CONFIG_STORE_KEY_THROTTLE_CALIBRATION, 0);
+        configStore_set(CONFIG_STORE_KEY_BRAKE_CALIBRATION, 0);
+    }
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_calibrationCommand
+ *
+ * @brief   Calibration command from the App.  It is handled at the next ADC sample.
+ *
+ * @param   command - BRAKE_AND_THROTTLE_CALIBRATION_CMD_xxx
+ *
+ * @return  none
+ */
+void brakeAndThrottle_calibrationCommand(uint8_t command)
+{
+    calibrationCommand = command;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_getCalibrationState
+ *
+ * @brief   To get the calibration state
+ *
+ * @param   none
+ *
+ * @return  BRAKE_AND_THROTTLE_CALIBRATION_xxx
+ */
+uint8_t brakeAndThrottle_getCalibrationState()
+{
+    return calibrationState;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_getCalibrationReport
+ *
+ * @brief   Pack the calibration state, progress and range into the
+ *          BRAKE_AND_THROTTLE_CALIBRATION_REPORT_LEN byte report (little endian)
+ *
+ * @param   report - destination, BRAKE_AND_THROTTLE_CALIBRATION_REPORT_LEN bytes
+ *
+ * @return  none
+ */
+void brakeAndThrottle_getCalibrationReport(uint8_t *report)
+{
+    report[0] = calibrationState;
+    report[1] = (calibrationState == BRAKE_AND_THROTTLE_CALIBRATION_RUNNING) ?
+                (uint8_t) ((uint16_t) calibrationCount * 100 / BRAKE_AND_THROTTLE_CALIBRATION_PERIODS) : 100;
+    report[2] = throttleCalL & 0xFF;    report[3] = (throttleCalL >> 8) & 0xFF;
+    report[4] = throttleCalH & 0xFF;    report[5] = (throttleCalH >> 8) & 0xFF;
+    report[6] = brakeCalL & 0xFF;       report[7] = (brakeCalL >> 8) & 0xFF;
+    report[8] = brakeCalH & 0xFF;       report[9] = (brakeCalH >> 8) & 0xFF;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_publishCalibration
+ *
+ * @brief   Update the Dashboard calibration characteristic
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_publishCalibration()
+{
+    uint8_t report[BRAKE_AND_THROTTLE_CALIBRATION_REPORT_LEN];
+    brakeAndThrottle_getCalibrationReport(report);
+    motorcontrol_setGatt(DASHBOARD_SERV_UUID, DASHBOARD_CALIBRATION, DASHBOARD_CALIBRATION_LEN, report);
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_calibrationSample
+ *
+ * @brief   Called on every ADC sample with the new brakeADCAvg / throttleADCAvg.
+ *          Handles a pending App command and, while calibrating, records the lowest and highest averages.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_calibrationSample()
+{
+    uint8_t command = calibrationCommand;
+    calibrationCommand = BRAKE_AND_THROTTLE_CALIBRATION_CMD_NONE;
+    switch(command)
+    {
+    case BRAKE_AND_THROTTLE_CALIBRATION_CMD_START:
+        {
+            if (calibrationState != BRAKE_AND_THROTTLE_CALIBRATION_RUNNING)
+            {
+                calibrationPrevState = calibrationState;
+            }
+            calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_RUNNING;
+            calibrationCount = 0;
+            calThrottleMin = throttleADCAvg;
+            calThrottleMax = throttleADCAvg;
+            calBrakeMin = brakeADCAvg;
+            calBrakeMax = brakeADCAvg;
+            brakeAndThrottle_publishCalibration();
+            break;
+        }
+    case BRAKE_AND_THROTTLE_CALIBRATION_CMD_ABORT:
+        {
+            if (calibrationState == BRAKE_AND_THROTTLE_CALIBRATION_RUNNING)
+            {
+                calibrationState = calibrationPrevState;    // the range in use is only replaced when calibration completes
+            }
+            brakeAndThrottle_publishCalibration();
+            break;
+        }
+    case BRAKE_AND_THROTTLE_CALIBRATION_CMD_DEFAULTS:
+        {
+            brakeAndThrottle_applyCalibration(THROTTLE_ADC_CALIBRATE_L, THROTTLE_ADC_CALIBRATE_H, BRAKE_ADC_CALIBRATE_L, BRAKE_ADC_CALIBRATE_H);
+            calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_DEFAULT;
+            brakeAndThrottle_saveCalibration();
+            brakeAndThrottle_publishCalibration();
+            break;
+        }
+    default:
+        break;
+    }
 
-    //Send brake percentage for Regen Brake....
-    //Do it as you like
+    if (calibrationState != BRAKE_AND_THROTTLE_CALIBRATION_RUNNING)
+    {
+        return;
+    }
+    if (throttleADCAvg < calThrottleMin)
+    {
+        calThrottleMin = throttleADCAvg;
+    }
+    if (throttleADCAvg > calThrottleMax)
+    {
+        calThrottleMax = throttleADCAvg;
+    }
+    if (brakeADCAvg < calBrakeMin)
+    {
+        calBrakeMin = brakeADCAvg;
+    }
+    if (brakeADCAvg > calBrakeMax)
+    {
+        calBrakeMax = brakeADCAvg;
+    }
+    calibrationCount++;
+    if (calibrationCount >= BRAKE_AND_THROTTLE_CALIBRATION_PERIODS)
+    {
+        brakeAndThrottle_finishCalibration();
+        brakeAndThrottle_publishCalibration();
+    }
+    else if ((calibrationCount % BRAKE_AND_THROTTLE_CALIBRATION_PUBLISH_PERIODS) == 0)
+    {
+        brakeAndThrottle_publishCalibration();
+    }
 }
+/*********************************************************************
+ * @fn      brakeAndThrottle_finishCalibration
+ *
+ * @brief   Trim the recorded ranges by BRAKE_AND_THROTTLE_CALIBRATION_MARGIN % at each end and use and save them
+ *          if both are valid.  Otherwise the previous range is kept and the state is set to FAILED.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_finishCalibration()
+{
+    uint16_t throttleTrim = (uint16_t) ((uint32_t) (calThrottleMax - calThrottleMin) * BRAKE_AND_THROTTLE_CALIBRATION_MARGIN / BRAKE_AND_THROTTLE_PERCENT_SCALE);
+    uint16_t brakeTrim = (uint16_t) ((uint32_t) (calBrakeMax - calBrakeMin) * BRAKE_AND_THROTTLE_CALIBRATION_MARGIN / BRAKE_AND_THROTTLE_PERCENT_SCALE);
 
+    if ((calThrottleMin >= THROTTLE_ADC_THRESHOLD_L) && (calBrakeMin >= BRAKE_ADC_THRESHOLD_L) &&
+        (brakeAndThrottle_calibrationRangeValid(calThrottleMin + throttleTrim, calThrottleMax - throttleTrim, THROTTLE_ADC_THRESHOLD_L, THROTTLE_ADC_THRESHOLD_H)) &&
+        (brakeAndThrottle_calibrationRangeValid(calBrakeMin + brakeTrim, calBrakeMax - brakeTrim, BRAKE_ADC_THRESHOLD_L, BRAKE_ADC_THRESHOLD_H)))
+    {
+        brakeAndThrottle_applyCalibration(calThrottleMin + throttleTrim, calThrottleMax - throttleTrim,
+                                          calBrakeMin + brakeTrim, calBrakeMax - brakeTrim);
+        calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_STORED;
+        brakeAndThrottle_saveCalibration();
+    }
+    else
+    {
+        calibrationState = BRAKE_AND_THROTTLE_CALIBRATION_FAILED;
+    }
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_subscribe
+ *
+ * @brief   Register a rider input event subscriber.  Subscribers are called from the ADC sampling
+ *          (Clock function) context and must not block.
+ *
+ * @param   eventCB - called with every event
+ *
+ * @return  1 if registered, 0 if BRAKE_AND_THROTTLE_EVT_SUBSCRIBERS_MAX are already registered
+ */
+uint8_t brakeAndThrottle_subscribe(brakeAndThrottle_eventCB_t eventCB)
+{
+    if (brakeAndThrottle_subscriberCount >= BRAKE_AND_THROTTLE_EVT_SUBSCRIBERS_MAX)
+    {
+        return 0;
+    }
+    brakeAndThrottle_subscribers[brakeAndThrottle_subscriberCount++] = eventCB;
+    return 1;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_isThrottleEngaged
+ *
+ * @brief   To get the throttle state as published by the throttle engaged / released events
+ *
+ * @param   none
+ *
+ * @return  1 if the throttle is engaged, 0 if released
+ */
+uint8_t brakeAndThrottle_isThrottleEngaged()
+{
+    return throttleEngaged;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_postEvent
+ *
+ * @brief   Put an event in the event queue.  The event is dropped if the queue is full.
+ *
+ * @param   event - BRAKE_AND_THROTTLE_EVT_xxx
+ *          value - event value
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_postEvent(uint8_t event, uint8_t value)
+{
+    uint8_t next = (eventTail + 1) & (BRAKE_AND_THROTTLE_EVT_QUEUE_SIZE - 1);
+    if (next == eventHead)
+    {
+        eventOverflow++;
+        return;
+    }
+    brakeAndThrottle_eventQueue[eventTail].event = event;
+    brakeAndThrottle_eventQueue[eventTail].value = value;
+    eventTail = next;
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_detectEvents
+ *
+ * @brief   Compare the latest brake and throttle readings with the published state and post an event
+ *          for every transition
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_detectEvents()
+{
+    // Throttle - hysteresis between BRAKE_AND_THROTTLE_THROTTLE_ENGAGED_PERCENT and 0 %
+    if ((throttleEngaged == 0) && (throttlePercent > BRAKE_AND_THROTTLE_THROTTLE_ENGAGED_PERCENT))
+    {
+        throttleEngaged = 1;
+        brakeAndThrottle_postEvent(BRAKE_AND_THROTTLE_EVT_THROTTLE_ENGAGED, (uint8_t) throttlePercent);
+    }
+    else if ((throttleEngaged == 1) && (throttlePercent == 0))
+    {
+        throttleEngaged = 0;
+        brakeAndThrottle_postEvent(BRAKE_AND_THROTTLE_EVT_THROTTLE_RELEASED, 0);
+    }
+    // Brake lever - same threshold as the brake power off state machine
+    if ((brakePressed == 0) && (brakePercent > BRAKEPERCENTTHRESHOLD))
+    {
+        brakePressed = 1;
+        brakeAndThrottle_postEvent(BRAKE_AND_THROTTLE_EVT_BRAKE_PRESSED, (uint8_t) brakePercent);
+    }
+    else if ((brakePressed == 1) && (brakePercent <= BRAKEPERCENTTHRESHOLD))
+    {
+        brakePressed = 0;
+        brakeAndThrottle_postEvent(BRAKE_AND_THROTTLE_EVT_BRAKE_RELEASED, (uint8_t) brakePercent);
+    }
+    // Hard braking - brake pulled while the throttle is still applied, re-armed once either is released
+    if ((brakePercent > HARD_BRAKING_BRAKE_PERCENTAGE) && (throttlePercent > HARD_BRAKING_THROTTLE_PERCENTAGE))
+    {
+        if (hardBrake == 0)
+        {
+            hardBrake = 1;
+            brakeAndThrottle_postEvent(BRAKE_AND_THROTTLE_EVT_HARD_BRAKE, (uint8_t) brakePercent);
+        }
+    }
+    else
+    {
+        hardBrake = 0;
+    }
+    // Sensor fault - brakeAndThrottle_errorMsg is latched until power off
+    if ((brakeAndThrottle_errorMsg != BRAKE_AND_THROTTLE_NORMAL) && (brakeAndThrottle_errorMsg != faultErrorMsg))
+    {
+        faultErrorMsg = brakeAndThrottle_errorMsg;
+        brakeAndThrottle_postEvent(BRAKE_AND_THROTTLE_EVT_SENSOR_FAULT, faultErrorMsg);
+    }
+}
+/*********************************************************************
+ * @fn      brakeAndThrottle_dispatchEvents
+ *
+ * @brief   Hand every queued event to every subscriber, in order
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeAndThrottle_dispatchEvents()
+{
+    uint8_t ii;
+    while (eventHead != eventTail)
+    {
+        brakeAndThrottle_event_t *evt = &brakeAndThrottle_eventQueue[eventHead];
+        for (ii = 0; ii < brakeAndThrottle_subscriberCount; ii++)
+        {
+            brakeAndThrottle_subscribers[ii](evt);
+        }
+        eventHead = (eventHead + 1) & (BRAKE_AND_THROTTLE_EVT_QUEUE_SIZE - 1);
+    }
+}
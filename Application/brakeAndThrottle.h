@@ -17,7 +17,7 @@ extern "C"
  * INCLUDES
  */
 #include <stdint.h>
-#include <math.h>
+#include <stddef.h>
 /*********************************************************************
 *  EXTERNAL VARIABLES
 */
@@ -55,12 +55,27 @@ extern "C"
 #define BRAKE_AND_THROTTLE_TORQUEIQ_SPORTS                        15750     // IQ 15750 = 14.0 Amp
 #define BRAKE_AND_THROTTLE_TORQUEIQ_MAX                           15750     // IQ 15750 = 14.0 Amp
 
+//Regenerative brake - brakePercent is mapped to a negative (regen) IQ through a curve table.
+//Compiled out until the measured motor speed (STM32MCP_SPEED_MEASURED_REG_ID) is polled and passed to
+//brakeAndThrottle_setMotorSpeed: regen torque must never be commanded at standstill or rolling backwards.
+#ifndef BRAKE_AND_THROTTLE_REGEN_ENABLE
+#define BRAKE_AND_THROTTLE_REGEN_ENABLE                           0
+#endif
+#define BRAKE_AND_THROTTLE_REGEN_CURVE_POINTS                     11        // curve at 0, 10, 20 ... 100 % brake
+#define BRAKE_AND_THROTTLE_REGEN_CURVE_STEP                       10        // brakePercent between curve points
+#define BRAKE_AND_THROTTLE_REGEN_IQ_MAX                           7875      // IQ 7875 = 7.0 Amp, regen current limit (magnitude)
+#define BRAKE_AND_THROTTLE_REGEN_APPLY_STEP                       1000      // maximum increase of regen IQ per sampling period
+#define BRAKE_AND_THROTTLE_REGEN_RELEASE_STEP                     2000      // maximum decrease of regen IQ per sampling period
+#define BRAKE_AND_THROTTLE_REGEN_MIN_RPM                          60        // 60 RPM = 2.3 Km/hr, no regen below this speed (or backwards)
+#define BRAKE_AND_THROTTLE_SPEED_MAX_AGE                          2         // samples a measured speed is used for - no regen once older
+
 //Hard braking definition   (What is Hard Braking? why is this necessary?)
 #define HARD_BRAKING_THROTTLE_PERCENTAGE                          5
 #define HARD_BRAKING_BRAKE_PERCENTAGE                             5
 #define BRAKEPERCENTTHRESHOLD                                     5
-#define THROTTLEPERCENTREDUCTION                                  0.7
+#define THROTTLEPERCENTREDUCTION                                  70        // % of throttlePercent0, i.e. 0.7 in integer percent
 //Throttle calibration values = value range the throttle ADC is conditioned to be within
+//Factory defaults - used until a per unit calibration has been learned and saved
 #define THROTTLE_ADC_CALIBRATE_H                                  2350
 #define THROTTLE_ADC_CALIBRATE_L                                  850
 
@@ -69,6 +84,7 @@ extern "C"
 #define THROTTLE_ADC_THRESHOLD_L                                  750
 
 //Brake calibration values = value range the Brake ADC is conditioned to be within
+//Factory defaults - used until a per unit calibration has been learned and saved
 #define BRAKE_ADC_CALIBRATE_H                                     2350
 #define BRAKE_ADC_CALIBRATE_L                                     850
 
@@ -76,6 +92,64 @@ extern "C"
 #define BRAKE_ADC_THRESHOLD_H                                     2500
 #define BRAKE_ADC_THRESHOLD_L                                     750
 
+/*********************************************************************
+ *  Integer scaling used by brakeAndThrottle_ADC_conversion (no float / double)
+ *      brakePercent, throttlePercent   : 0 - 100, unit 1 %
+ *      THROTTLEPERCENTREDUCTION        : 0 - 100, unit 1 %  -> compared as throttlePercent * 100 vs throttlePercent0 * ratio
+ *      reductionRatio                  : 0 - 100, unit 1 %
+ *      IQValue = TORQUEIQ_MAX * reductionRatio * throttlePercent / 10000
+ *      worst case intermediate = 15750 * 100 * 100 = 157,500,000 < 2^31, fits in 32 bits
+ */
+#define BRAKE_AND_THROTTLE_PERCENT_SCALE                          100
+
+/*********************************************************************
+ *  Per unit calibration
+ *      The rider starts a guided calibration from the App, then releases both levers and fully applies them a few times.
+ *      The lowest / highest averaged ADC values seen during BRAKE_AND_THROTTLE_CALIBRATION_PERIODS samples, trimmed by
+ *      BRAKE_AND_THROTTLE_CALIBRATION_MARGIN % of the span at each end, become the new calibration range.
+ *      Motor output (drive and regen) is held at zero while calibrating.
+ *
+ *      percent = ((ADCAvg - L) * scale) >> BRAKE_AND_THROTTLE_CALIBRATION_SHIFT
+ *      scale   = ceil(100 * 2^SHIFT / (H - L)), computed once when the range changes
+ *      With H - L < 2^12 (12 bit ADC) and SHIFT = 24 the result is exactly (ADCAvg - L) * 100 / (H - L),
+ *      and (ADCAvg - L) * scale <= 100 * 2^24 + 4095 fits in 32 bits unsigned.
+ */
+#define BRAKE_AND_THROTTLE_CALIBRATION_SHIFT                      24
+#define BRAKE_AND_THROTTLE_CALIBRATION_PERIODS                    100       // 100 x 100 ms = 10 seconds guided sequence
+#define BRAKE_AND_THROTTLE_CALIBRATION_MIN_SPAN                   600       // smallest ADC span accepted
+#define BRAKE_AND_THROTTLE_CALIBRATION_MARGIN                     3         // % of span trimmed at each end (rest and full scale dead band)
+#define BRAKE_AND_THROTTLE_CALIBRATION_PUBLISH_PERIODS            10        // progress sent to the App every 1 second
+#define BRAKE_AND_THROTTLE_CALIBRATION_PACK(calL, calH)          ((uint32_t) (calL) | ((uint32_t) (calH) << 16))  // range saved as one config store value
+
+//Calibration state (reported to the App)
+#define BRAKE_AND_THROTTLE_CALIBRATION_DEFAULT                    0x00      // factory defaults in use
+#define BRAKE_AND_THROTTLE_CALIBRATION_STORED                     0x01      // calibration loaded from / saved to the config store in use
+#define BRAKE_AND_THROTTLE_CALIBRATION_RUNNING                    0x02      // guided calibration in progress, motor output disabled
+#define BRAKE_AND_THROTTLE_CALIBRATION_FAILED                     0x03      // last calibration rejected, previous range kept
+
+//Calibration commands (written by the App)
+#define BRAKE_AND_THROTTLE_CALIBRATION_CMD_ABORT                  0x00
+#define BRAKE_AND_THROTTLE_CALIBRATION_CMD_START                  0x01
+#define BRAKE_AND_THROTTLE_CALIBRATION_CMD_DEFAULTS               0x02      // restore and save the factory defaults
+#define BRAKE_AND_THROTTLE_CALIBRATION_CMD_NONE                   0xFF
+
+// Calibration report sent to the App (Dashboard service, little endian)
+//      [0] state       [1] progress %
+//      [2] throttle L (2)  [4] throttle H (2)  [6] brake L (2)  [8] brake H (2)
+#define BRAKE_AND_THROTTLE_CALIBRATION_REPORT_LEN                 10
+
+//Rider input events - published to the subscribers on transitions only
+#define BRAKE_AND_THROTTLE_EVT_THROTTLE_ENGAGED                   0x01      // value = throttlePercent
+#define BRAKE_AND_THROTTLE_EVT_THROTTLE_RELEASED                  0x02      // value = 0
+#define BRAKE_AND_THROTTLE_EVT_BRAKE_PRESSED                      0x03      // value = brakePercent
+#define BRAKE_AND_THROTTLE_EVT_BRAKE_RELEASED                     0x04      // value = brakePercent
+#define BRAKE_AND_THROTTLE_EVT_HARD_BRAKE                         0x05      // brake pulled with the throttle still applied, value = brakePercent
+#define BRAKE_AND_THROTTLE_EVT_SENSOR_FAULT                       0x06      // value = brakeAndThrottle_errorMsg
+
+#define BRAKE_AND_THROTTLE_EVT_QUEUE_SIZE                         8         // power of 2
+#define BRAKE_AND_THROTTLE_EVT_SUBSCRIBERS_MAX                    4
+#define BRAKE_AND_THROTTLE_THROTTLE_ENGAGED_PERCENT               2         // engaged above this, released at 0 %
+
 //Error message
 #define BRAKE_AND_THROTTLE_NORMAL                                 0x00
 #define BRAKE_ERROR                                               0x01
@@ -103,7 +177,15 @@ typedef struct
     brakeAndThrottle_ADC_Close      brakeAndThrottle_ADC_Close;
 }brakeAndThrottle_adcManager_t;
 
-typedef void (*brakeAndThrottle_CB_t)(uint16_t, uint16_t, uint8_t);
+typedef struct
+{
+    uint8_t event;                                          // BRAKE_AND_THROTTLE_EVT_xxx
+    uint8_t value;
+}brakeAndThrottle_event_t;
+
+typedef void (*brakeAndThrottle_eventCB_t)(brakeAndThrottle_event_t *evt);
+
+typedef void (*brakeAndThrottle_CB_t)(uint16_t, int16_t, uint8_t);     // allowableSpeed, IQ command (negative = regen), errorMsg
 typedef struct
 {
     brakeAndThrottle_CB_t       brakeAndThrottle_CB;
@@ -130,6 +212,13 @@ extern void brakeAndThrottle_registerADC2(brakeAndThrottle_adcManager_t *obj);
 extern void brakeAndThrottle_ADC_conversion();
 extern uint16_t brakeAndThrottle_getThrottlePercent();
 extern uint16_t brakeAndThrottle_getBrakePercent();
+extern int16_t brakeAndThrottle_getRegenIQ();
+extern void brakeAndThrottle_setMotorSpeed(int32_t rpm);
+extern void brakeAndThrottle_calibrationCommand(uint8_t command);
+extern uint8_t brakeAndThrottle_getCalibrationState();
+extern void brakeAndThrottle_getCalibrationReport(uint8_t *report);
+extern uint8_t brakeAndThrottle_subscribe(brakeAndThrottle_eventCB_t eventCB);
+extern uint8_t brakeAndThrottle_isThrottleEngaged();
 /*********************************************************************
 *********************************************************************/
 
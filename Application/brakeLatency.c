@@ -0,0 +1,257 @@
+/******************************************************************************
+
+ @file  brakeLatency.c
+
+ @brief This file contains the brake to motor cut latency trace points.
+        Time stamps come from the SYS/BIOS Timestamp module and are converted
+        to micro-seconds only when a trace is closed.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <xdc/std.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include "brakeLatency.h"
+#include "fixedPoint.h"
+#include "motorControl.h"
+#include "Controller.h"
+#include "STM32MCP/STM32MCP.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+// The Controller characteristic must hold the whole report
+typedef char brakeLatency_reportLenCheck[(CONTROLLER_BRAKE_LATENCY_LEN == BRAKE_LATENCY_REPORT_LEN) ? 1 : -1];
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint32_t brakeLatency_freqHz;                                 // Timestamp frequency
+static uint32_t brakeLatency_sampleTs;                              // time stamp of the latest ADC sample
+static uint32_t brakeLatency_ts[BRAKE_LATENCY_STAGES];              // time stamps of the open trace
+static uint8_t  brakeLatency_stage = BRAKE_LATENCY_STAGE_ADC_SAMPLE; // last stage reached by the open trace
+static uint8_t  brakeLatency_open = 0;                              // 1 while a trace is open
+static uint8_t  brakeLatency_pending = 0;                           // 1 when a trace completed since the last publish
+static brakeLatency_stats_t brakeLatency_stats;
+
+/**********************************************************************
+ *  Local functions
+ */
+static void brakeLatency_close(void);
+
+/*********************************************************************
+ * @fn      brakeLatency_init
+ *
+ * @brief   Get the time stamp frequency and clear the statistics
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void brakeLatency_init( void )
+{
+    Types_FreqHz freq;
+    Timestamp_getFreq(&freq);
+    brakeLatency_freqHz = freq.lo;
+    brakeLatency_reset();
+}
+/*********************************************************************
+ * @fn      brakeLatency_reset
+ *
+ * @brief   Clear the statistics and abandon any open trace
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void brakeLatency_reset( void )
+{
+    UInt key = Hwi_disable();
+    memset(&brakeLatency_stats, 0, sizeof(brakeLatency_stats));
+    brakeLatency_stats.min_us = 0xFFFFFFFF;
+    brakeLatency_open = 0;
+    brakeLatency_pending = 0;
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      brakeLatency_mark
+ *
+ * @brief   Time stamp a stage of the brake path.
+ *          The ADC sample stage is recorded on every sample; the brake status stage opens (or restarts) a
+ *          trace using that sample as its origin.  Later stages are only recorded in order while a trace is open.
+ *
+ * @param   stage - BRAKE_LATENCY_STAGE_xxx
+ *
+ * @return  none
+ */
+void brakeLatency_mark( uint8_t stage )
+{
+    uint32_t now = Timestamp_get32();
+    if (stage == BRAKE_LATENCY_STAGE_ADC_SAMPLE)
+    {
+        brakeLatency_sampleTs = now;
+    }
+    else if (stage == BRAKE_LATENCY_STAGE_BRAKE_STATUS)
+    {
+        brakeLatency_ts[BRAKE_LATENCY_STAGE_ADC_SAMPLE] = brakeLatency_sampleTs;
+        brakeLatency_ts[BRAKE_LATENCY_STAGE_BRAKE_STATUS] = now;
+        brakeLatency_stage = BRAKE_LATENCY_STAGE_BRAKE_STATUS;
+        brakeLatency_open = 1;
+    }
+    else if ((brakeLatency_open) && (stage == brakeLatency_stage + 1) && (stage < BRAKE_LATENCY_STAGE_UART_WRITE))
+    {
+        brakeLatency_ts[stage] = now;
+        brakeLatency_stage = stage;
+    }
+}
+/*********************************************************************
+ * @fn      brakeLatency_markUartWrite
+ *
+ * @brief   Called for every frame handed to uartWrite.  Closes the open trace when the frame is the
+ *          dynamic current frame with IQ <= 0 (motor cut or regen) sent after the trace reached
+ *          BRAKE_LATENCY_STAGE_TX_QUEUE.
+ *
+ * @param   txFrame - the STM32MCP frame being written
+ *
+ * @return  none
+ */
+void brakeLatency_markUartWrite( uint8_t *txFrame )
+{
+    if ((brakeLatency_open) && (brakeLatency_stage == BRAKE_LATENCY_STAGE_TX_QUEUE) &&
+        ((txFrame[0] & 0x1F) == STM32MCP_SET_DYNAMIC_TORQUE_FRAME_ID) &&
+        (((txFrame[9] & 0x80) != 0) || ((txFrame[6] | txFrame[7] | txFrame[8] | txFrame[9]) == 0)))
+    {
+        brakeLatency_ts[BRAKE_LATENCY_STAGE_UART_WRITE] = Timestamp_get32();
+        brakeLatency_close();
+    }
+}
+/*********************************************************************
+ * @fn      brakeLatency_close
+ *
+ * @brief   Accumulate the open trace into min / avg / max, the histogram and the per stage worst case
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void brakeLatency_close(void)
+{
+    UInt key = Hwi_disable();
+    uint32_t total_us = fixedPoint_ticksToUs(brakeLatency_ts[BRAKE_LATENCY_STAGE_UART_WRITE] - brakeLatency_ts[BRAKE_LATENCY_STAGE_ADC_SAMPLE], brakeLatency_freqHz);
+    uint8_t ii;
+    for (ii = 1; ii < BRAKE_LATENCY_STAGES; ii++)
+    {
+        uint32_t delta_us = fixedPoint_ticksToUs(brakeLatency_ts[ii] - brakeLatency_ts[ii - 1], brakeLatency_freqHz);
+        if (delta_us > 0xFFFF)
+        {
+            delta_us = 0xFFFF;
+        }
+        if (delta_us > brakeLatency_stats.stageMax_us[ii - 1])
+        {
+            brakeLatency_stats.stageMax_us[ii - 1] = (uint16_t) delta_us;
+        }
+    }
+    if (brakeLatency_stats.count < 0xFFFF)
+    {
+        brakeLatency_stats.count++;
+        brakeLatency_stats.sum_us += total_us;
+    }
+    if (total_us < brakeLatency_stats.min_us)
+    {
+        brakeLatency_stats.min_us = total_us;
+    }
+    if (total_us > brakeLatency_stats.max_us)
+    {
+        brakeLatency_stats.max_us = total_us;
+    }
+    uint32_t bin = total_us / BRAKE_LATENCY_HIST_BIN_US;
+    if (bin >= BRAKE_LATENCY_HIST_BINS)
+    {
+        bin = BRAKE_LATENCY_HIST_BINS - 1;
+    }
+    if (brakeLatency_stats.hist[bin] < 0xFFFF)
+    {
+        brakeLatency_stats.hist[bin]++;
+    }
+    // Budget check - a trace over BRAKE_LATENCY_BUDGET_US is counted and reported to the App
+    if ((total_us > BRAKE_LATENCY_BUDGET_US) && (brakeLatency_stats.overBudget < 0xFFFF))
+    {
+        brakeLatency_stats.overBudget++;
+    }
+    brakeLatency_open = 0;
+    brakeLatency_pending = 1;
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      brakeLatency_getStats
+ *
+ * @brief   Take a consistent copy of the statistics
+ *
+ * @param   stats - destination
+ *
+ * @return  none
+ */
+void brakeLatency_getStats( brakeLatency_stats_t *stats )
+{
+    UInt key = Hwi_disable();
+    memcpy(stats, &brakeLatency_stats, sizeof(brakeLatency_stats));
+    Hwi_restore(key);
+}
+/*********************************************************************
+ * @fn      brakeLatency_getReport
+ *
+ * @brief   Pack the statistics into the BRAKE_LATENCY_REPORT_LEN byte report (little endian)
+ *
+ * @param   report - destination, BRAKE_LATENCY_REPORT_LEN bytes
+ *
+ * @return  none
+ */
+void brakeLatency_getReport( uint8_t *report )
+{
+    brakeLatency_stats_t stats;
+    brakeLatency_getStats(&stats);
+    uint32_t min_us = (stats.count == 0) ? 0 : stats.min_us;
+    uint32_t avg_us = (stats.count == 0) ? 0 : stats.sum_us / stats.count;
+    uint8_t ii;
+    uint8_t *ptr = report;
+
+    *ptr++ = stats.count & 0xFF;         *ptr++ = (stats.count >> 8) & 0xFF;
+    *ptr++ = stats.overBudget & 0xFF;    *ptr++ = (stats.overBudget >> 8) & 0xFF;
+    for (ii = 0; ii < 4; ii++)
+    {
+        ptr[ii]     = (min_us >> (8 * ii)) & 0xFF;
+        ptr[ii + 4] = (avg_us >> (8 * ii)) & 0xFF;
+        ptr[ii + 8] = (stats.max_us >> (8 * ii)) & 0xFF;
+    }
+    ptr += 12;
+    for (ii = 0; ii < BRAKE_LATENCY_HIST_BINS; ii++)
+    {
+        *ptr++ = stats.hist[ii] & 0xFF;  *ptr++ = (stats.hist[ii] >> 8) & 0xFF;
+    }
+    for (ii = 0; ii < BRAKE_LATENCY_STAGES - 1; ii++)
+    {
+        *ptr++ = stats.stageMax_us[ii] & 0xFF;  *ptr++ = (stats.stageMax_us[ii] >> 8) & 0xFF;
+    }
+}
+/*********************************************************************
+ * @fn      brakeLatency_publish
+ *
+ * @brief   Update the Controller brake latency characteristic if a trace completed since the last call.
+ *          Called from the brake and throttle sampling, not from the UART callback.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void brakeLatency_publish( void )
+{
+    if (brakeLatency_pending)
+    {
+        uint8_t report[BRAKE_LATENCY_REPORT_LEN];
+        brakeLatency_pending = 0;
+        brakeLatency_getReport(report);
+        motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_BRAKE_LATENCY, CONTROLLER_BRAKE_LATENCY_LEN, report);
+    }
+}
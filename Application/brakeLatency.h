@@ -0,0 +1,83 @@
+/**********************************************************************************************
+ * brakeLatency.h
+ *
+ * Description:    Brake to motor cut latency trace points and worst case report.
+ *
+ *                 A trace is opened when brakeStatus goes from 0 to 1 and is time stamped at
+ *                 each stage of the brake path.  The trace is closed when the dynamic current
+ *                 frame carrying IQ <= 0 (motor cut or regen) is handed to uartWrite.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_BRAKELATENCY_H_
+#define APPLICATION_BRAKELATENCY_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+// Trace stages, in the order they occur on the brake path
+#define BRAKE_LATENCY_STAGE_ADC_SAMPLE                  0       // brakeAndThrottle_ADC_conversion: ADC sample taken
+#define BRAKE_LATENCY_STAGE_BRAKE_STATUS                1       // brakeStatus set to 1 - opens the trace
+#define BRAKE_LATENCY_STAGE_IQ_ZERO                     2       // IQValue = 0
+#define BRAKE_LATENCY_STAGE_MOTOR_CB                    3       // motorcontrol_brakeAndThrottleCB entered
+#define BRAKE_LATENCY_STAGE_TX_QUEUE                    4       // STM32MCP_setDynamicCurrent called - frame queued or written
+#define BRAKE_LATENCY_STAGE_UART_WRITE                  5       // dynamic current frame handed to uartWrite - closes the trace
+#define BRAKE_LATENCY_STAGES                            6
+
+// Worst case ADC sample to uartWrite latency allowed, in micro-seconds
+#define BRAKE_LATENCY_BUDGET_US                         10000
+
+// Histogram of ADC sample to uartWrite latency
+#define BRAKE_LATENCY_HIST_BINS                         8
+#define BRAKE_LATENCY_HIST_BIN_US                       1000    // bin width; the last bin collects everything above
+
+// Report sent to the App (Controller service, little endian)
+//      [0]  count (2)          [2]  over budget count (2)
+//      [4]  min us (4)         [8]  avg us (4)         [12] max us (4)
+//      [16] histogram (2 x BRAKE_LATENCY_HIST_BINS)
+//      [32] worst case per stage delta us (2 x (BRAKE_LATENCY_STAGES - 1)), saturated at 0xFFFF
+#define BRAKE_LATENCY_REPORT_LEN                        (16 + 2 * BRAKE_LATENCY_HIST_BINS + 2 * (BRAKE_LATENCY_STAGES - 1))
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+    uint16_t count;                                         // number of completed traces
+    uint16_t overBudget;                                    // traces longer than BRAKE_LATENCY_BUDGET_US
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t sum_us;
+    uint16_t hist[BRAKE_LATENCY_HIST_BINS];
+    uint16_t stageMax_us[BRAKE_LATENCY_STAGES - 1];         // worst case of stage n-1 to stage n
+}brakeLatency_stats_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void brakeLatency_init( void );
+extern void brakeLatency_reset( void );
+extern void brakeLatency_mark( uint8_t stage );
+extern void brakeLatency_markUartWrite( uint8_t *txFrame );
+extern void brakeLatency_getStats( brakeLatency_stats_t *stats );
+extern void brakeLatency_getReport( uint8_t *report );
+extern void brakeLatency_publish( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_BRAKELATENCY_H_ */
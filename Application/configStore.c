@@ -0,0 +1,136 @@
+/******************************************************************************
+
+ @file  configStore.c
+
+ @brief This file contains the user settings key-value store.
+        Settings may be changed from any context; flash writes are made from
+        the analytics task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include "configStore.h"
+#include "writeBehind.h"
+#include "brakeAndThrottle.h"
+#include "dataAnalysis.h"
+#include "lightControl.h"
+#include "batterySoC.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+// Values used until a setting has been saved
+static const uint32_t configStore_default[CONFIG_STORE_KEYS] =
+{
+    BRAKE_AND_THROTTLE_SPEED_MODE_LEISURE,              // CONFIG_STORE_KEY_SPEED_MODE
+    SI_UNIT,                                            // CONFIG_STORE_KEY_DASH_UNIT
+    LIGHT_MODE_INITIAL,                                 // CONFIG_STORE_KEY_LIGHT_MODE
+    0,                                                  // CONFIG_STORE_KEY_THROTTLE_CALIBRATION
+    0,                                                  // CONFIG_STORE_KEY_BRAKE_CALIBRATION
+    BATTERY_SOC_NONE                                    // CONFIG_STORE_KEY_BATTERY_SOC
+};
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint32_t value[CONFIG_STORE_KEYS];                           // RAM copy, indexed by key
+static uint8_t  dirty = 0;                                          // a value changed and is not queued yet
+static uint8_t  flushCountdown = 0;                                 // samples left before the write is queued
+static writeBehind_entry_t configEntry = {WRITE_BEHIND_TAG_SETTINGS, value, sizeof(value), sizeof(value), NULL, 0};
+
+/*********************************************************************
+ * @fn      configStore_init
+ *
+ * @brief   Load the defaults, then the keys held in the newest settings record, and register the
+ *          settings with the write behind cache.  The shared record log must be mounted
+ *          (writeBehind_init).
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void configStore_init( void )
+{
+    uint8_t key;
+    for (key = 0; key < CONFIG_STORE_KEYS; key++)
+    {
+        value[key] = configStore_default[key];
+    }
+    nvsLog_readLatest(writeBehind_getLog(), WRITE_BEHIND_TAG_SETTINGS, value, sizeof(value));  // a shorter record leaves the newer keys at their default
+    dirty = 0;
+    flushCountdown = 0;
+    writeBehind_register(&configEntry);
+}
+/*********************************************************************
+ * @fn      configStore_get
+ *
+ * @brief   Read a setting
+ *
+ * @param   key - CONFIG_STORE_KEY_xxx
+ *
+ * @return  value, 0 for an unknown key
+ */
+uint32_t configStore_get( uint8_t key )
+{
+    return (key < CONFIG_STORE_KEYS) ? value[key] : 0;
+}
+/*********************************************************************
+ * @fn      configStore_set
+ *
+ * @brief   Change a setting in RAM.  The write to flash is deferred until the settings have been
+ *          unchanged for CONFIG_STORE_FLUSH_DELAY samples.
+ *
+ * @param   key - CONFIG_STORE_KEY_xxx
+ *          newValue - value
+ *
+ * @return  none
+ */
+void configStore_set( uint8_t key, uint32_t newValue )
+{
+    if ((key >= CONFIG_STORE_KEYS) || (value[key] == newValue))
+    {
+        return;
+    }
+    value[key] = newValue;
+    flushCountdown = CONFIG_STORE_FLUSH_DELAY;
+    dirty = 1;
+}
+/*********************************************************************
+ * @fn      configStore_taskFxn
+ *
+ * @brief   Count down after the last change and queue the settings for writing.  Called once per
+ *          analytics sample from task context.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void configStore_taskFxn( void )
+{
+    if (dirty == 0)
+    {
+        return;
+    }
+    if (flushCountdown > 0)
+    {
+        flushCountdown--;
+        return;
+    }
+    configStore_flush();
+}
+/*********************************************************************
+ * @fn      configStore_flush
+ *
+ * @brief   Queue the settings for the shared record log now if any has changed
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void configStore_flush( void )
+{
+    if (dirty == 1)
+    {
+        dirty = 0;
+        writeBehind_markDirty(&configEntry);
+    }
+}
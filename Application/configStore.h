@@ -0,0 +1,62 @@
+/**********************************************************************************************
+ * configStore.h
+ *
+ * Description:    Key-value store for user settings kept across power cycles.
+ *
+ *                 Keys are compile time IDs; every value is a uint32_t.  The values are held in a
+ *                 RAM array indexed by key, so configStore_get is a single load.  configStore_set
+ *                 only updates RAM; the whole table is queued as one record of the shared record
+ *                 log once no setting has changed for CONFIG_STORE_FLUSH_DELAY analytics samples,
+ *                 so a burst of button presses costs one small flash write.  The write itself is
+ *                 done by the write behind cache (writeBehind.h), which also writes the table
+ *                 again before the sector holding it is erased.
+ *
+ *                 New keys are added at the end: a record written by older firmware restores the
+ *                 keys it has and the new ones start from their default.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_CONFIGSTORE_H_
+#define APPLICATION_CONFIGSTORE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+// Keys - append only, never renumber
+#define CONFIG_STORE_KEY_SPEED_MODE     0               // BRAKE_AND_THROTTLE_SPEED_MODE_xxx
+#define CONFIG_STORE_KEY_DASH_UNIT      1               // SI_UNIT / IMP_UNIT
+#define CONFIG_STORE_KEY_LIGHT_MODE     2               // LIGHT_MODE_xxx
+#define CONFIG_STORE_KEY_THROTTLE_CALIBRATION   3       // throttle ADC range, L | H << 16 - 0 for the factory range
+#define CONFIG_STORE_KEY_BRAKE_CALIBRATION      4       // brake ADC range, L | H << 16 - 0 for the factory range
+#define CONFIG_STORE_KEY_BATTERY_SOC    5               // state of charge in 0.01 %, BATTERY_SOC_NONE until saved
+#define CONFIG_STORE_KEYS               6
+
+#define CONFIG_STORE_FLUSH_DELAY        10              // analytics samples without a change before the settings are written (3 s)
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void configStore_init( void );
+extern uint32_t configStore_get( uint8_t key );
+extern void configStore_set( uint8_t key, uint32_t value );
+extern void configStore_taskFxn( void );
+extern void configStore_flush( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_CONFIGSTORE_H_ */
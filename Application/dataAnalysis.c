@@ -41,39 +41,74 @@
 #include "periodicCommunication.h"
 #include "brakeAndThrottle.h"
 #include "lightControl.h"
+#include "fixedPoint.h"
+#include "batterySoC.h"
+#include "rangePredictor.h"
+#include "efficiencyMap.h"
+#include "configStore.h"
+#include "writeBehind.h"
+#include "usageHistory.h"
+#include "usageRollup.h"
+#include "tripLog.h"
+#include "nvsJob.h"
+#include "blackBox.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <xdc/std.h>
 #include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/knl/Task.h>
-#include <math.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/BIOS.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
+
+/*********************************************************************
+* CONSTANTS
+*/
+// The packed sample record fits the ring, which is a power of two at least one window long
+typedef char dataAnalysis_sampleRecordCheck[(sizeof(SR) == 8) ? 1 : -1];
+typedef char dataAnalysis_ringSizeCheck[(((DATA_ANALYSIS_RING_SIZE & DATA_ANALYSIS_RING_MASK) == 0) && (DATA_ANALYSIS_RING_SIZE >= DATA_ANALYSIS_WINDOW_LEN)) ? 1 : -1];
+// A full window of battery voltages must stay inside the exact range of the reciprocal mean
+typedef char dataAnalysis_windowSumCheck[((0xFFFFUL * DATA_ANALYSIS_WINDOW_LEN) <= DATA_ANALYSIS_WINDOW_SUM_MAX) ? 1 : -1];
+// The coefficient table is written out for the longest window
+typedef char dataAnalysis_coefficientCheck[(DATA_ANALYSIS_RING_SIZE == 16) ? 1 : -1];
 
 /*********************************************************************
 * LOCAL VARIABLES
 */
 static uint16_t DATA_ANALYSIS_SAMPLING_TIME = PERIODIC_COMMUNICATION_HF_SAMPLING_TIME;
-// Simpson's 1/3 rule coefficients
-static uint8_t coefficient_array[DATA_ANALYSIS_POINTS] = {0};           // same size as DATA_ANALYSIS_POINTS
+// Simpson's 1/3 rule coefficients, in flash.  The last point of a window of windowLength intervals
+// weighs 1, not the 2 held here (dataAnalysis_windowAdd)
+static const uint8_t coefficient_array[DATA_ANALYSIS_RING_SIZE + 1] = {1, 4, 2, 4, 2, 4, 2, 4, 2, 4, 2, 4, 2, 4, 2, 4, 2};
 static uint8_t batteryStatus;
 //Default Unit Settings
 static uint8_t UnitSelectDash = SI_UNIT;                   // Keep the last units selected by user in memory, the same units is used on restart
 static uint8_t UnitSelectApp = SI_UNIT;                    // Mobile app allow user to select the desired display unit - the App units and Dash units are NOT linked
 //
-static uint16_t rpm[DATA_ANALYSIS_POINTS] = {0};                        //revolutions per minute data collected every time interval
-static uint16_t speed_cmph[DATA_ANALYSIS_POINTS] = {0};                 //rpm is converted to cm per second (cm/s)
-static uint16_t batteryCurrent_mA[DATA_ANALYSIS_POINTS] = {0};          //battery current data collected at every hf communication interval
-static uint16_t batteryVoltage_mV[DATA_ANALYSIS_POINTS] = {0};          //battery voltage data collected at every hf communication interval
-static int8_t heatSinkTemperature_C[DATA_ANALYSIS_POINTS] = {0};        // temperature can be negative
-static int8_t motorTemperature_C[DATA_ANALYSIS_POINTS] = {0};           // temperature can be negative
-
-static uint8_t (*ptrc)[DATA_ANALYSIS_POINTS] = &coefficient_array;
-
-static uint16_t (*ptrRpm)[DATA_ANALYSIS_POINTS] = &rpm;
-static uint16_t (*ptrSpeed)[DATA_ANALYSIS_POINTS] = &speed_cmph;
-static uint16_t (*ptrBatteryVoltage)[DATA_ANALYSIS_POINTS] = &batteryVoltage_mV;
-static uint16_t (*ptrBatteryCurrent)[DATA_ANALYSIS_POINTS] = &batteryCurrent_mA;
-static int8_t (*ptrhst)[DATA_ANALYSIS_POINTS] = &heatSinkTemperature_C;
-static int8_t (*ptrmt)[DATA_ANALYSIS_POINTS] = &motorTemperature_C;
+static SD sample = {0};                             // latest sample - carried over as sample 0 of the next window
+static WD window = {0};                             // running aggregates of the current window
+static WD windowPrev = {0};                         // aggregates of the last completed window
+static WS stats = {0};                              // statistics of the last completed window
+
+static SR ring[DATA_ANALYSIS_RING_SIZE];            // latest samples, packed.  ring[ringHead] is the next to be written
+static uint8_t ringHead = 0;
+static uint8_t windowLength = DATA_ANALYSIS_WINDOW_LEN;         // Simpson's intervals in the current window - always even
+static uint8_t windowLengthNext = DATA_ANALYSIS_WINDOW_LEN;     // applied when the next window starts
+static uint8_t windowIndex = 0;                     // position of the latest sample in the current window
+static uint8_t ringCount = 0;                       // valid samples in the ring
+static uint8_t analysisMode = DATA_ANALYSIS_MODE_DEFAULT;
+static SLD sliding = {0};                           // sliding window running sums
+
+// Single producer (hf clock callback) / single consumer (analytics task) queue.  The callback only writes
+// queueHead and the task only writes queueTail, so neither side needs a lock.
+static volatile SR queue[DATA_ANALYSIS_QUEUE_SIZE];
+static volatile uint8_t queueHead = 0;              // next slot written by the callback
+static volatile uint8_t queueTail = 0;              // next slot read by the task
+static uint16_t queueOverflow = 0;                  // samples dropped because the task fell behind
+static Semaphore_Struct queueSem;                   // one count per queued sample
+static uint32_t processMaxTicks = 0;                // worst case time to process one sample in the task, Timestamp ticks
 //
 static uint16_t dA_Count = 1;
 static uint32_t UDDataCounter = 0;                  // At new, UDDataCounter = 0
@@ -83,7 +118,14 @@ static uint16_t UDIndexPrev;
 static AD ADArray = {0};                            //Since this data set is temporary, array struct is not necesary.  ADArray data that are displayed on the mobile app.
 static AD (*ptrADArray) = &ADArray;                 // Provides a pointer option
 
-static float lenConvFactorDash;
+// Dashboard unit conversions, indexed by SI_UNIT / IMP_UNIT.  0.036 km/hr and 0.036 x KM2MILE mph per cm/sec.
+static const DU dashUnitTable[] = {
+    {SI_UNIT,  DATA_ANALYSIS_DASH_SPEED_MUL(36, 1000)},
+    {IMP_UNIT, DATA_ANALYSIS_DASH_SPEED_MUL(36 * (uint64_t) FIXEDPOINT_ROUND(KM2MILE * 1000), 1000000)}
+};
+static const DU *dashUnit = &dashUnitTable[SI_UNIT];  // selected dashboard unit
+static uint32_t energyRatio_q32;                    // DATA_ANALYSIS_SAMPLING_TIME / (3 x 1000 x 3600) in Q0.32 - Simpson's sum to mW-hr
+static uint32_t distanceRatio_q32;                  // DATA_ANALYSIS_SAMPLING_TIME / (3 x 10000) in Q0.32 - Simpson's sum to dm
 
 static uint32_t avgBatteryVoltage_mV = 0;
 static int16_t  avgBatteryLevel = 0;
@@ -98,40 +140,48 @@ static uint32_t totalMileagePrev_dm;                // unit in decimeters.  This
 static uint32_t totalPowerConsumedPrev_mWh;         // unit in milli-W-hr.  This is the previous data on the total power consumption
 static uint32_t totalMileage0_dm;                   // unit in decimeters.  This is the oldest data on total distance travelled stored in storage array
 static uint32_t totalPowerConsumed0_mWh;            // unit in milli-W-hr.  This is the oldest data on total power consumed stored in storage array
+static uint32_t deltaRegenEnergy_mWh;               // unit in milli-W-hr.  Energy recovered by regen brake in the latest computePowerConsumption()
+static uint32_t totalRegenEnergy_mWh;               // unit in milli-W-hr.  Energy recovered by regen brake since power on
+
+static rangePredictor_range_t rangePrediction;      // range and band published on the Controller range characteristic
 
 static uint32_t UDBuffer[NVS_BUFFER_SIZE];          //
 //
-static dataAnalysis_NVS_Manager_t *dataAnalysis_NVSManager;
+static usageHistory_codec_t usageEncoder;
+static uint8_t usageRecord[USAGE_HISTORY_ENTRY_MAX];    // encoded entry waiting for the shared record log, one per UDBuffer save
+static CP checkpoint;
+static void dataAnalysis_usageCarry(writeBehind_entry_t *entry);
+// Usage data first: a checkpoint must not reach flash before the UDBuffer save it follows.  Room is kept for a UDBuffer image.
+static writeBehind_entry_t usageEntry = {WRITE_BEHIND_TAG_USAGE, usageRecord, 0, sizeof(UDBuffer), dataAnalysis_usageCarry, 0};
+static writeBehind_entry_t checkpointEntry = {WRITE_BEHIND_TAG_CHECKPOINT, &checkpoint, sizeof(checkpoint), sizeof(checkpoint), NULL, 0};
+static SS snapshot;
+// Registered after the checkpoint: a snapshot that reaches flash always follows the checkpoint it matches
+static writeBehind_entry_t snapshotEntry = {WRITE_BEHIND_TAG_SNAPSHOT, &snapshot, sizeof(snapshot), sizeof(snapshot), NULL, 0};
+static volatile uint8_t snapshotSavePending = 0;    // power off requested - the snapshot is taken in task context
+static uint8_t snapshotPublishPending = 0;          // restored values waiting to be sent to the App from task context
+static volatile uint8_t nvsFlushPending = 0;        // power off requested - flush the black box after the commit
 
 /******************************************************************************************************
 *
 * LOCAL FUNCTIONS
 */
-/*
- * @fn      coefficient_array_init
- *
- * @brief   Used to initialize the coefficient_array used in Simpson's 1/3 rule
- *
- * @param   Nil
- *
- * @return  Nil
-******************************************************************************************************/
-extern uint8_t coefficient_array_init(){ //change number of data points if necessary
-    for(uint8_t x = 0; x < DATA_ANALYSIS_POINTS; x++){
-        if(x==0 || x == DATA_ANALYSIS_POINTS-1){
-            *((*ptrc)+ x) = 1;
-        }
-        else {
-            if(x%2==1){
-                *((*ptrc)+ x)=4;
-            }
-            else {
-                *((*ptrc)+ x)=2;
-            }
-        }
-    }
-    return 0;
-}
+static void dataAnalysis_windowStart( void );
+static void dataAnalysis_windowAdd(uint8_t index);
+static int16_t dataAnalysis_batteryLevel(uint16_t batteryVoltage_mV, int16_t batteryCurrent_mA);
+static void dataAnalysis_slidingAccumulate(const SR *record, int8_t sign);
+static void dataAnalysis_slidingRebuild( void );
+static void dataAnalysis_slidingApply( void );
+static void dataAnalysis_slidingSetGatt( void );
+static void dataAnalysis_process(const SR *record);
+static uint16_t dataAnalysis_rpmToSpeed(uint16_t rpm);
+static void dataAnalysis_windowStats( void );
+static int32_t dataAnalysis_windowMean(int32_t sum, uint8_t rounded);
+static void dataAnalysis_checkpointRestore( void );
+static void dataAnalysis_checkpointSave( void );
+static uint8_t dataAnalysis_snapshotRestore( void );
+static void dataAnalysis_initADArray( void );
+static void dataAnalysis_snapshotTaskFxn( void );
+static void dataAnalysis_historyPut(const usageHistory_entry_t *entry);
 /******************************************************************************************************
  * @fn      dataAnalysis_timerInterruptHandler
  *
@@ -146,6 +196,152 @@ extern void dataAnalysis_timerInterruptHandler()
         // motorControl.c pass data from MCU at every DATA_ANALYSIS_SAMPLING_TIME interval to dataSim(uint32_t jj)
 }
 
+/*********************************************************************
+* @fn      dataAnalysis_createTask
+*
+* @brief   Task creation function for the data analytics.  Also creates the semaphore counting the
+*          samples queued by dataAnalysis_sampling.
+*
+* @param   None.
+*
+* @return  None.
+*********************************************************************/
+// Task configuration
+Task_Struct     dataAnalysisTask;
+Char            dataAnalysisTaskStack[DATAANALYSIS_TASK_STACK_SIZE];
+
+void dataAnalysis_createTask(void)
+{
+    Task_Params taskParams;
+
+    Semaphore_construct(&queueSem, 0, NULL);        // counting semaphore: one count per queued sample
+
+    // Configure task
+    Task_Params_init(&taskParams);
+    taskParams.stack = dataAnalysisTaskStack;
+    taskParams.stackSize = DATAANALYSIS_TASK_STACK_SIZE;
+    taskParams.priority = DATAANALYSIS_TASK_PRIORITY;
+
+    Task_construct(&dataAnalysisTask, dataAnalysis_taskFxn, &taskParams, NULL);
+}
+
+/*********************************************************************
+* @fn      dataAnalysis_taskFxn
+*
+* @brief   Analytics task: takes each queued sample and processes it.  The processing time of every
+*          sample is measured and the worst case kept for dataAnalysis_getProcessMaxUs.
+*
+* @param   a0, a1 - not used
+*
+* @return  None.
+**********************************************************************/
+static void dataAnalysis_taskFxn(UArg a0, UArg a1)
+{
+    SR record;
+    uint8_t tail;
+    uint32_t startTicks;
+    uint32_t elapsedTicks;
+    for (; ;)
+    {
+        Semaphore_pend(Semaphore_handle(&queueSem), BIOS_WAIT_FOREVER);
+        tail = queueTail;
+        if (tail == queueHead)
+        {
+            dataAnalysis_snapshotTaskFxn();
+            tripLog_taskFxn();
+            writeBehind_taskFxn();      // woken without a sample: restored values at start up, or commit at power off
+            if (nvsFlushPending == 1)
+            {
+                nvsFlushPending = 0;
+                blackBox_flush();
+            }
+            else
+            {
+                blackBox_taskFxn();
+            }
+            continue;
+        }
+        record.rpm = queue[tail].rpm;
+        record.batteryVoltage_mV = queue[tail].batteryVoltage_mV;
+        record.batteryCurrent_mA = queue[tail].batteryCurrent_mA;
+        record.heatSinkTemperature_C = queue[tail].heatSinkTemperature_C;
+        record.motorTemperature_C = queue[tail].motorTemperature_C;
+        queueTail = (tail + 1) & DATA_ANALYSIS_QUEUE_MASK;      // slot is free for the callback only after it is copied
+
+        startTicks = Timestamp_get32();
+        dataAnalysis_process(&record);
+        elapsedTicks = Timestamp_get32() - startTicks;
+        if (elapsedTicks > processMaxTicks)
+        {
+            processMaxTicks = elapsedTicks;
+        }
+        efficiencyMap_taskFxn();        // map report, outside the measured time
+        usageRollup_taskFxn();
+        tripLog_taskFxn();
+        configStore_taskFxn();
+        dataAnalysis_snapshotTaskFxn();
+        writeBehind_taskFxn();          // at most one flash erase or program per sample
+        blackBox_taskFxn();             // staged black box records, or the erase ahead
+    }
+}
+
+/*********************************************************************
+* @fn      dataAnalysis_powerOff
+*
+* @brief   Write every pending record (usage data, checkpoint, settings, rollups), the summary of the
+*          trip being ridden and the analytics snapshot.  The checkpoint is written only here.
+*          Wakes the analytics task, which takes the snapshot and commits before anything else.
+*          The commit only programs, no erase.
+*          The black box is then flushed.
+*          May be called from any context.
+*
+* @param   None.
+*
+* @return  None.
+**********************************************************************/
+void dataAnalysis_powerOff(void)
+{
+    usageRollup_save();
+    tripLog_powerOff();
+    configStore_flush();                // settings changed in the last CONFIG_STORE_FLUSH_DELAY samples, state of charge
+    writeBehind_markDirty(&checkpointEntry);
+    snapshotSavePending = 1;
+    writeBehind_requestCommit();
+    nvsFlushPending = 1;
+    Semaphore_post(Semaphore_handle(&queueSem));
+}
+
+/*********************************************************************
+* @fn      dataAnalysis_getProcessMaxUs
+*
+* @brief   Worst case time to process one sample in the analytics task (pre-emption included).
+*          Before the analytics task this time was spent inside the hf clock callback.
+*
+* @param   None.
+*
+* @return  worst case in micro-seconds
+**********************************************************************/
+uint32_t dataAnalysis_getProcessMaxUs()
+{
+    Types_FreqHz freq;
+    Timestamp_getFreq(&freq);
+    return fixedPoint_ticksToUs(processMaxTicks, freq.lo);
+}
+
+/*********************************************************************
+* @fn      dataAnalysis_getQueueOverflow
+*
+* @brief   Number of samples dropped because the analytics task fell behind
+*
+* @param   None.
+*
+* @return  dropped samples
+**********************************************************************/
+uint16_t dataAnalysis_getQueueOverflow()
+{
+    return queueOverflow;
+}
+
 /******************************************************************************************************
  * @fun      dataAnalysis_Init
  *
@@ -158,92 +354,341 @@ extern void dataAnalysis_timerInterruptHandler()
 extern void dataAnalysis_init()
 {
     /* ***************************************************
-     * initialize Simpsons 1/3 rule coefficient_array
+     * Simpson's sum scaling factors - computed once so the per window results are a multiply and shift
      *****************************************************/
-    coefficient_array_init();
-
-    // ***************************************************
-    uint16_t batteryVoltageStartUp_mV;
-    uint16_t batteryCurrentStartUp_mA;
-    // At the instant of POWER ON, we need to obtain BATTERY status for LED display
-    // dashboard will instruct motor controller to obtain a battery voltage and current measurement
-    batteryVoltageStartUp_mV = 30100;           // -> STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_BUS_VOLTAGE_REG_ID);
-    batteryCurrentStartUp_mA = 3000;            // -> STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_BUS_CURRENT_REG_ID);
-    avgBatteryVoltage_mV = batteryVoltageStartUp_mV;
+    energyRatio_q32 = (((uint64_t) DATA_ANALYSIS_SAMPLING_TIME << 32) + 5400000) / 10800000;
+    distanceRatio_q32 = (((uint64_t) DATA_ANALYSIS_SAMPLING_TIME << 32) + 15000) / 30000;
 
     /***************************************************
      *      Read data stored in NVS Internal
      ***************************************************/
-    dummyUDArray();     // read UDArray data that are stored in memory (from nvsinternal)
-    //dataAnalysis_NVS_read( void );
+    writeBehind_register(&usageEntry);
+    writeBehind_register(&checkpointEntry);
+    writeBehind_register(&snapshotEntry);
+    if (dataAnalysis_NVSRead() == 0)   // read UDArray data that are stored in memory (from nvsinternal)
+    {
+        dummyUDArray();                 // nothing saved yet
+    }
     get_UDArrayData();
+    dataAnalysis_checkpointRestore();   // progress made after the last UDBuffer save
+    uint8_t restored = dataAnalysis_snapshotRestore();      // analytics state at the last power off, if it follows the checkpoint
+
+    // ***************************************************
+    if (restored == 0)
+    {
+        uint16_t batteryVoltageStartUp_mV;
+        uint16_t batteryCurrentStartUp_mA;
+        // At the instant of POWER ON, we need to obtain BATTERY status for LED display
+        // dashboard will instruct motor controller to obtain a battery voltage and current measurement
+        batteryVoltageStartUp_mV = 30100;           // -> STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_BUS_VOLTAGE_REG_ID);
+        batteryCurrentStartUp_mA = 3000;            // -> STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_BUS_CURRENT_REG_ID);
+
+        sample.rpm = 0;         // unit in rpm = get rpm
+        sample.speed_cmph = dataAnalysis_rpmToSpeed(sample.rpm);                                 // Unit in cm / sec
+        sample.batteryCurrent_mA = batteryCurrentStartUp_mA;                                     // unit in mA = get battery current in mA
+        sample.batteryVoltage_mV = batteryVoltageStartUp_mV;                                     // unit in mV = get battery voltage in mV
+        sample.batteryLevel = dataAnalysis_batteryLevel(sample.batteryVoltage_mV, sample.batteryCurrent_mA);
+        sample.heatSinkTemperature_C = 15;
+        sample.motorTemperature_C = 15;
+    }
+    batterySoC_init(sample.batteryLevel, sample.batteryCurrent_mA);     // state of charge saved at power off, or the start up voltage level
+    rangePredictor_init();
+    efficiencyMap_init();
+    usageRollup_init();
+    tripLog_init();
+    dataAnalysis_windowStart();             // start up (or last) sample is sample 0 of the first window, so the initial battery percentage uses it
+    dataAnalysis_windowStats();
+
     /*********************************************************************************************
      * Initializing data
      * defining ADArray variables at initialization allow connectivity with Mobile App instantly.
+     * A restored snapshot already holds the values of the last power off.
      *********************************************************************************************/
-    ADArray.accumPowerConsumption_mWh = totalPowerConsumedPrev_mWh;         // ADArray = App data strut
-    ADArray.accumMileage_dm = totalMileagePrev_dm;                          // ADArray = App data strut
+    if (restored == 0)
+    {
+        avgBatteryVoltage_mV = sample.batteryVoltage_mV;
+        dataAnalysis_initADArray();
+    }
+    else
+    {
+        avgBatteryVoltage_mV = ADArray.avgBatteryVoltage_mV;
+    }
+    batteryPercentage = ADArray.batteryPercentage;
+
+    UnitSelectDash = (configStore_get(CONFIG_STORE_KEY_DASH_UNIT) == IMP_UNIT) ? IMP_UNIT : SI_UNIT;
+    dataAnalysis_changeUnitSelectDash(UnitSelectDash);      // Send Unit Select to LED display
+
+    ledControl_setBatteryStatus(ADArray.batteryStatus);     // Send battery status to LED display
+
+    if ((batteryLow == 0) && (batteryPercentage < BATTERY_PERCENTAGE_LL)){
+        batteryLow = 1;
+        //buzzerControl_Start();
+    }
+    if ((batteryLow == 1) && (batteryPercentage > BATTERY_PERCENTAGE_LH)){
+        batteryLow = 0;
+        //buzzerControl_Stop();
+    }
+
+    snapshotPublishPending = 1;             // send the start up values to the App from the analytics task
+    Semaphore_post(Semaphore_handle(&queueSem));
+
+}
+
+/******************************************************************************************************
+ * @fun      dataAnalysis_initADArray
+ *
+ * @brief   Start up values of ADArray when there is no snapshot to restore
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_initADArray()
+{
+    ADArray.accumPowerConsumption_mWh = totalPowerConsumedPrev_mWh + sumDeltaPowerConsumed_mWh;   // ADArray = App data strut
+    ADArray.accumMileage_dm = totalMileagePrev_dm + sumDeltaMileage_dm;                         // ADArray = App data strut
     ADArray.avgSpeed_kph = 0;                                               // ADArray = App data strut
     ADArray.avgHeatSinkTemperature_C = 15;                                  // ADArray = App data strut
     ADArray.avgBatteryVoltage_mV = avgBatteryVoltage_mV;                    // ADArray = App data strut
     ADArray.errorCode = 0;                                                  // ADArray = App data strut
-    ADArray.batteryStatus = determineBatteryStatus();                       // ADArray = App data strut
     ADArray.batteryPercentage = computeBatteryPercentage();                 // ADArray = App data strut
+    ADArray.batteryStatus = determineBatteryStatus();                       // ADArray = App data strut, from the percentage above
     ADArray.instantEconomy_100Whpk = computeInstantEconomy(0, 0);           // ADArray = App data strut
     ADArray.economy_100Whpk = computeEconomy();                             // ADArray = App data strut
     ADArray.range_m = computeRange();                                       // ADArray = App data strut
     ptrADArray->co2Saved_g = computeCO2Saved();                             // ADArray = App data strut
     ADArray.motorTemperature_C = 15;                                        // ADArray = App data strut
+}
 
-    dataAnalysis_changeUnitSelectDash(UnitSelectDash);      // Send Unit Select to LED display
+/***********************************************************************************************************
+ * @fn      dataAnalysis_NVSRead
+ *
+ * @brief   Read data from NVS memory at start-up: rebuild UDBuffer by decoding the usage history in the
+ *          shared record log, oldest entry first, one record at a time.  A UDBuffer image (written
+ *          when the sector holding the history is about to be erased) is taken as it is; the entries
+ *          after it update it.  A gap in the record sequence numbers (a lost record, whatever its
+ *          tag) makes the decoder wait for the next keyframe.  The shared record log must be mounted
+ *          (writeBehind_init).
+ *
+ * @param   Nil
+ *
+ * @return  1 if UDBuffer was restored, 0 if there is no NVS or no saved record
+******************************************************************************************************/
+
+uint8_t dataAnalysis_NVSRead( void )
+{
+    nvsLog_t *log = writeBehind_getLog();
+    nvsLog_cursor_t cursor;
+    usageHistory_codec_t decoder;
+    usageHistory_entry_t entry;
+    uint8_t record[USAGE_HISTORY_ENTRY_MAX];
+    uint8_t restored = 0;
+    uint32_t nextSequence = 0;
+
+    usageHistory_reset(&usageEncoder);              // the first save after power on is a keyframe
+    usageHistory_reset(&decoder);
+    nvsLog_readFirst(log, &cursor);
+    while (nvsLog_readNext(log, &cursor, record, sizeof(record)) == 1)
+    {
+        if (cursor.sequence != nextSequence)
+        {
+            usageHistory_reset(&decoder);
+        }
+        nextSequence = cursor.sequence + 1;
+        if (cursor.tag != WRITE_BEHIND_TAG_USAGE)
+        {
+            continue;
+        }
+        if (cursor.length == sizeof(UDBuffer))
+        {
+            nvsLog_readCurrent(log, &cursor, UDBuffer, sizeof(UDBuffer));
+            usageHistory_reset(&decoder);
+            restored = 1;
+        }
+        else if ((cursor.length <= sizeof(record)) &&
+                 (usageHistory_decode(&decoder, record, cursor.length, &entry) == 1))
+        {
+            dataAnalysis_historyPut(&entry);
+            restored = 1;
+        }
+    }
+    return restored;
+}
 
-    *((*ptrRpm)) = 0;         // unit in rpm = get rpm
-    *((*ptrSpeed)) = round((*((*ptrRpm))) * 2 * (float) M_PI / 60 * WHEELRADIUS);              // Unit in cm / sec
-    *((*ptrBatteryCurrent)) = batteryCurrentStartUp_mA;                                                 // unit in mA = get battery current in mA
-    *((*ptrBatteryVoltage)) = batteryVoltageStartUp_mV;                                                 // unit in mV = get battery voltage in mV
-    *((*ptrhst)) = 15;
-    *((*ptrmt)) = 15;
-    //ledControl_setBatteryStatus(ADArray.batteryStatus);     // Send battery status to LED display
+/***********************************************************************************************************
+ * @fn      dataAnalysis_NVSWrite
+ *
+ * @brief   Encode the UDBuffer set just saved as a usage history entry and queue it for the shared
+ *          record log.  It is appended by the write behind cache from the analytics task.  If the
+ *          previous entry is still waiting it is replaced, and this one is encoded as a keyframe.  A
+ *          UDBuffer image still waiting already holds this save.
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
 
-    if ((batteryLow == 0) && (batteryPercentage < BATTERY_PERCENTAGE_LL)){
-        batteryLow = 1;
-        //buzzerControl_Start();
+void dataAnalysis_NVSWrite( void )
+{
+    usageHistory_entry_t entry;
+    if ((usageEntry.dirty == 1) && (usageEntry.data == UDBuffer))
+    {
+        return;
     }
-    if ((batteryLow == 1) && (batteryPercentage > BATTERY_PERCENTAGE_LH)){
-        batteryLow = 0;
-        //buzzerControl_Stop();
+    entry.UDCounter = UDBuffer[1];
+    entry.ADCounter = UDBuffer[0];
+    entry.mileage_dm = UDBuffer[2 + SETSIZE * UDIndex + 0];
+    entry.energy_mWh = UDBuffer[2 + SETSIZE * UDIndex + 1];
+    if (usageEntry.dirty == 1)
+    {
+        usageHistory_reset(&usageEncoder);          // a delta must follow the entry before it in the log
     }
+    usageEntry.data = usageRecord;
+    usageEntry.length = usageHistory_encode(&usageEncoder, &entry, usageRecord);
+    writeBehind_markDirty(&usageEntry);
+}
 
+/***********************************************************************************************************
+ * @fn      dataAnalysis_usageCarry
+ *
+ * @brief   Write behind carry callback: the sector holding the usage history is erased next.  Queue
+ *          the whole UDBuffer as one image instead of the next entry; the entries after it start
+ *          with a keyframe, so the history decodes from the image on.
+ *
+ * @param   entry - usage entry
+ *
+ * @return  Nil
+******************************************************************************************************/
+
+static void dataAnalysis_usageCarry(writeBehind_entry_t *entry)
+{
+    usageHistory_reset(&usageEncoder);
+    entry->data = UDBuffer;
+    entry->length = sizeof(UDBuffer);
+    writeBehind_markDirty(entry);
 }
 
 /***********************************************************************************************************
- * @fn      dataAnalysis_NVS_read
+ * @fn      dataAnalysis_historyPut
  *
- * @brief   Read data from NVS memory at start-up
+ * @brief   Put a decoded usage history entry into UDBuffer, as data2UDArray saved it
  *
- * @param   Nil
+ * @param   entry - decoded entry
  *
  * @return  Nil
 ******************************************************************************************************/
 
-void dataAnalysis_NVSRead( void )
+static void dataAnalysis_historyPut(const usageHistory_entry_t *entry)
 {
+    uint16_t index = entry->UDCounter % UDARRAYSIZE;
+    UDBuffer[0] = entry->ADCounter;
+    UDBuffer[1] = entry->UDCounter;
+    UDBuffer[2 + SETSIZE * index + 0] = entry->mileage_dm;
+    UDBuffer[2 + SETSIZE * index + 1] = entry->energy_mWh;
+}
 
+/***********************************************************************************************************
+ * @fn      dataAnalysis_checkpointRestore
+ *
+ * @brief   Restore the progress since the last UDBuffer save from the newest checkpoint, if that
+ *          checkpoint follows the UDBuffer save that was restored
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+
+static void dataAnalysis_checkpointRestore( void )
+{
+    if ((nvsLog_readLatest(writeBehind_getLog(), WRITE_BEHIND_TAG_CHECKPOINT, &checkpoint, sizeof(checkpoint)) == sizeof(checkpoint)) &&
+        (checkpoint.UDDataCounter == UDDataCounter) && (checkpoint.UDTriggerCounter < UDTRIGGER))
+    {
+        ADDataCounter = checkpoint.ADDataCounter;
+        sumDeltaMileage_dm = checkpoint.sumDeltaMileage_dm;
+        sumDeltaPowerConsumed_mWh = checkpoint.sumDeltaPowerConsumed_mWh;
+        UDTriggerCounter = checkpoint.UDTriggerCounter;
+    }
 }
 
 /***********************************************************************************************************
- * @fn      dataAnalysis_NVS_write
+ * @fn      dataAnalysis_checkpointSave
  *
- * @brief   Write data to NVS memory at power-off
+ * @brief   Update the checkpoint in RAM.  Called at the end of every window and after every UDBuffer
+ *          save.  It is queued for the shared record log at power off only: written every window it
+ *          would fill a log sector in minutes and push the usage history out.
  *
  * @param   Nil
  *
  * @return  Nil
 ******************************************************************************************************/
 
-void dataAnalysis_NVSWrite( void )
+static void dataAnalysis_checkpointSave( void )
 {
+    checkpoint.UDDataCounter = UDDataCounter;
+    checkpoint.ADDataCounter = ADDataCounter;
+    checkpoint.sumDeltaMileage_dm = sumDeltaMileage_dm;
+    checkpoint.sumDeltaPowerConsumed_mWh = sumDeltaPowerConsumed_mWh;
+    checkpoint.UDTriggerCounter = UDTriggerCounter;
+}
+
+/***********************************************************************************************************
+ * @fn      dataAnalysis_snapshotRestore
+ *
+ * @brief   Restore the analytics state of the last power off from the shared record log.  The record is
+ *          checked by the log (CRC), and must have been taken at the restored UDBuffer save and
+ *          window: a snapshot followed by more windows (the power was lost without a power off) is
+ *          stale and ignored.  Called after dataAnalysis_checkpointRestore.
+ *
+ * @param   Nil
+ *
+ * @return  1 if ADArray, the range, the last sample and batteryLow were restored, else 0
+******************************************************************************************************/
 
+static uint8_t dataAnalysis_snapshotRestore( void )
+{
+    if ((nvsLog_readLatest(writeBehind_getLog(), WRITE_BEHIND_TAG_SNAPSHOT, &snapshot, sizeof(snapshot)) != sizeof(snapshot)) ||
+        (snapshot.UDDataCounter != UDDataCounter) || (snapshot.ADDataCounter != ADDataCounter))
+    {
+        return 0;
+    }
+    ADArray = snapshot.ADArray;
+    rangePrediction = snapshot.rangePrediction;
+    sample = snapshot.sample;
+    batteryLow = snapshot.batteryLow;
+    return 1;
+}
+
+/***********************************************************************************************************
+ * @fn      dataAnalysis_snapshotTaskFxn
+ *
+ * @brief   Take the snapshot requested by dataAnalysis_powerOff and queue it for the shared record log, and
+ *          send the start up values to the App.  Called from the analytics task before
+ *          writeBehind_taskFxn, so the snapshot is part of the power off commit and matches the
+ *          checkpoint committed with it.
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+
+static void dataAnalysis_snapshotTaskFxn( void )
+{
+    if (snapshotSavePending == 1)
+    {
+        snapshotSavePending = 0;
+        snapshot.UDDataCounter = UDDataCounter;
+        snapshot.ADDataCounter = ADDataCounter;
+        snapshot.ADArray = ADArray;
+        snapshot.rangePrediction = rangePrediction;
+        snapshot.sample = sample;
+        snapshot.batteryLow = batteryLow;
+        writeBehind_markDirty(&snapshotEntry);
+    }
+    if (snapshotPublishPending == 1)
+    {
+        snapshotPublishPending = 0;
+        dataAnalysis_motorcontrol_setGatt();
+    }
 }
 
 /***********************************************************************************************************
@@ -283,26 +728,23 @@ extern void get_UDArrayData()
         totalPowerConsumedPrev_mWh = UDBuffer[2 + UDIndexPrev * SETSIZE + 1];
         ADDataCounter = UDBuffer[0];
 
-    //uint8_t speed_mode_init = UDBuffer[28];
-     UnitSelectDash = UDBuffer[29];
-     //uint8_t light_mode_init = UDBuffer[30];
 //    */
 }
 
 
 uint8_t dataAnalysis_getSpeedModeInit()
 {
-    return UDBuffer[28]; //speed_mode_init;
+    return configStore_get(CONFIG_STORE_KEY_SPEED_MODE);
 }
 
 uint8_t dataAnalysis_getDashUnitInit()
 {
-    return UDBuffer[29]; //Unit_Dash_init;
+    return configStore_get(CONFIG_STORE_KEY_DASH_UNIT);
 }
 
 uint8_t dataAnalysis_getLightModeInit()
 {
-    return UDBuffer[30]; //light_mode_init;
+    return configStore_get(CONFIG_STORE_KEY_LIGHT_MODE);
 }
 
 /*************************************************************************************************************
@@ -316,10 +758,10 @@ uint8_t dataAnalysis_getLightModeInit()
 ******************************************************************************************************/
 uint8_t dashSpeed;  // for debugging onlu
 extern void dataAnalysis_LEDSpeed(uint16_t xCounter){
-    uint16_t rawSpeed_100kph = ((float) speed_cmph[xCounter] * 3.6 );           // 100*km/hr
-    dashSpeed = ((float) speed_cmph[xCounter] * 0.036 * lenConvFactorDash);     // km/hr or mph
+    uint16_t rawSpeed_100kph = ((uint32_t) sample.speed_cmph * 36) / 10;                                 // 100*km/hr, exact
+    dashSpeed = ((uint64_t) sample.speed_cmph * dashUnit->speedMul) >> DATA_ANALYSIS_DASH_SPEED_SHIFT;    // km/hr or mph, truncated
     // Send rpm and speed to client (App)
-    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_MOTOR_RPM, CONTROLLER_MOTOR_RPM_LEN, (uint8_t *) &rpm[dA_Count]);
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_MOTOR_RPM, CONTROLLER_MOTOR_RPM_LEN, (uint8_t *) &sample.rpm);
     motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_MOTOR_SPEED, CONTROLLER_MOTOR_SPEED_LEN, (uint8_t *) &rawSpeed_100kph);
     // Send dashSpeed to LED display
     ledControl_setDashSpeed(dashSpeed);
@@ -336,11 +778,14 @@ extern void dataAnalysis_LEDSpeed(uint16_t xCounter){
 ******************************************************************************************************/
 void dataAnalyt()
 {
-    uint32_t deltaPowerConsumption_mWh, deltaMileage_dm;
+    uint32_t deltaMileage_dm;
+    int32_t deltaPowerConsumption_mWh;
     ADDataCounter++;
     ADArray.ADCounter = ADDataCounter;                // Why not ADDataCounter + 1?              // totalDataCount is total count of all computed datasets
-    deltaPowerConsumption_mWh = computePowerConsumption();
+    deltaPowerConsumption_mWh = computePowerConsumption();             // net of regen - recovered energy lowers economy and extends range
+    totalRegenEnergy_mWh += deltaRegenEnergy_mWh;
     deltaMileage_dm = computeDistanceTravelled();
+    dataAnalysis_windowStats();                                         // all window means and extrema in one pass
     sumDeltaPowerConsumed_mWh += deltaPowerConsumption_mWh;
     sumDeltaMileage_dm += deltaMileage_dm;
     ADArray.accumPowerConsumption_mWh = totalPowerConsumedPrev_mWh + sumDeltaPowerConsumed_mWh;
@@ -349,17 +794,26 @@ void dataAnalyt()
     ADArray.avgHeatSinkTemperature_C = computeAvgHeatSinkTemperature();
     ADArray.errorCode = 0;
     ADArray.avgBatteryVoltage_mV = computeAvgBatteryVoltage();
-    ADArray.batteryStatus = determineBatteryStatus();
     ADArray.batteryPercentage = computeBatteryPercentage();
-    ADArray.instantEconomy_100Whpk = computeInstantEconomy(deltaPowerConsumption_mWh, deltaMileage_dm);
+    ADArray.batteryStatus = determineBatteryStatus();
+    ADArray.instantEconomy_100Whpk = computeInstantEconomy((deltaPowerConsumption_mWh > 0) ? deltaPowerConsumption_mWh : 0, deltaMileage_dm);
     ADArray.economy_100Whpk = computeEconomy();
+    rangePredictor_update(ADArray.avgSpeed_kph, brakeAndThrottle_getSpeedMode(), ADArray.avgHeatSinkTemperature_C, ADArray.instantEconomy_100Whpk, deltaMileage_dm);
+    efficiencyMap_add(ADArray.avgSpeed_kph, brakeAndThrottle_getSpeedMode(), deltaPowerConsumption_mWh, deltaMileage_dm);
+    usageRollup_add(deltaPowerConsumption_mWh, deltaMileage_dm, stats.count, stats.minBatteryVoltage_mV, stats.maxMotorTemperature_C);
+    tripLog_addWindow(ADDataCounter, deltaPowerConsumption_mWh, deltaMileage_dm);
     ADArray.range_m = computeRange();
     ADArray.co2Saved_g = computeCO2Saved();
     ADArray.motorTemperature_C = computeMotorTemperature();
+    if (analysisMode == DATA_ANALYSIS_MODE_SLIDING)
+    {
+        dataAnalysis_slidingApply();    // keep the per sample display values rather than the batch ones
+    }
 
-    re_Initialize();    // Re-initialize rpm, speed, batteryVoltage and batteryCurrent arrays after data analysis
+    re_Initialize();    // Start the next window with the last sample of this window as its sample 0
 
     UDTriggerCounter++;     // When UDTriggerCounter = UDTrigger, UDArray is saved to flash memory
+    dataAnalysis_checkpointSave();
 
 }
 
@@ -393,14 +847,12 @@ void data2UDArray()
         UDBuffer[2 + SETSIZE * UDIndex + 1] = ADArray.accumPowerConsumption_mWh;
     // */
 
-        uint8_t speed_mode = brakeAndThrottle_getSpeedMode();
-        UDBuffer[28] = speed_mode;
-        UDBuffer[29] = UnitSelectDash;
-        uint8_t light_mode = lightControl_getLightMode();
-        UDBuffer[30] = light_mode;
+    // Speed mode, dashboard unit and light mode are kept in configStore
 /*
- *  UDBuffer is erased-write to nvsinternal when device shuts down
+ *  The new set is encoded and appended to the usage history log in nvsinternal
  */
+        dataAnalysis_NVSWrite();
+        usageRollup_save();
 
 /******************************************************************************************************
  * Resets UDDataCounter if it reaches 4292400000 counts (For memory and data management purposes only)
@@ -418,38 +870,91 @@ void data2UDArray()
     UDTriggerCounter = 0;
     sumDeltaPowerConsumed_mWh = 0;
     sumDeltaMileage_dm = 0;
+    dataAnalysis_checkpointSave();
 
 }
 
 /******************************************************************************************************
  * @fn      dataAnalysis_sampling
  *
- * @brief   Simulates data obtaining from MCU
+ * @brief   Called by the hf clock callback with the data obtained from the MCU.  The sample is packed into
+ *          the queue and the analytics task is woken; nothing else runs in the callback context.
  *
- * @param   jj
+ * @param   x_hf - sample counter of periodicCommunication (the window position is kept by the task)
+ *          STM32MCP_xxx - latest motor controller data
  *
  * @return  Nil
 ******************************************************************************************************/
-extern void dataAnalysis_sampling(uint8_t x_hf, uint16_t STM32MCP_batteryVoltage, uint16_t STM32MCP_batteryCurrent,
+extern void dataAnalysis_sampling(uint8_t x_hf, uint16_t STM32MCP_batteryVoltage, int16_t STM32MCP_batteryCurrent,
                                   uint16_t STM32MCP_rpm, int8_t STM32MCP_heatsinkTemp, int8_t STM32MCP_motorTemp)
 {
-    dA_Count = x_hf;
-    // Sim RPM
-    *((*ptrRpm)+ dA_Count) = STM32MCP_rpm;                                                    // get RPM from MCU:  unit in rpm,  188 rpm @ r = 0.1016m => 200 cm/sec = 7 km/hr
-    // Cal Speed from RPM
-    *((*ptrSpeed)+ dA_Count) = round(rpm[dA_Count] * 2 * (float) M_PI / 60 * WHEELRADIUS);      // Unit in cm / sec
-    // Sim Battery Current
-    *((*ptrBatteryCurrent)+ dA_Count) = STM32MCP_batteryCurrent;                              // get battery current from MCU:  unit in mA
-    // Sim Battery Voltage
-    *((*ptrBatteryVoltage)+ dA_Count) = STM32MCP_batteryVoltage;                              // get battery voltage from MCU:  unit in mV
-    // Sim Heatsink Temp
-    *((*ptrhst)+ dA_Count) = STM32MCP_heatsinkTemp;                                           // get heat sink temperature from MCU: unit in degrees Celsius
-    // Sim Motor Temp
-    *((*ptrmt)+ dA_Count) = STM32MCP_motorTemp;
+    uint8_t head = queueHead;
+    if (((head + 1) & DATA_ANALYSIS_QUEUE_MASK) == queueTail)
+    {
+        queueOverflow++;                    // task has fallen DATA_ANALYSIS_QUEUE_SIZE - 1 samples behind - drop the newest
+        return;
+    }
+    queue[head].rpm = STM32MCP_rpm;
+    queue[head].batteryVoltage_mV = STM32MCP_batteryVoltage;
+    queue[head].batteryCurrent_mA = STM32MCP_batteryCurrent;
+    queue[head].heatSinkTemperature_C = STM32MCP_heatsinkTemp;
+    queue[head].motorTemperature_C = STM32MCP_motorTemp;
+    queueHead = (head + 1) & DATA_ANALYSIS_QUEUE_MASK;
+    Semaphore_post(Semaphore_handle(&queueSem));
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_process
+ *
+ * @brief   Analytics of one sample, in the analytics task: ring buffer, window integration, speed to the
+ *          App and dashboard and, at the end of each window, dataAnalyt / data2UDArray.
+ *
+ * @param   record - sample taken from the queue
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_process(const SR *record)
+{
+    // The window position is kept here rather than taken from x_hf so the window length can change at run time
+    windowIndex++;
+    dA_Count = windowIndex;
+    sample.rpm = record->rpm;                                                                 // unit in rpm,  188 rpm @ r = 0.1016m => 200 cm/sec = 7 km/hr
+    sample.speed_cmph = dataAnalysis_rpmToSpeed(sample.rpm);                                 // Unit in cm / sec
+    sample.batteryCurrent_mA = record->batteryCurrent_mA;                                     // unit in mA, negative when regen braking
+    sample.batteryVoltage_mV = record->batteryVoltage_mV;                                     // unit in mV
+    sample.heatSinkTemperature_C = record->heatSinkTemperature_C;                             // unit in degrees Celsius
+    sample.motorTemperature_C = record->motorTemperature_C;
+    sample.batteryLevel = dataAnalysis_batteryLevel(sample.batteryVoltage_mV, sample.batteryCurrent_mA);
+    batterySoC_update(sample.batteryCurrent_mA, sample.batteryLevel);
+    tripLog_sample(sample.rpm, brakeAndThrottle_isThrottleEngaged(), sample.speed_cmph, sample.batteryVoltage_mV,
+                   sample.heatSinkTemperature_C, sample.motorTemperature_C);       // before the window it completes is added
+
+    if ((analysisMode == DATA_ANALYSIS_MODE_SLIDING) && (sliding.count >= windowLength))
+    {
+        dataAnalysis_slidingAccumulate(&ring[(ringHead - windowLength) & DATA_ANALYSIS_RING_MASK], -1);     // retire the oldest sample before it can be overwritten
+    }
+    ring[ringHead] = *record;
+    ringHead = (ringHead + 1) & DATA_ANALYSIS_RING_MASK;
+    if (ringCount < DATA_ANALYSIS_RING_SIZE)
+    {
+        ringCount++;
+    }
+    if (analysisMode == DATA_ANALYSIS_MODE_SLIDING)
+    {
+        dataAnalysis_slidingAccumulate(dataAnalysis_getSample(0), 1);
+    }
+
+    dataAnalysis_windowAdd(dA_Count);      // integrate the sample into the running window aggregates
 
     dataAnalysis_LEDSpeed(dA_Count);       // covert speed to the selected dashboard unit (dashSpeed) then sent to led display
 
     dataAnalysis_Main();
+
+    if ((analysisMode == DATA_ANALYSIS_MODE_SLIDING) && (windowIndex != 0))
+    {
+        dataAnalysis_slidingApply();        // at the end of a window dataAnalyt has already applied them and dataAnalysis_Main sent them
+        dataAnalysis_slidingSetGatt();
+    }
 }
 
 /*********************************************************************
@@ -464,7 +969,7 @@ extern void dataAnalysis_sampling(uint8_t x_hf, uint16_t STM32MCP_batteryVoltage
 extern void dataAnalysis_Main()
 {
 
-    if (dA_Count == (DATA_ANALYSIS_POINTS - 1)) // and also when Power OFF // Caution of the case where dA_Count >= DATA_ANALYSIS_POINTS & POWER OFF
+    if (windowIndex >= windowLength)            // and also when Power OFF // Caution of the case where dA_Count >= DATA_ANALYSIS_POINTS & POWER OFF
     {
         // dataAnalyt() carries out all the data analytics
         dataAnalyt();
@@ -526,7 +1031,9 @@ void dataAnalysis_motorcontrol_setGatt()
     motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_TOTAL_ENERGY_CONSUMPTION, CONTROLLER_TOTAL_ENERGY_CONSUMPTION_LEN, (uint8_t *) &ADArray.accumPowerConsumption_mWh);
     motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_INSTANT_ECONOMY, CONTROLLER_INSTANT_ECONOMY_LEN, (uint8_t *) &ADArray.instantEconomy_100Whpk);
     motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_TOTAL_ENERGY_EFFICIENCY, CONTROLLER_TOTAL_ENERGY_EFFICIENCY_LEN, (uint8_t *) &ADArray.economy_100Whpk);
-    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_RANGE, CONTROLLER_RANGE_LEN, (uint8_t *) &ADArray.range_m);
+    uint8_t rangeReport[RANGE_PREDICTOR_REPORT_LEN];
+    rangePredictor_getReport(&rangePrediction, rangeReport);
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_RANGE, CONTROLLER_RANGE_LEN, rangeReport);
     motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_CO2SAVED, CONTROLLER_CO2SAVED_LEN, (uint8_t *) &ADArray.co2Saved_g);
     motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_MOTOR_TEMPERATURE, CONTROLLER_MOTOR_TEMPERATURE_LEN, (uint8_t *) &ADArray.motorTemperature_C);
 
@@ -551,27 +1058,365 @@ void dataAnalysis_motorcontrol_setGatt()
 
 }
 
+/******************************************************************************************************
+ * @fn      dataAnalysis_windowStart
+ *
+ * @brief   Start a new window with the latest sample as its sample 0 (Simpson's coefficient 1)
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_windowStart()
+{
+    int32_t tempholder = ((int32_t) sample.batteryVoltage_mV * sample.batteryCurrent_mA) / 10000;  // required to avoid possible byte size limitation issue
+    window.energySum = tempholder;
+    window.regenEnergySum = (tempholder < 0) ? (uint32_t) (-tempholder) : 0;
+    window.distanceSum = sample.speed_cmph;
+    window.sumBatteryVoltage_mV = sample.batteryVoltage_mV;
+    window.sumBatteryLevel = sample.batteryLevel;
+    window.sumHeatSinkTemperature_C = sample.heatSinkTemperature_C;
+    window.sumMotorTemperature_C = sample.motorTemperature_C;
+    window.count = 1;
+    window.minBatteryVoltage_mV = sample.batteryVoltage_mV;
+    window.maxBatteryVoltage_mV = sample.batteryVoltage_mV;
+    window.maxBatteryCurrent_mA = sample.batteryCurrent_mA;
+    window.maxHeatSinkTemperature_C = sample.heatSinkTemperature_C;
+    window.maxMotorTemperature_C = sample.motorTemperature_C;
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_windowAdd
+ *
+ * @brief   Integrate the latest sample into the window: O(1) per sample, no pass over stored samples.
+ *          Energy and distance are weighted by the Simpson's 1/3 rule coefficient of the sample position.
+ *          The averages and extrema exclude the last sample (index windowLength), which becomes
+ *          sample 0 of the next window.
+ *
+ * @param   index - position of the sample in the window, 1 to windowLength
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_windowAdd(uint8_t index)
+{
+    int32_t tempholder = ((int32_t) sample.batteryVoltage_mV * sample.batteryCurrent_mA) / 10000;  // required to avoid possible byte size limitation issue
+    uint8_t coefficient = (index >= windowLength) ? 1 : coefficient_array[index];
+    window.energySum += coefficient * tempholder;
+    if (tempholder < 0){
+        window.regenEnergySum += coefficient * (uint32_t) (-tempholder);
+    }
+    window.distanceSum += coefficient * sample.speed_cmph;
+
+    if (index >= windowLength){
+        return;
+    }
+    window.sumBatteryVoltage_mV += sample.batteryVoltage_mV;
+    window.sumBatteryLevel += sample.batteryLevel;
+    window.sumHeatSinkTemperature_C += sample.heatSinkTemperature_C;
+    window.sumMotorTemperature_C += sample.motorTemperature_C;
+    window.count++;
+    if (sample.batteryVoltage_mV < window.minBatteryVoltage_mV){
+        window.minBatteryVoltage_mV = sample.batteryVoltage_mV;
+    }
+    if (sample.batteryVoltage_mV > window.maxBatteryVoltage_mV){
+        window.maxBatteryVoltage_mV = sample.batteryVoltage_mV;
+    }
+    if (sample.batteryCurrent_mA > window.maxBatteryCurrent_mA){
+        window.maxBatteryCurrent_mA = sample.batteryCurrent_mA;
+    }
+    if (sample.heatSinkTemperature_C > window.maxHeatSinkTemperature_C){
+        window.maxHeatSinkTemperature_C = sample.heatSinkTemperature_C;
+    }
+    if (sample.motorTemperature_C > window.maxMotorTemperature_C){
+        window.maxMotorTemperature_C = sample.motorTemperature_C;
+    }
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_batteryLevel
+ *
+ * @brief   Battery level of a sample in %, compensated for the voltage drop under load
+ *
+ * @param   batteryVoltage_mV - battery voltage in mV
+ *          batteryCurrent_mA - battery current in mA
+ *
+ * @return  battery level in %, at most 100
+******************************************************************************************************/
+static int16_t dataAnalysis_batteryLevel(uint16_t batteryVoltage_mV, int16_t batteryCurrent_mA)
+{
+    // (V - Vmin) x 100 / ((Vmax - I x VOLTAGE_DROP_COEFFICIENT) - Vmin), both sides scaled by 1000 so the
+    // coefficient is an exact integer (0.269 -> 269) and the truncated quotient equals the float one
+    int32_t denominator = (BATTERY_MAX_VOLTAGE - BATTERY_MIN_VOLTAGE) * 1000 - (int32_t) batteryCurrent_mA * (int32_t) FIXEDPOINT_ROUND(VOLTAGE_DROP_COEFFICIENT * 1000);
+    if (denominator <= 0)
+    {
+        return 100;                             // voltage drop larger than the battery span - unrealistic current
+    }
+    // |V - Vmin| x 100000 fits 32 bits for any uint16_t voltage, so this is one hardware divide, truncated towards zero
+    int16_t instantBatteryLevel;
+    if (batteryVoltage_mV >= BATTERY_MIN_VOLTAGE)
+    {
+        instantBatteryLevel = ((uint32_t) (batteryVoltage_mV - BATTERY_MIN_VOLTAGE) * 100000) / (uint32_t) denominator;
+    }
+    else
+    {
+        instantBatteryLevel = -(int32_t) (((uint32_t) (BATTERY_MIN_VOLTAGE - batteryVoltage_mV) * 100000) / (uint32_t) denominator);
+    }
+    if(instantBatteryLevel > 100)
+    {
+        instantBatteryLevel = 100;              // battery % cannot be greater than 100%
+    }
+    return instantBatteryLevel;
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_rpmToSpeed
+ *
+ * @brief   Wheel speed from motor rpm: rpm x 2 x PI / 60 x WHEELRADIUS, as an integer multiply by the
+ *          factor scaled by 2^DATA_ANALYSIS_SPEED_SHIFT at build time.  The result equals the correctly
+ *          rounded real value for every rpm up to 61000 (the uint16_t cm/sec limit is 61597 rpm).
+ *
+ * @param   rpm - motor speed in rpm
+ *
+ * @return  speed in cm/sec, rounded
+******************************************************************************************************/
+static uint16_t dataAnalysis_rpmToSpeed(uint16_t rpm)
+{
+    return (uint16_t) fixedPoint_roundShift((int64_t) rpm * FIXEDPOINT_QN(2 * FIXEDPOINT_PI / 60 * WHEELRADIUS, DATA_ANALYSIS_SPEED_SHIFT), DATA_ANALYSIS_SPEED_SHIFT);
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_windowStats
+ *
+ * @brief   Fused window statistics kernel: every mean, extremum and the state of charge estimate of the
+ *          window in one pass over the packed window aggregates.  A full window divides by the
+ *          compile time reciprocal of its length; a partial window (start up) falls back to a division.
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_windowStats()
+{
+    stats.count = window.count;
+    if (window.count < 1)
+    {
+        return;                             // not possible - a window always holds its sample 0
+    }
+    stats.avgBatteryVoltage_mV = dataAnalysis_windowMean(window.sumBatteryVoltage_mV, 1);
+    stats.minBatteryVoltage_mV = window.minBatteryVoltage_mV;
+    stats.maxBatteryVoltage_mV = window.maxBatteryVoltage_mV;
+    stats.avgBatteryLevel = dataAnalysis_windowMean(window.sumBatteryLevel, 1);
+    stats.maxBatteryCurrent_mA = window.maxBatteryCurrent_mA;
+    stats.avgHeatSinkTemperature_C = dataAnalysis_windowMean(window.sumHeatSinkTemperature_C, 0);
+    stats.maxHeatSinkTemperature_C = window.maxHeatSinkTemperature_C;
+    stats.avgMotorTemperature_C = dataAnalysis_windowMean(window.sumMotorTemperature_C, 0);
+    stats.maxMotorTemperature_C = window.maxMotorTemperature_C;
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_windowMean
+ *
+ * @brief   sum / window.count, truncated towards zero or rounded half away from zero.
+ *          For a full window the division is a multiply by DATA_ANALYSIS_WINDOW_RECIP(_2N), exact for
+ *          |sum| up to DATA_ANALYSIS_WINDOW_SUM_MAX.
+ *
+ * @param   sum     - window sum
+ *          rounded - 1: round half away from zero, 0: truncate
+ *
+ * @return  mean
+******************************************************************************************************/
+static int32_t dataAnalysis_windowMean(int32_t sum, uint8_t rounded)
+{
+    uint32_t magnitude = (sum < 0) ? (uint32_t) -sum : (uint32_t) sum;
+    uint32_t mean;
+    if (window.count == DATA_ANALYSIS_WINDOW_LEN)
+    {
+        mean = rounded ? fixedPoint_divRecip(2 * magnitude + DATA_ANALYSIS_WINDOW_LEN, DATA_ANALYSIS_WINDOW_RECIP_2N)
+                       : fixedPoint_divRecip(magnitude, DATA_ANALYSIS_WINDOW_RECIP);
+    }
+    else
+    {
+        mean = rounded ? fixedPoint_divRound(magnitude, window.count) : magnitude / window.count;
+    }
+    return (sum < 0) ? -(int32_t) mean : (int32_t) mean;
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_slidingAccumulate
+ *
+ * @brief   Add a sample to, or retire a sample from, the sliding window running sums - O(1)
+ *
+ * @param   record - packed sample
+ *          sign   - 1 to add, -1 to retire
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_slidingAccumulate(const SR *record, int8_t sign)
+{
+    int32_t power = ((int32_t) record->batteryVoltage_mV * record->batteryCurrent_mA) / 10000;
+    int16_t level = dataAnalysis_batteryLevel(record->batteryVoltage_mV, record->batteryCurrent_mA);
+    if (sign > 0)
+    {
+        sliding.powerSum += power;
+        sliding.speedSum += dataAnalysis_rpmToSpeed(record->rpm);
+        sliding.sumBatteryVoltage_mV += record->batteryVoltage_mV;
+        sliding.sumBatteryLevel += level;
+        sliding.sumHeatSinkTemperature_C += record->heatSinkTemperature_C;
+        sliding.sumMotorTemperature_C += record->motorTemperature_C;
+        sliding.count++;
+    }
+    else
+    {
+        sliding.powerSum -= power;
+        sliding.speedSum -= dataAnalysis_rpmToSpeed(record->rpm);
+        sliding.sumBatteryVoltage_mV -= record->batteryVoltage_mV;
+        sliding.sumBatteryLevel -= level;
+        sliding.sumHeatSinkTemperature_C -= record->heatSinkTemperature_C;
+        sliding.sumMotorTemperature_C -= record->motorTemperature_C;
+        sliding.count--;
+    }
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_slidingRebuild
+ *
+ * @brief   Recompute the sliding window running sums from the latest window length samples in the ring.
+ *          Called when the mode or the window length changes - O(window length), once.
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_slidingRebuild()
+{
+    uint8_t age;
+    memset(&sliding, 0, sizeof(sliding));
+    for (age = 0; (age < windowLength) && (age < ringCount); age++)
+    {
+        dataAnalysis_slidingAccumulate(dataAnalysis_getSample(age), 1);
+    }
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_slidingApply
+ *
+ * @brief   Refresh the display values in ADArray from the sliding window.
+ *          Means are rounded as in batch mode.  Instant economy is power over speed:
+ *          W-hr/km x 100 = sum(mV x mA / 10000) x 1000 / (sum(cm/s) x 36).
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_slidingApply()
+{
+    uint32_t handler;
+    if (sliding.count < 1)
+    {
+        return;
+    }
+    ADArray.avgSpeed_kph = fixedPoint_divRound(sliding.speedSum * 36, (uint32_t) sliding.count * 1000);
+    ADArray.avgBatteryVoltage_mV = fixedPoint_divRound(sliding.sumBatteryVoltage_mV, sliding.count);
+    ADArray.batteryPercentage = computeBatteryPercentage();
+    ADArray.batteryStatus = determineBatteryStatus();
+    ADArray.avgHeatSinkTemperature_C = sliding.sumHeatSinkTemperature_C / sliding.count;
+    ADArray.motorTemperature_C = sliding.sumMotorTemperature_C / sliding.count;
+    if (sliding.speedSum == 0)
+    {
+        ADArray.instantEconomy_100Whpk = 65535;
+    }
+    else
+    {
+        handler = (sliding.powerSum > 0) ? ((uint32_t) sliding.powerSum * 1000) / (sliding.speedSum * 36) : 0;
+        ADArray.instantEconomy_100Whpk = (handler > 65535) ? 65535 : handler;
+    }
+    avgBatteryVoltage_mV = ADArray.avgBatteryVoltage_mV;
+    batteryPercentage = ADArray.batteryPercentage;
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_slidingSetGatt
+ *
+ * @brief   Send the display values refreshed by the sliding window to the dashboard and the App
+ *
+ * @param   Nil
+ *
+ * @return  Nil
+******************************************************************************************************/
+static void dataAnalysis_slidingSetGatt()
+{
+    ledControl_setBatteryStatus(ADArray.batteryStatus);
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_HEAT_SINK_TEMPERATURE, CONTROLLER_HEAT_SINK_TEMPERATURE_LEN, (uint8_t *) &ADArray.avgHeatSinkTemperature_C);
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_INSTANT_ECONOMY, CONTROLLER_INSTANT_ECONOMY_LEN, (uint8_t *) &ADArray.instantEconomy_100Whpk);
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_MOTOR_TEMPERATURE, CONTROLLER_MOTOR_TEMPERATURE_LEN, (uint8_t *) &ADArray.motorTemperature_C);
+    motorcontrol_setGatt(BATTERY_SERV_UUID, BATTERY_BATTERY_VOLTAGE, BATTERY_BATTERY_VOLTAGE_LEN, (uint8_t *) &ADArray.avgBatteryVoltage_mV);
+    motorcontrol_setGatt(BATTERY_SERV_UUID, BATTERY_BATTERY_LEVEL, BATTERY_BATTERY_LEVEL_LEN, (uint8_t *) &ADArray.batteryPercentage);
+    motorcontrol_setGatt(BATTERY_SERV_UUID, BATTERY_BATTERY_STATUS, BATTERY_BATTERY_STATUS_LEN, (uint8_t *) &ADArray.batteryStatus);
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_getWindowStats
+ *
+ * @brief   Statistics of the last completed window
+ *
+ * @param   Nil
+ *
+ * @return  pointer to the window statistics
+******************************************************************************************************/
+const WS *dataAnalysis_getWindowStats()
+{
+    return &stats;
+}
+
+/******************************************************************************************************
+ * @fn      dataAnalysis_getWindow
+ *
+ * @brief   Aggregates (sums, count and extrema) of the last completed window
+ *
+ * @param   Nil
+ *
+ * @return  pointer to the window aggregates
+******************************************************************************************************/
+const WD *dataAnalysis_getWindow()
+{
+    return &windowPrev;
+}
+
 /***************************************************************************************************
  * @fn      computePowerConsumption
  *
  * @brief   This function calculates the change in power consumption of the e_scooter
- *          over the time interval using Simpson's 1/3 Rule
+ *          over the time interval using Simpson's 1/3 Rule, from the sums integrated as each sample arrived.
+ *          Battery current is negative while regen braking, so the result is the net energy drawn from the battery.
+ *          The energy recovered (negative power samples only) is integrated separately into deltaRegenEnergy_mWh.
  *
  * @param   AccumPowerConsumed
  *
- * @return  energy consumption value (unit milli W-hr) in type: uint32_t
+ * @return  net energy consumption value (unit milli W-hr) in type: int32_t
 ******************************************************************************************************/
-uint32_t computePowerConsumption()
+int32_t computePowerConsumption()
 {
-    uint32_t deltaPowerConsumption_mWh = 0;
-    for(uint8_t ii = 0; ii < DATA_ANALYSIS_POINTS; ii++){
-        uint32_t tempholder = (batteryVoltage_mV[ii] * batteryCurrent_mA[ii]) * 0.0001;         // required to avoid possible byte size limitation issue
-        deltaPowerConsumption_mWh += (*((*ptrc)+ ii)) * tempholder;
-    }
-    deltaPowerConsumption_mWh = round((float) deltaPowerConsumption_mWh / 3000 * DATA_ANALYSIS_SAMPLING_TIME / 3600);       // output in milli-W-hr
+    int32_t deltaPowerConsumption_mWh;
+    // sum x T / 3000 / 3600 as a multiply by energyRatio_q32: within 0.75 mW-hr of the exact value
+    deltaRegenEnergy_mWh = fixedPoint_mulRecipRound((int32_t) window.regenEnergySum, energyRatio_q32);                        // output in milli-W-hr
+    deltaPowerConsumption_mWh = fixedPoint_mulRecipRound(window.energySum, energyRatio_q32);                                 // output in milli-W-hr
     return deltaPowerConsumption_mWh;   //  -> convert to the desired unit before displaying on App
 }
 
+/***************************************************************************************************
+ * @fn      dataAnalysis_getRegenEnergy
+ *
+ * @brief   Energy recovered by the regen brake since power on
+ *
+ * @param   Nil
+ *
+ * @return  recovered energy (unit milli W-hr)
+******************************************************************************************************/
+uint32_t dataAnalysis_getRegenEnergy()
+{
+    return totalRegenEnergy_mWh;
+}
+
 /***************************************************************************************************
  * @fn      computeDistanceTravelled
  *
@@ -584,11 +1429,8 @@ uint32_t computePowerConsumption()
 ******************************************************************************************************/
 uint32_t computeDistanceTravelled()
 {
-    uint32_t deltaDistanceTravelled_dm = 0;
-    for(uint8_t ii = 0; ii < DATA_ANALYSIS_POINTS; ii++){
-         deltaDistanceTravelled_dm += ((*((*ptrc) + ii)) * speed_cmph[ii]);            // for computational accuracy reasons, calculations are performed in centimeter/second
-    }
-    deltaDistanceTravelled_dm = round((float) deltaDistanceTravelled_dm * DATA_ANALYSIS_SAMPLING_TIME / 30000);          // output is then converted to decimeter
+    uint32_t deltaDistanceTravelled_dm;                                                 // for computational accuracy reasons, the sum is in centimeter/second
+    deltaDistanceTravelled_dm = fixedPoint_mulRecipRound((int32_t) window.distanceSum, distanceRatio_q32);              // output is then converted to decimeter, within 0.51 dm
     return deltaDistanceTravelled_dm; // -> convert to the desired unit before displaying on App
 }
 
@@ -604,11 +1446,11 @@ uint32_t computeDistanceTravelled()
 uint8_t computeAvgSpeed(uint32_t deltaMileage_dm)
 {
     static uint8_t avgSpeed_kph = 0;                    // output in km/hr
-    if (dA_Count < 1) {                                   // should be impossible to get here
+    if (dA_Count < 2) {                                   // should be impossible to get here
         avgSpeed_kph = 0;
         return avgSpeed_kph;
     }                                                   // Safeguard from stack overflow due to division by 0
-    avgSpeed_kph = round((float)(deltaMileage_dm)/ (DATA_ANALYSIS_SAMPLING_TIME * (dA_Count - 1)) * 360); // output in km/hr
+    avgSpeed_kph = fixedPoint_divRound(deltaMileage_dm * 360, (uint32_t) DATA_ANALYSIS_SAMPLING_TIME * (dA_Count - 1)); // output in km/hr
     return avgSpeed_kph;                                // output rounded off to nearest km/hr
 }
 
@@ -623,21 +1465,16 @@ uint8_t computeAvgSpeed(uint32_t deltaMileage_dm)
 ******************************************************************************************************/
 int8_t computeAvgHeatSinkTemperature()
 {
-    int16_t sumHeatSinkTemperatuer_C = 0; // output in degree celsius
     int8_t avgHeatSinkTemperature_C = 0;
-    for(uint8_t ii = 0; ii < dA_Count; ii++)
-    {
-        sumHeatSinkTemperatuer_C += heatSinkTemperature_C[ii];                             // sum all measurements
-    }
 
-    if (dA_Count < 1)
+    if (stats.count < 1)
     {   // Safeguard from stack overflow due to division by 0
         avgHeatSinkTemperature_C = 0;
         // errorCode = Temperature Error;
         return avgHeatSinkTemperature_C; // output in degree celsius
     }
 
-    avgHeatSinkTemperature_C = round((sumHeatSinkTemperatuer_C)/ dA_Count);
+    avgHeatSinkTemperature_C = stats.avgHeatSinkTemperature_C;
     if (avgHeatSinkTemperature_C > CRIT_HEATSINKTEMPERATURE_C)
     {
         heatSinkOVTempState = HEATSINK_TEMPERATURE_ABNORMAL;  // errorCode = HeatSink_OVTEMP_WARNING_CODE;
@@ -662,22 +1499,16 @@ int8_t computeAvgHeatSinkTemperature()
 ******************************************************************************************************/
 int8_t computeMotorTemperature()
 {
-    int16_t sumMotorTemperature_C = 0; // output in degree celsius
     int8_t avgMotorTemperature_C = 0;
 
-    for(uint8_t ii = 0; ii  < dA_Count; ii++)
-    {
-         sumMotorTemperature_C += motorTemperature_C[ii];                             // sum all measurements
-    }
-
-    if (dA_Count < 1)
+    if (stats.count < 1)
     {   // Safeguard from stack overflow due to division by 0
         avgMotorTemperature_C = 0;
         // errorCode = MOTOR_TEMP_ERROR_CODE;
         return avgMotorTemperature_C; // output in degree celsius
     }
 
-    avgMotorTemperature_C = round((sumMotorTemperature_C) / dA_Count);
+    avgMotorTemperature_C = stats.avgMotorTemperature_C;
 
     if (avgMotorTemperature_C > CRIT_MOTORTEMPERATURE_C)
     {
@@ -701,20 +1532,15 @@ int8_t computeMotorTemperature()
 uint32_t computeAvgBatteryVoltage()
 {
     avgBatteryVoltage_mV = 0;
-    uint32_t    sumBatteryVoltage_mV = 0;
 
-    for(uint8_t ii = 0; ii < dA_Count; ii++)
-    {
-        sumBatteryVoltage_mV += batteryVoltage_mV[ii];                               // Average is in mV
-    }
-    if (dA_Count < 1)    // is not possible to get here -> Safeguard from stack overflow due to division by 0, but dA_Count is always greater than or equal 1
+    if (stats.count < 1)     // is not possible to get here -> Safeguard from stack overflow due to division by 0, but stats.count is always greater than or equal 1
     {
         avgBatteryVoltage_mV = 0;
         //errorCode = batteryError;
         return avgBatteryVoltage_mV;   // Unit in mV
     }
 
-    avgBatteryVoltage_mV = round((float) sumBatteryVoltage_mV / dA_Count);            // output in mV
+    avgBatteryVoltage_mV = stats.avgBatteryVoltage_mV;                                           // output in mV
 
     if (avgBatteryVoltage_mV < BATTERY_CRITICALLY_LOW)
     {
@@ -730,36 +1556,17 @@ uint32_t computeAvgBatteryVoltage()
 /***************************************************************************************************
  * @fn      computeBatteryPercentage
  *
- * @brief   This function computes the battery percentage based on the average battery voltage.
+ * @brief   This function returns the battery percentage from the coulomb counting state of charge
+ *          (batterySoC.c), which is updated at every sample.  The voltage based level only corrects
+ *          it while the battery is at rest, so the percentage does not follow the voltage sag under load.
  *
- * @param   avgBatteryVoltage
+ * @param   None
  *
  * @return  batteryPercentage = battery_battery_level in battery.h
 ******************************************************************************************************/
 uint8_t computeBatteryPercentage()
 {
-    avgBatteryLevel = 0;
-    int16_t     instantBatteryLevel = 0;
-    int16_t     sumBatteryLevel = 0;
-
-    for(uint8_t ii = 0; ii < dA_Count; ii++)
-    {
-        instantBatteryLevel = ( batteryVoltage_mV[ii] - BATTERY_MIN_VOLTAGE) * 100 /((BATTERY_MAX_VOLTAGE - batteryCurrent_mA[ii] * VOLTAGE_DROP_COEFFICIENT) - BATTERY_MIN_VOLTAGE);
-        if(instantBatteryLevel > 100)
-        {
-            instantBatteryLevel = 100;              // battery % cannot be greater than 100%
-        }
-        sumBatteryLevel += instantBatteryLevel;
-    }
-
-    if (dA_Count < 1)   // is not possible to get here -> Safeguard from stack overflow due to division by 0, but dA_Count is always greater than or equal 1
-    {
-        avgBatteryLevel = 0;
-        //errorCode = batteryError;
-        return avgBatteryLevel;   // Unit in mV
-    }
-
-    avgBatteryLevel = round((float) sumBatteryLevel / dA_Count);                      // output in %
+    avgBatteryLevel = batterySoC_getPercent();                                             // output in %
 
     return avgBatteryLevel;              //batteryPercentage_mV;
 }
@@ -800,7 +1607,7 @@ uint16_t computeInstantEconomy(uint32_t deltaPowerConsumption_mWh, uint32_t delt
         instantEconomy_100Whpk = 65535;
         return instantEconomy_100Whpk;
     }                                                       //******** Safeguard from stack overflow due to division by 0
-    handler = (float)(deltaPowerConsumption_mWh * 1000) / deltaMileage_dm;               // unit in W-hr / km x 100
+    handler = (deltaPowerConsumption_mWh * 1000) / deltaMileage_dm;                      // unit in W-hr / km x 100
     if (handler > 65535){                                   // Safeguard from data truncation in case economy is greater than declared variable size
         instantEconomy_100Whpk = 65535;
         return instantEconomy_100Whpk;
@@ -821,12 +1628,17 @@ uint16_t computeInstantEconomy(uint32_t deltaPowerConsumption_mWh, uint32_t delt
 uint16_t computeEconomy()
 {
     uint32_t handler;
+    int32_t netPowerConsumed_mWh;
     uint16_t economy_100Whpk = 0;                            // unit in W-hr / km x 100
     if ((ADArray.accumMileage_dm - totalMileage0_dm) <= 0) { // Safeguard from stack overflow due to division by 0
         economy_100Whpk = 65535;
         return economy_100Whpk;
     }
-    handler = (float)(ADArray.accumPowerConsumption_mWh - totalPowerConsumed0_mWh) * 1000 / (ADArray.accumMileage_dm - totalMileage0_dm);     // Unit in W-hr / km x 100
+    netPowerConsumed_mWh = (int32_t)(ADArray.accumPowerConsumption_mWh - totalPowerConsumed0_mWh);   // regeneration can exceed consumption
+    if (netPowerConsumed_mWh <= 0){                         // Net energy recovered: no consumption, instead of a wrapped difference
+        return economy_100Whpk;
+    }
+    handler = (uint64_t)netPowerConsumed_mWh * 1000 / (ADArray.accumMileage_dm - totalMileage0_dm);  // Unit in W-hr / km x 100
     if (handler > 65535){                                   // Safeguard from data truncation in case economy is greater than declared variable size
         economy_100Whpk = 65535;
         return economy_100Whpk;
@@ -838,20 +1650,18 @@ uint16_t computeEconomy()
 /***************************************************************************************************
  * @fn      computeRange
  *
- * @brief   This function calculates the range remaining in meters
+ * @brief   This function calculates the range remaining in meters from the state of charge and the
+ *          economy predicted for the recent riding conditions (rangePredictor.c).  Until the predictor
+ *          has fitted enough windows the average economy_100Whpk is used.  The band is kept in
+ *          rangePrediction for the Controller range characteristic.
  *
- * @param   batteryCap, avgWhr (in Whr/km)
+ * @param   None
  *
  * @return  Range
 ***************************************************************************************************/
 uint32_t computeRange(){
-    uint32_t range_m = 0;
-    if (ADArray.economy_100Whpk <= 0) {                     // Safeguard from stack overflow due to division by 0
-        range_m = 0;
-        return range_m;                                     // output in meters  -> convert to the desired unit before displaying on App
-    }                                                       // output in meters
-    range_m = ((float) ADArray.batteryPercentage * BATTERY_MAX_CAPACITY * BCF / ADArray.economy_100Whpk );
-    return range_m;                                         // output in metres  -> convert to the desired unit before displaying on App
+    rangePredictor_predict(batterySoC_get(), ADArray.economy_100Whpk, &rangePrediction);
+    return rangePrediction.range_m;                         // output in metres  -> convert to the desired unit before displaying on App
 }
 /******************************************************************************************************
  * @fn      computeCO2Saved
@@ -871,13 +1681,20 @@ uint32_t computeCO2Saved()
         co2Saved_g = 0;                                     // Safeguard from stack overflow due to division by 0
         return co2Saved_g;                                  // in grams -> convert to the desired unit before displaying on App
     }
-    co2Saved_g = ((float) ADArray.accumMileage_dm * 0.10) * (COEFF01 - ((float) (ADArray.accumPowerConsumption_mWh) / (float) (ADArray.accumMileage_dm) * 0.10) * COEFF02);  // in grams
+    // (mileage x 0.10) x (COEFF01 - power / mileage x 0.10 x COEFF02) = mileage x 0.10 x COEFF01 - power x 0.01 x COEFF02, in Q0.32
+    int64_t co2_q32 = (int64_t) ADArray.accumMileage_dm * FIXEDPOINT_Q32(0.10 * COEFF01) - (int64_t) ADArray.accumPowerConsumption_mWh * FIXEDPOINT_Q32(0.01 * COEFF02);
+    if (co2_q32 > 0)
+    {
+        co2Saved_g = (uint32_t) (co2_q32 >> 32);            // in grams, truncated
+    }
     return co2Saved_g;                                      // in grams -> convert to the desired unit before displaying on App
 }
 /***************************************************************************************************
  * @fn      re_Initialize
  *
- * @brief   This function re-initialize the data arrays after each data analysis loop.
+ * @brief   This function starts the next window after each data analysis loop.
+ *          The completed window is kept for dataAnalysis_getWindow and the last sample is carried over
+ *          to position [0] of the new window.
  *
  * @param   none
  *
@@ -885,25 +1702,100 @@ uint32_t computeCO2Saved()
 ******************************************************************************************************/
 extern void re_Initialize()
 {
-    //  Re-initialize arrays after completing each computation loop
-//    for(uint8_t kk = 0; kk < DATA_ANALYSIS_POINTS; kk++){           // carry over the last data set to the 1st position [0] of the new dataset and reset all other to zero
-//        if(kk == 0){
-            *(*(ptrRpm)) = *(*(ptrRpm) + DATA_ANALYSIS_POINTS - 1);
-            *(*(ptrSpeed)) = *(*(ptrSpeed) + DATA_ANALYSIS_POINTS - 1);
-            *(*(ptrBatteryCurrent)) = *(*(ptrBatteryCurrent) + DATA_ANALYSIS_POINTS - 1);
-            *(*(ptrBatteryVoltage)) = *(*(ptrBatteryVoltage) + DATA_ANALYSIS_POINTS - 1);
-            *(*(ptrhst)) = *(*(ptrhst) + DATA_ANALYSIS_POINTS - 1);
-            *(*(ptrmt)) = *(*(ptrmt) + DATA_ANALYSIS_POINTS - 1);
-//        }
-//        else {
-//            *(*(ptrRpm) + kk) = 0;
-//            *(*(ptrSpeed) + kk) = 0;
-//            *(*(ptrBatteryCurrent) + kk) = 0;
-//            *(*(ptrBatteryVoltage) + kk) = 0;
-//            *(*(ptrhst) + kk) = 0;
-//            *(*(ptrmt) + kk) = 0;
-//        }
-//    }
+    windowPrev = window;
+    windowIndex = 0;
+    if (windowLengthNext != windowLength)
+    {
+        windowLength = windowLengthNext;
+        dataAnalysis_slidingRebuild();
+    }
+    dataAnalysis_windowStart();
+}
+
+/*********************************************************************
+ * @fn      dataAnalysis_setWindowLength
+ *
+ * @brief   Change the number of Simpson's intervals per window.  The current window completes at its
+ *          old length; the new length applies from the next window.  Samples already in the ring are kept.
+ *
+ * @param   length - even, DATA_ANALYSIS_WINDOW_LEN_MIN to DATA_ANALYSIS_RING_SIZE
+ *
+ * @return  1 if accepted, 0 if the length is out of range or odd
+ *********************************************************************/
+extern uint8_t dataAnalysis_setWindowLength(uint8_t length)
+{
+    if ((length < DATA_ANALYSIS_WINDOW_LEN_MIN) || (length > DATA_ANALYSIS_RING_SIZE) || (length & 0x01))
+    {
+        return 0;
+    }
+    windowLengthNext = length;
+    return 1;
+}
+
+/*********************************************************************
+ * @fn      dataAnalysis_setMode
+ *
+ * @brief   Select batch or sliding window analysis.  Entering sliding mode rebuilds the running sums from
+ *          the samples already in the ring, so the display values are valid from the next sample.
+ *
+ * @param   mode - DATA_ANALYSIS_MODE_BATCH or DATA_ANALYSIS_MODE_SLIDING
+ *
+ * @return  1 if accepted, 0 for an unknown mode
+ *********************************************************************/
+extern uint8_t dataAnalysis_setMode(uint8_t mode)
+{
+    if ((mode != DATA_ANALYSIS_MODE_BATCH) && (mode != DATA_ANALYSIS_MODE_SLIDING))
+    {
+        return 0;
+    }
+    if (mode != analysisMode)
+    {
+        analysisMode = mode;
+        dataAnalysis_slidingRebuild();
+    }
+    return 1;
+}
+
+/*********************************************************************
+ * @fn      dataAnalysis_getMode
+ *
+ * @brief   Current analysis mode
+ *
+ * @param   None
+ *
+ * @return  DATA_ANALYSIS_MODE_BATCH or DATA_ANALYSIS_MODE_SLIDING
+ *********************************************************************/
+extern uint8_t dataAnalysis_getMode()
+{
+    return analysisMode;
+}
+
+/*********************************************************************
+ * @fn      dataAnalysis_getWindowLength
+ *
+ * @brief   Number of Simpson's intervals in the current window
+ *
+ * @param   None
+ *
+ * @return  window length
+ *********************************************************************/
+extern uint8_t dataAnalysis_getWindowLength()
+{
+    return windowLength;
+}
+
+/*********************************************************************
+ * @fn      dataAnalysis_getSample
+ *
+ * @brief   Read a sample from the ring buffer without copying the window
+ *
+ * @param   age - 0 for the latest sample, up to DATA_ANALYSIS_RING_SIZE - 1
+ *
+ * @return  pointer to the packed sample
+ *********************************************************************/
+extern const SR *dataAnalysis_getSample(uint8_t age)
+{
+    return &ring[(ringHead - 1 - age) & DATA_ANALYSIS_RING_MASK];
 }
 
 /*********************************************************************
@@ -930,16 +1822,17 @@ extern uint8_t dataAnalysis_getUnitSelectDash(){
  *********************************************************************/
 extern void dataAnalysis_changeUnitSelectDash(uint8_t unit){
     UnitSelectDash = unit;
+    configStore_set(CONFIG_STORE_KEY_DASH_UNIT, unit);
     switch(UnitSelectDash)
     {
     case SI_UNIT:
         {
-            lenConvFactorDash = 1;
+            dashUnit = &dashUnitTable[SI_UNIT];
             break;
         }
     case IMP_UNIT:
         {
-            lenConvFactorDash = KM2MILE;
+            dashUnit = &dashUnitTable[IMP_UNIT];
             break;
         }
     default:
@@ -1030,23 +1923,9 @@ void dummyUDArray()
                 UDBuffer[25] = 0;        // Free
                 UDBuffer[26] = 0;        // Free
                 UDBuffer[27] = 0;        // Free
-                UDBuffer[28] = 1;        // speed mode {0 = Amble, 1 = Leisure, 2 = Sports}
-                UDBuffer[29] = 0;        // dashboard unit {0 = kmph, 1 = mph}
-                UDBuffer[30] = 2;        // light mode {0 = Off, 1 = On, 2 = Auto}
+                UDBuffer[28] = 0;        // Free (speed mode, dashboard unit and light mode are in configStore)
+                UDBuffer[29] = 0;        // Free
+                UDBuffer[30] = 0;        // Free
                 UDBuffer[31] = 0;        // Free
 
 }
-
-/*********************************************************************
- * @fn      dataAnalysis_registerNVSINT
- *
- * @brief   It is used to register the NVS internal function
- *
- * @param   None
- *
- * @return  None
- *********************************************************************/
-void dataAnalysis_registerNVSINT( dataAnalysis_NVS_Manager_t *nvsManager )
-{
-    dataAnalysis_NVSManager = nvsManager;
-}
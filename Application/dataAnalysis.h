@@ -17,9 +17,18 @@ extern "C"
 #include <stdlib.h>
 #include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/knl/Task.h>
+#include "rangePredictor.h"
 
 //Constants
-#define DATAANALYSIS_TASK_PRIORITY      6
+// Analytics run below the BLE stack (5), GAP role (3), general purpose timer (4) and application (2) tasks,
+// so any of them can pre-empt a window evaluation
+#define DATAANALYSIS_TASK_PRIORITY      1
+#ifndef DATAANALYSIS_TASK_STACK_SIZE
+#define DATAANALYSIS_TASK_STACK_SIZE    768             // efficiency map report (198 B) is built on the task stack
+#endif
+// Sample queue from the hf clock callback to the analytics task - power of two, one slot is kept empty
+#define DATA_ANALYSIS_QUEUE_SIZE        8
+#define DATA_ANALYSIS_QUEUE_MASK        (DATA_ANALYSIS_QUEUE_SIZE - 1)
 /*********************************************************************************************
  *  NVS Data Information
  *********************************************************************************************/
@@ -30,6 +39,13 @@ extern "C"
 // Note:    Data Analysis Interval = (DATA_ANALYSIS_POINTS - 1) x DATA_ANALYSIS_SAMPLING_TIME
 //          Averge_economy refresh interval =  Data Analysis Interval x UDTRIGGER
 //          Total time interval stored in memory = Averge_economy refresh interval x UDARRAYSIZE
+//          The shared record log (writeBehind) keeps every save as a usageHistory entry (at most 21 bytes), and
+//          a UDBuffer image each time the sector holding the history is about to be erased.
+//          A log sector takes about 2860 bytes of new records before the other one is erased (4088 bytes, less
+//          1228 kept for the records carried over).  Riding writes about 750 bytes per save (usage entry, usage
+//          rollups 324, efficiency map 392) and every power off about 700 (checkpoint, snapshot, rollups, trip,
+//          settings): a sector is erased every 23 minutes of riding, or every 4 power offs.  The log holds the
+//          newest UDBuffer image (UDARRAYSIZE saves) and the entries after it: at least 13 saves while riding.
 // Option 1:  (21-1) x 400ms = 8000ms.  8000ms x 45 = 360000ms = 6 minutes. 6 minutes x 20 = 120 minutes = 2 hours
 // Option 2:  (13-1) x 400ms = 4800ms.  4800ms x 75 = 360000ms = 6 minutes. 6 minutes x 10 = 60 minutes
 // Option 3:  (13-1) x 400ms = 4800ms.  4800ms x 125 = 600000ms = 10 minutes. 10 minutes x 6 = 60 minutes = 1 hour
@@ -38,6 +54,7 @@ extern "C"
  *  Vehicle Information
  *********************************************************************************************/
 #define WHEELRADIUS                     10.16           // wheel radius in centimeter
+#define DATA_ANALYSIS_SPEED_SHIFT       30              // fraction bits of the build time rpm to cm/sec factor
 #define COEFF01                         0.2156          // kg/km
 #define COEFF02                         0.000386        // kg/W-hr
 #define BCF                             0.9             // Battery Capacity Safety Factor
@@ -51,6 +68,10 @@ extern "C"
 #define KG2LBS                          2.205           // convert kilogram to pounds
 #define SI_UNIT                         0x00
 #define IMP_UNIT                        0x01
+// cm/sec -> dashboard speed = floor(speed x num / den), as (speed x mul) >> DATA_ANALYSIS_DASH_SPEED_SHIFT with
+// mul = ceil(2^shift x num / den).  Bit-exact for every uint16_t speed while 2^shift >= 65536 x den (den in lowest terms).
+#define DATA_ANALYSIS_DASH_SPEED_SHIFT  34
+#define DATA_ANALYSIS_DASH_SPEED_MUL(num, den)  ((uint32_t) ((((uint64_t) (num) << DATA_ANALYSIS_DASH_SPEED_SHIFT) + (den) - 1) / (den)))
 /*********************************************************************************************
  *  Battery Status Constants
  *********************************************************************************************/
@@ -93,6 +114,12 @@ extern "C"
 #define MOTORCONTROLERRORID             5
 
 //typedef
+// Build time conversion constants of a dashboard display unit - the selected unit is a pointer into a const table
+typedef struct dashUnit{
+        uint8_t  unit;                                  // SI_UNIT or IMP_UNIT
+        uint32_t speedMul;                              // cm/sec -> km/hr or mph, see DATA_ANALYSIS_DASH_SPEED_MUL
+}DU;
+
 // This set of data is stored in ram, and to be stored in flash (NVS) memory
 typedef struct usageData{
         uint32_t UDCounter;                             // to Cloud - require device parameters
@@ -100,6 +127,16 @@ typedef struct usageData{
         uint32_t totalMileage_dm;                       // to Cloud, App display input - require device parameters
 }UD;
 
+// Progress since the last UDBuffer save, written at power off.  A sudden power loss costs at most UDTRIGGER windows.
+typedef struct usageCheckpoint{
+        uint32_t UDDataCounter;                         // UDBuffer save the deltas follow - ignored if it is not the restored one
+        uint32_t ADDataCounter;
+        uint32_t sumDeltaMileage_dm;
+        uint32_t sumDeltaPowerConsumed_mWh;
+        uint8_t  UDTriggerCounter;
+        uint8_t  reserved[3];
+}CP;
+
 // This set of data is temporary on the dashboard - this set of data is sent to the APP for displaying when connected with BLE
 typedef struct appData{                                 // is appData needed here??
         uint32_t ADCounter;                             // length = 4 . to Cloud - require device parameters
@@ -118,30 +155,119 @@ typedef struct appData{                                 // is appData needed her
         int8_t motorTemperature_C;                      // temperature can be sub-zero
 }AD;        // 4-4-4-4-4-2-2-2-2-1-1-1-1-1 decreasing byte size minimizes the amount of struct padding
 
+// One motor controller sample, as received at every hf communication interval
+typedef struct sampleData{
+        uint16_t rpm;                                   // revolutions per minute
+        uint16_t speed_cmph;                            // rpm converted to cm per second
+        uint16_t batteryVoltage_mV;
+        int16_t batteryCurrent_mA;                      // negative when regen braking
+        int16_t batteryLevel;                           // voltage based battery level in %, see dataAnalysis_batteryLevel
+        int8_t heatSinkTemperature_C;                   // temperature can be negative
+        int8_t motorTemperature_C;                      // temperature can be negative
+}SD;
+
+// Analytics state at power off.  Restored at start up only if it follows the restored usage data and checkpoint,
+// so the dashboard and the App show the last values on the first frame instead of after the first window.
+typedef struct analyticsSnapshot{
+        uint32_t UDDataCounter;                         // usage data save and window the snapshot was taken at -
+        uint32_t ADDataCounter;                         // ignored if they are not the restored ones
+        AD ADArray;                                     // values displayed and sent to the App
+        rangePredictor_range_t rangePrediction;
+        SD sample;                                      // last sample - sample 0 of the first window
+        uint8_t batteryLow;
+        uint8_t reserved[3];
+}SS;
+
+// Sample ring buffer: the latest DATA_ANALYSIS_RING_SIZE packed samples (power of two).  The window length
+// (Simpson's intervals) can be changed at run time between DATA_ANALYSIS_WINDOW_LEN_MIN and the ring size.
+#define DATA_ANALYSIS_RING_SIZE         16
+#define DATA_ANALYSIS_RING_MASK         (DATA_ANALYSIS_RING_SIZE - 1)
+#define DATA_ANALYSIS_WINDOW_LEN_MIN    2
+
+// Analysis modes.  Batch: display values refresh once per window.  Sliding: display values (average speed,
+// battery voltage / level / status, temperatures, instant economy) refresh every sample from running sums over
+// the latest window length samples.  Energy and distance totals always use the batch Simpson's integration.
+#define DATA_ANALYSIS_MODE_BATCH        0x00
+#define DATA_ANALYSIS_MODE_SLIDING      0x01
+#ifndef DATA_ANALYSIS_MODE_DEFAULT
+#define DATA_ANALYSIS_MODE_DEFAULT      DATA_ANALYSIS_MODE_BATCH
+#endif
+
+// Samples in the full length window averages, and the reciprocals used to divide by it (see fixedPoint_divRecip).
+// A multiply by the reciprocal is exact while the sum stays within DATA_ANALYSIS_WINDOW_SUM_MAX.
+#define DATA_ANALYSIS_WINDOW_LEN        (DATA_ANALYSIS_POINTS - 1)
+#define DATA_ANALYSIS_WINDOW_RECIP      FIXEDPOINT_RECIP32(DATA_ANALYSIS_WINDOW_LEN)
+#define DATA_ANALYSIS_WINDOW_RECIP_2N   FIXEDPOINT_RECIP32(2 * DATA_ANALYSIS_WINDOW_LEN)       // rounded mean: (2 x sum + N) / 2N
+#define DATA_ANALYSIS_WINDOW_SUM_MAX    ((0xFFFFFFFFUL / (4 * DATA_ANALYSIS_WINDOW_LEN)) - DATA_ANALYSIS_WINDOW_LEN)
+
+// Packed sample record stored in the ring buffer - 8 bytes.  Speed is not stored, it is derived from rpm.
+typedef struct sampleRecord{
+        uint32_t rpm                    : 16;
+        uint32_t batteryVoltage_mV      : 16;
+        int32_t  batteryCurrent_mA      : 16;           // negative when regen braking
+        int32_t  heatSinkTemperature_C  : 8;
+        int32_t  motorTemperature_C     : 8;
+}SR;
+
+// Running aggregates of the current analysis window, updated as each sample arrives.
+// The window holds sample 0 (carried over from the previous window) to sample N, N being the window length.
+// Energy and distance are Simpson's 1/3 rule weighted sums over all samples; the averages are taken over
+// samples 0 to N - 1, i.e. the last sample is left to the next window.
+typedef struct windowData{
+        int32_t energySum;                              // sum of coefficient x (mV x mA / 10000), net of regen
+        uint32_t regenEnergySum;                        // sum of coefficient x (mV x mA / 10000), regen samples only
+        uint32_t distanceSum;                           // sum of coefficient x cm/s
+        uint32_t sumBatteryVoltage_mV;
+        int32_t sumBatteryLevel;                        // sum of the per sample battery level in %
+        int16_t sumHeatSinkTemperature_C;
+        int16_t sumMotorTemperature_C;
+        uint16_t count;                                 // number of samples in the sums
+        uint16_t minBatteryVoltage_mV;
+        uint16_t maxBatteryVoltage_mV;
+        int16_t maxBatteryCurrent_mA;
+        int8_t maxHeatSinkTemperature_C;
+        int8_t maxMotorTemperature_C;
+}WD;
+
+// Running sums of the sliding window: the latest sample is added and the sample leaving the window retired
+typedef struct slidingData{
+        int32_t powerSum;                               // sum of mV x mA / 10000
+        uint32_t speedSum;                              // sum of cm/s
+        uint32_t sumBatteryVoltage_mV;
+        int32_t sumBatteryLevel;                        // sum of the per sample battery level in %
+        int16_t sumHeatSinkTemperature_C;
+        int16_t sumMotorTemperature_C;
+        uint8_t count;                                  // samples in the sums, up to the window length
+}SLD;
+
+// Statistics of a window, finalised in one pass over the window aggregates
+typedef struct windowStats{
+        uint16_t count;                                 // samples in the averages
+        uint16_t avgBatteryVoltage_mV;                  // rounded mean
+        uint16_t minBatteryVoltage_mV;
+        uint16_t maxBatteryVoltage_mV;
+        int16_t  avgBatteryLevel;                       // state of charge estimate in %, rounded mean of the load compensated level
+        int16_t  maxBatteryCurrent_mA;
+        int8_t   avgHeatSinkTemperature_C;              // truncated mean
+        int8_t   maxHeatSinkTemperature_C;
+        int8_t   avgMotorTemperature_C;                 // truncated mean
+        int8_t   maxMotorTemperature_C;
+}WS;
+
 /*********************************************************************
 * MACROS
 */
-typedef void (*dataAnalysis_NVS_Open)( void );
-typedef void (*dataAnalysis_NVS_Erase)( void );
-typedef void (*dataAnalysis_NVS_Write)( size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize );
-typedef void (*dataAnalysis_NVS_Read)( size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize );
-typedef void (*dataAnalysis_NVS_Close)( void );
-
-typedef struct
-{
-    dataAnalysis_NVS_Open   NVSOpen;
-    dataAnalysis_NVS_Erase  NVSErase;
-    dataAnalysis_NVS_Write  NVSWrite;
-    dataAnalysis_NVS_Read   NVSRead;
-    dataAnalysis_NVS_Close  NVSClose;
-}dataAnalysis_NVS_Manager_t;
 
 /*********************************************************************
  * API FUNCTIONS
  */
-extern void dataAnalysis_registerNVSINT( dataAnalysis_NVS_Manager_t *nvsManager );
+extern void dataAnalysis_powerOff( void );
 
 static void dataAnalysis_taskFxn(UArg a0, UArg a1);
+/* Task creation function for the data analytics */
+extern void dataAnalysis_createTask(void);
+extern uint32_t dataAnalysis_getProcessMaxUs( void );
+extern uint16_t dataAnalysis_getQueueOverflow( void );
 
 //Battery status related Function declaration
 extern uint8_t computeBatteryPercentage( void );
@@ -154,8 +280,14 @@ extern void dataAnalysis_changeUnitSelectDash( uint8_t unit );
 
 //Global Functions declaration
 extern void dataAnalysis_init( void );
-extern uint8_t coefficient_array_init( void );
 extern void dataAnalysis_LEDSpeed(uint16_t xCounter);
+extern const WD *dataAnalysis_getWindow( void );
+extern const WS *dataAnalysis_getWindowStats( void );
+extern const SR *dataAnalysis_getSample(uint8_t age);
+extern uint8_t dataAnalysis_setWindowLength(uint8_t length);
+extern uint8_t dataAnalysis_getWindowLength( void );
+extern uint8_t dataAnalysis_setMode(uint8_t mode);
+extern uint8_t dataAnalysis_getMode( void );
 
 extern uint8_t dataAnalysis_getSpeedModeInit( void );
 extern uint8_t dataAnalysis_getDashUnitInit( void );
@@ -173,11 +305,12 @@ void dataAnalysis_motorcontrol_setGatt(void);
 extern void dataAnalysis_timerInterruptHandler( void );
 
 extern void dummyUDArray( void );
-extern void dataAnalysis_NVSRead( void );
+extern uint8_t dataAnalysis_NVSRead( void );
 extern void dataAnalysis_NVSWrite( void );
 
 //Performance related Function declaration
-extern uint32_t computePowerConsumption( void ); // output in mW-hr
+extern int32_t computePowerConsumption( void ); // output in mW-hr, net of regen (negative when more energy is recovered than used)
+extern uint32_t dataAnalysis_getRegenEnergy( void ); // output in mW-hr
 extern uint32_t computeDistanceTravelled( void );// output in decimeter
 extern uint8_t computeAvgSpeed(uint32_t deltaMileage_dm);   // output in km/hr
 extern int8_t computeAvgHeatSinkTemperature( void );         // output in degrees celsius
@@ -188,7 +321,7 @@ extern uint32_t computeRange( void ); // output in metres
 extern uint32_t computeCO2Saved( void ); // in g
 extern int8_t computeMotorTemperature( void ); // in degrees Celsius
 
-extern void dataAnalysis_sampling(uint8_t x_hf, uint16_t STM32MCP_batteryVoltage, uint16_t STM32MCP_batteryCurrent,
+extern void dataAnalysis_sampling(uint8_t x_hf, uint16_t STM32MCP_batteryVoltage, int16_t STM32MCP_batteryCurrent,
                                   uint16_t STM32MCP_rpm, int8_t STM32MCP_heatsinkTemp, int8_t STM32MCP_motorTemp);
 
 //
@@ -0,0 +1,197 @@
+/******************************************************************************
+
+ @file  efficiencyMap.c
+
+ @brief This file contains the per speed bin and speed mode energy / distance map.
+        It is updated once per analytics window from dataAnalyt; the record is
+        written behind and GATT updates are made from the analytics task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include "efficiencyMap.h"
+#include "writeBehind.h"
+#include "motorControl.h"
+#include "Controller.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+// The Controller characteristic must hold the whole report
+typedef char efficiencyMap_reportLenCheck[(CONTROLLER_EFFICIENCY_MAP_LEN == EFFICIENCY_MAP_REPORT_LEN) ? 1 : -1];
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static efficiencyMap_record_t map;
+static writeBehind_entry_t mapEntry = {WRITE_BEHIND_TAG_EFFICIENCY_MAP, &map, sizeof(map), sizeof(map), NULL, 0};
+static uint8_t windowsSinceSave = 0;
+static uint8_t changed = 0;                                         // map changed since the last NVS write
+static uint8_t publishPending = 0;                                  // report waiting to be sent from task context
+
+/*********************************************************************
+ * @fn      efficiencyMap_init
+ *
+ * @brief   Load the newest map record from the shared record log, or start an empty map if there
+ *          is none.  Registers the map with the write behind cache.  The report is sent to the App
+ *          from the analytics task.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void efficiencyMap_init( void )
+{
+    if (nvsLog_readLatest(writeBehind_getLog(), WRITE_BEHIND_TAG_EFFICIENCY_MAP, &map, sizeof(map)) != sizeof(map))
+    {
+        memset(&map, 0, sizeof(map));
+    }
+    windowsSinceSave = 0;
+    changed = 0;
+    writeBehind_register(&mapEntry);
+    publishPending = 1;
+}
+/*********************************************************************
+ * @fn      efficiencyMap_add
+ *
+ * @brief   Add a window to the cell of its average speed and speed mode.  Counters saturate; net
+ *          regen energy is taken off the cell's energy down to zero.  Every EFFICIENCY_MAP_SAVE_WINDOWS
+ *          windows a changed map is marked dirty for the write behind cache and sent to the App.
+ *
+ * @param   avgSpeed_kph - average speed of the window
+ *          speedMode - BRAKE_AND_THROTTLE_SPEED_MODE_xxx
+ *          energy_mWh - net energy of the window, negative when regen exceeded consumption
+ *          distance_dm - distance of the window
+ *
+ * @return  none
+ */
+void efficiencyMap_add( uint8_t avgSpeed_kph, uint8_t speedMode, int32_t energy_mWh, uint32_t distance_dm )
+{
+    uint8_t bin = avgSpeed_kph / EFFICIENCY_MAP_BIN_KPH;
+    efficiencyMap_cell_t *cell;
+    if (bin >= EFFICIENCY_MAP_SPEED_BINS)
+    {
+        bin = EFFICIENCY_MAP_SPEED_BINS - 1;
+    }
+    if (speedMode >= EFFICIENCY_MAP_MODES)
+    {
+        speedMode = EFFICIENCY_MAP_MODES - 1;
+    }
+    cell = &map.cell[speedMode][bin];
+    if (energy_mWh >= 0)
+    {
+        cell->energy_mWh = (cell->energy_mWh > 0xFFFFFFFF - (uint32_t) energy_mWh) ? 0xFFFFFFFF : cell->energy_mWh + (uint32_t) energy_mWh;
+    }
+    else
+    {
+        cell->energy_mWh = (cell->energy_mWh > (uint32_t) -energy_mWh) ? cell->energy_mWh - (uint32_t) -energy_mWh : 0;
+    }
+    cell->distance_dm = (cell->distance_dm > 0xFFFFFFFF - distance_dm) ? 0xFFFFFFFF : cell->distance_dm + distance_dm;
+    if ((energy_mWh != 0) || (distance_dm != 0))
+    {
+        changed = 1;
+    }
+
+    windowsSinceSave++;
+    if (windowsSinceSave >= EFFICIENCY_MAP_SAVE_WINDOWS)
+    {
+        windowsSinceSave = 0;
+        if (changed)
+        {
+            changed = 0;
+            writeBehind_markDirty(&mapEntry);
+            publishPending = 1;
+        }
+    }
+}
+/*********************************************************************
+ * @fn      efficiencyMap_taskFxn
+ *
+ * @brief   Send a pending report.  Called from task context.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void efficiencyMap_taskFxn( void )
+{
+    if (publishPending == 1)
+    {
+        publishPending = 0;
+        efficiencyMap_publish();
+    }
+}
+/*********************************************************************
+ * @fn      efficiencyMap_getReport
+ *
+ * @brief   Pack the map into the EFFICIENCY_MAP_REPORT_LEN byte report (little endian).  Energy and
+ *          distance each use the smallest power of two unit that fits their largest cell in 16 bits.
+ *
+ * @param   report - destination, EFFICIENCY_MAP_REPORT_LEN bytes
+ *
+ * @return  none
+ */
+void efficiencyMap_getReport( uint8_t *report )
+{
+    uint32_t maxEnergy = 0;
+    uint32_t maxDistance = 0;
+    uint8_t energyShift = 0;
+    uint8_t distanceShift = 0;
+    uint8_t mode;
+    uint8_t bin;
+    uint8_t *ptr = report + EFFICIENCY_MAP_REPORT_HEADER;
+
+    for (mode = 0; mode < EFFICIENCY_MAP_MODES; mode++)
+    {
+        for (bin = 0; bin < EFFICIENCY_MAP_SPEED_BINS; bin++)
+        {
+            if (map.cell[mode][bin].energy_mWh > maxEnergy)
+            {
+                maxEnergy = map.cell[mode][bin].energy_mWh;
+            }
+            if (map.cell[mode][bin].distance_dm > maxDistance)
+            {
+                maxDistance = map.cell[mode][bin].distance_dm;
+            }
+        }
+    }
+    while ((maxEnergy >> energyShift) > 0xFFFF)
+    {
+        energyShift++;
+    }
+    while ((maxDistance >> distanceShift) > 0xFFFF)
+    {
+        distanceShift++;
+    }
+    report[0] = EFFICIENCY_MAP_SPEED_BINS;
+    report[1] = EFFICIENCY_MAP_MODES;
+    report[2] = EFFICIENCY_MAP_BIN_KPH;
+    report[3] = energyShift;
+    report[4] = distanceShift;
+    report[5] = 0;
+    for (mode = 0; mode < EFFICIENCY_MAP_MODES; mode++)
+    {
+        for (bin = 0; bin < EFFICIENCY_MAP_SPEED_BINS; bin++)
+        {
+            uint16_t energy = (uint16_t) (map.cell[mode][bin].energy_mWh >> energyShift);
+            uint16_t distance = (uint16_t) (map.cell[mode][bin].distance_dm >> distanceShift);
+            *ptr++ = energy & 0xFF;      *ptr++ = (energy >> 8) & 0xFF;
+            *ptr++ = distance & 0xFF;    *ptr++ = (distance >> 8) & 0xFF;
+        }
+    }
+}
+/*********************************************************************
+ * @fn      efficiencyMap_publish
+ *
+ * @brief   Update the Controller efficiency map characteristic
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void efficiencyMap_publish( void )
+{
+    uint8_t report[EFFICIENCY_MAP_REPORT_LEN];
+    efficiencyMap_getReport(report);
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_EFFICIENCY_MAP, CONTROLLER_EFFICIENCY_MAP_LEN, report);
+}
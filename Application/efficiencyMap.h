@@ -0,0 +1,76 @@
+/**********************************************************************************************
+ * efficiencyMap.h
+ *
+ * Description:    Energy and distance per speed bin and speed mode.
+ *
+ *                 Every analytics window adds its net energy and distance to the cell of its
+ *                 average speed and the speed mode in use.  Cells are 32 bit and kept in the shared
+ *                 record log (write behind).
+ *                 The App reads the whole map in one (long) read of the Controller efficiency map
+ *                 characteristic, packed to 16 bit counters with a common power of two scale.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_EFFICIENCYMAP_H_
+#define APPLICATION_EFFICIENCYMAP_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define EFFICIENCY_MAP_SPEED_BINS       16
+#define EFFICIENCY_MAP_BIN_KPH          2               // bin width; the last bin collects everything above
+#define EFFICIENCY_MAP_MODES            3               // BRAKE_AND_THROTTLE_SPEED_MODE_AMBLE / LEISURE / SPORTS
+#define EFFICIENCY_MAP_CELLS            (EFFICIENCY_MAP_SPEED_BINS * EFFICIENCY_MAP_MODES)
+#define EFFICIENCY_MAP_SAVE_WINDOWS     75              // windows between NVS writes, if the map changed (6 minutes)
+
+// Map report (Controller efficiency map characteristic, little endian)
+//      [0] speed bins (1)  [1] modes (1)  [2] bin width km/hr (1)
+//      [3] energy shift (1): energy unit = 2^shift mW-hr
+//      [4] distance shift (1): distance unit = 2^shift dm
+//      [5] reserved (1)
+//      [6] cells, mode major: energy (2) and distance (2) of bin 0 mode 0, bin 1 mode 0, ...
+#define EFFICIENCY_MAP_REPORT_HEADER    6
+#define EFFICIENCY_MAP_REPORT_LEN       (EFFICIENCY_MAP_REPORT_HEADER + 4 * EFFICIENCY_MAP_CELLS)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+    uint32_t energy_mWh;                                    // net energy, regen included
+    uint32_t distance_dm;
+}efficiencyMap_cell_t;
+
+// Map record saved to the shared record log
+typedef struct
+{
+    efficiencyMap_cell_t cell[EFFICIENCY_MAP_MODES][EFFICIENCY_MAP_SPEED_BINS];
+}efficiencyMap_record_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void efficiencyMap_init( void );
+extern void efficiencyMap_add( uint8_t avgSpeed_kph, uint8_t speedMode, int32_t energy_mWh, uint32_t distance_dm );
+extern void efficiencyMap_taskFxn( void );
+extern void efficiencyMap_getReport( uint8_t *report );
+extern void efficiencyMap_publish( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_EFFICIENCYMAP_H_ */
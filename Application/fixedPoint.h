@@ -0,0 +1,263 @@
+/**********************************************************************************************
+ * fixedPoint.h
+ *
+ * Description:    Q16.16 / Q15 fixed-point helpers for the analytics path.
+ *
+ *                 The CC2640R2 (Cortex-M3) has no FPU: every float or double operation is a
+ *                 run time library call.  These helpers use 32 x 32 -> 64 bit multiplies
+ *                 (UMULL / SMULL) and shifts only.  Real valued constants are converted with
+ *                 FIXEDPOINT_Q16() / FIXEDPOINT_Q15() / FIXEDPOINT_RECIP32(), which the compiler
+ *                 folds at build time - no floating point code is generated for them.
+ *
+ *                 Rounding is half away from zero, the same as round() in <math.h>.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_FIXEDPOINT_H_
+#define APPLICATION_FIXEDPOINT_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define FIXEDPOINT_Q16_SHIFT            16
+#define FIXEDPOINT_Q16_ONE              ((q16_t) 1 << FIXEDPOINT_Q16_SHIFT)     // 1.0 in Q16.16
+#define FIXEDPOINT_Q15_SHIFT            15
+#define FIXEDPOINT_Q15_MAX              ((q15_t) 0x7FFF)                        // 0.999969 in Q15
+#define FIXEDPOINT_PI                   3.14159265358979323846                  // for constant folding only
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef int32_t q16_t;      // Q16.16: range -32768 to 32767.99998, resolution 1.5e-5
+typedef int16_t q15_t;      // Q15:    range -1 to 0.99997, resolution 3.1e-5
+
+/*********************************************************************
+ * MACROS
+ */
+// Compile time conversion of a real constant, rounded to the nearest step.  Constants only.
+#define FIXEDPOINT_ROUND(x)             ((x) >= 0 ? (int64_t) ((x) + 0.5) : (int64_t) ((x) - 0.5))
+#define FIXEDPOINT_Q16(x)               ((q16_t) FIXEDPOINT_ROUND((x) * 65536.0))
+#define FIXEDPOINT_Q15(x)               ((q15_t) FIXEDPOINT_ROUND((x) * 32768.0))
+#define FIXEDPOINT_Q32(x)               ((uint32_t) FIXEDPOINT_ROUND((x) * 4294967296.0))   // 0 <= x < 1
+#define FIXEDPOINT_QN(x, n)             ((int32_t) FIXEDPOINT_ROUND((x) * (double) (1UL << (n))))   // extra fraction bits for a small factor, n < 31
+
+// Q0.32 reciprocal of a constant divisor d > 1, rounded up, for fixedPoint_divRecip()
+#define FIXEDPOINT_RECIP32(d)           ((uint32_t) ((0x100000000ULL + (uint64_t) (d) - 1) / (uint64_t) (d)))
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+/*********************************************************************
+ * @fn      fixedPoint_sat32
+ *
+ * @brief   Saturate a 64 bit intermediate to the int32_t range
+ *
+ * @param   x - value
+ *
+ * @return  x clamped to INT32_MIN .. INT32_MAX
+ */
+static inline int32_t fixedPoint_sat32(int64_t x)
+{
+    if (x > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (x < INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+    return (int32_t) x;
+}
+/*********************************************************************
+ * @fn      fixedPoint_roundShift
+ *
+ * @brief   x / 2^shift rounded half away from zero
+ *
+ * @param   x     - value
+ *          shift - 1 to 62
+ *
+ * @return  rounded quotient
+ */
+static inline int64_t fixedPoint_roundShift(int64_t x, uint8_t shift)
+{
+    int64_t half = (int64_t) 1 << (shift - 1);
+    return (x >= 0) ? ((x + half) >> shift) : -((half - x) >> shift);
+}
+/*********************************************************************
+ * @fn      fixedPoint_q16Mul
+ *
+ * @brief   Saturating Q16.16 multiply, rounded.  Error <= 0.5 LSB (7.6e-6).
+ *
+ * @param   a, b - Q16.16 operands
+ *
+ * @return  a * b in Q16.16
+ */
+static inline q16_t fixedPoint_q16Mul(q16_t a, q16_t b)
+{
+    return fixedPoint_sat32(fixedPoint_roundShift((int64_t) a * b, FIXEDPOINT_Q16_SHIFT));
+}
+/*********************************************************************
+ * @fn      fixedPoint_q16MulInt
+ *
+ * @brief   Scale an integer by a Q16.16 factor, rounded and saturated.
+ *          Error <= 0.5 + |x| * 2^-17 against the exact real factor.
+ *
+ * @param   x - integer
+ *          k - Q16.16 factor
+ *
+ * @return  round(x * k) as an integer
+ */
+static inline int32_t fixedPoint_q16MulInt(int32_t x, q16_t k)
+{
+    return fixedPoint_sat32(fixedPoint_roundShift((int64_t) x * k, FIXEDPOINT_Q16_SHIFT));
+}
+/*********************************************************************
+ * @fn      fixedPoint_q15Mul
+ *
+ * @brief   Saturating Q15 multiply, rounded.  -1 x -1 saturates to FIXEDPOINT_Q15_MAX.
+ *
+ * @param   a, b - Q15 operands
+ *
+ * @return  a * b in Q15
+ */
+static inline q15_t fixedPoint_q15Mul(q15_t a, q15_t b)
+{
+    int32_t p = (int32_t) fixedPoint_roundShift((int32_t) a * b, FIXEDPOINT_Q15_SHIFT);
+    if (p > FIXEDPOINT_Q15_MAX)
+    {
+        p = FIXEDPOINT_Q15_MAX;
+    }
+    return (q15_t) p;
+}
+/*********************************************************************
+ * @fn      fixedPoint_divRecip
+ *
+ * @brief   floor(x / d) as a multiply by recip = FIXEDPOINT_RECIP32(d).
+ *          Exact for x * d < 2^32; otherwise the result is at most 1 above floor(x / d).
+ *
+ * @param   x     - dividend
+ *          recip - Q0.32 reciprocal of the divisor
+ *
+ * @return  quotient
+ */
+static inline uint32_t fixedPoint_divRecip(uint32_t x, uint32_t recip)
+{
+    return (uint32_t) (((uint64_t) x * recip) >> 32);
+}
+/*********************************************************************
+ * @fn      fixedPoint_mulRecipRound
+ *
+ * @brief   round(x * r / 2^32) for a signed x and a Q0.32 ratio r (0 <= r < 1) - a division by a
+ *          constant or once computed divisor.  Error <= 0.5 + |x| x (rounding error of r) / 2^32.
+ *
+ * @param   x - value
+ *          r - Q0.32 ratio
+ *
+ * @return  rounded product
+ */
+static inline int32_t fixedPoint_mulRecipRound(int32_t x, uint32_t r)
+{
+    return (int32_t) fixedPoint_roundShift((int64_t) x * r, 32);
+}
+/*********************************************************************
+ * @fn      fixedPoint_divRound
+ *
+ * @brief   Unsigned integer division rounded half up, the same as round((float) n / d) while n fits
+ *          the float mantissa.  Uses the Cortex-M3 hardware divider.
+ *
+ * @param   n - dividend
+ *          d - divisor, non zero
+ *
+ * @return  rounded quotient
+ */
+static inline uint32_t fixedPoint_divRound(uint32_t n, uint32_t d)
+{
+    uint32_t q = n / d;
+    return ((n - q * d) >= (d - (d >> 1))) ? q + 1 : q;
+}
+/*********************************************************************
+ * @fn      fixedPoint_divRoundSigned
+ *
+ * @brief   Signed integer division rounded half away from zero
+ *
+ * @param   n - dividend
+ *          d - divisor, positive
+ *
+ * @return  rounded quotient
+ */
+static inline int32_t fixedPoint_divRoundSigned(int32_t n, int32_t d)
+{
+    return (n >= 0) ? (int32_t) fixedPoint_divRound((uint32_t) n, (uint32_t) d) : -(int32_t) fixedPoint_divRound((uint32_t) -n, (uint32_t) d);
+}
+/*********************************************************************
+ * @fn      fixedPoint_ticksToUs
+ *
+ * @brief   Convert elapsed timer ticks (e.g. Timestamp_get32 differences) to micro-seconds,
+ *          rounded down and saturated
+ *
+ * @param   ticks  - elapsed ticks
+ *          freqHz - tick frequency, 0 if unknown
+ *
+ * @return  elapsed time in micro-seconds, 0 if the frequency is unknown
+ */
+static inline uint32_t fixedPoint_ticksToUs(uint32_t ticks, uint32_t freqHz)
+{
+    uint64_t us;
+    if (freqHz == 0)
+    {
+        return 0;
+    }
+    us = ((uint64_t) ticks * 1000000) / freqHz;
+    return (us > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) us;
+}
+/*********************************************************************
+ * @fn      fixedPoint_sqrt32
+ *
+ * @brief   Integer square root, bit by bit: 16 iterations of shifts and adds
+ *
+ * @param   x - value
+ *
+ * @return  floor(sqrt(x))
+ */
+static inline uint16_t fixedPoint_sqrt32(uint32_t x)
+{
+    uint32_t root = 0;
+    uint32_t bit = (uint32_t) 1 << 30;
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t) root;
+}
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_FIXEDPOINT_H_ */
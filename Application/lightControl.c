@@ -21,6 +21,7 @@
 #include "ledControl.h"
 #include "motorControl.h"
 #include "Dashboard.h"
+#include "configStore.h"
 #include "UDHAL/UDHAL_I2C.h"
 #include "TSL2561/TSL2561.h"
 
@@ -261,6 +262,7 @@ void lightControl_lightModeChange()
     {
         light_mode = 0;
     }
+    configStore_set(CONFIG_STORE_KEY_LIGHT_MODE, light_mode);
     motorcontrol_setGatt(DASHBOARD_SERV_UUID, DASHBOARD_LIGHT_MODE, DASHBOARD_LIGHT_MODE_LEN, (uint8_t *) &light_mode);
     ledControl_setLightMode(light_mode);
     (*lightModeArray[light_mode])();
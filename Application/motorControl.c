@@ -10,6 +10,7 @@
 /*********************************************************************
  * INCLUDES
  */
+#include <string.h>
 #include <ti/drivers/I2C.h>
 #include <ti/drivers/NVS.h>
 #include <ti/drivers/GPIO.h>
@@ -24,11 +25,15 @@
 #include "periodicCommunication.h"
 #include "simple_peripheral.h"
 #include "brakeAndThrottle.h"
+#include "brakeLatency.h"
 #include "ledControl.h"
 #include "lightControl.h"
 #include "buzzerControl.h"
 #include "powerOnTime.h"
 #include "dataAnalysis.h"
+#include "configStore.h"
+#include "writeBehind.h"
+#include "blackBox.h"
 #include "singleButton/singleButton.h"
 #include "peripheral.h"
 #include "TSL2561/TSL2561.h"
@@ -55,8 +60,10 @@ static void motorcontrol_exMsgCb(uint8_t exceptionCode);
 static void motorcontrol_erMsgCb(uint8_t errorCode);
 
 //static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, uint16_t throttlePercent, uint8_t errorMsg);
-static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, uint16_t IQValue, uint8_t errorMsg);
+static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, int16_t IQValue, uint8_t errorMsg);
+static void motorcontrol_riderInputEventCB(brakeAndThrottle_event_t *evt);
 static void motorcontrol_controllerCB(uint8_t paramID);
+static void motorcontrol_controllerReadCB(uint8_t paramID, uint16_t offset, uint8_t *pValue, uint16_t len);
 static void motorcontrol_dashboardCB(uint8_t paramID);
 static void motorcontrol_singleButtonCB(uint8_t messageID);
 
@@ -77,7 +84,8 @@ static STM32MCP_CBs_t STM32MCP_CBs =
 
 static ControllerCBs_t ControllerCBs =
 {
-     motorcontrol_controllerCB
+     motorcontrol_controllerCB,
+     motorcontrol_controllerReadCB
 };
 
 static DashboardCBs_t DashboardCBs =
@@ -121,6 +129,9 @@ void motorcontrol_init(void)
 //    NVS_init();
 
     UDHAL_init();
+    writeBehind_init();                 // shared record log - NVS must be open
+    configStore_init();                 // user settings saved at the last power off - from the shared record log
+    blackBox_init();                    // crash and fault black box - NVS must be open
     mccheck = 1;
 
     Controller_RegisterAppCBs(&ControllerCBs);
@@ -140,8 +151,10 @@ void motorcontrol_init(void)
     dataAnalysis_init();                // Initiate data analytics
     mccheck = 6;
 
+    brakeLatency_init();                // Brake to motor cut latency trace
     brakeAndThrottle_init();
     brakeAndThrottle_registerCBs(&brakeAndThrottle_CBs);
+    brakeAndThrottle_subscribe(motorcontrol_riderInputEventCB);     // tail light and sensor fault report
     brakeAndThrottle_start();
     mccheck = 7;
 
@@ -234,16 +247,13 @@ static void motorcontrol_processGetRegisterFrameMsg(uint8_t *txPayload, uint8_t
     case STM32MCP_SPEED_MEASURED_REG_ID:
         {
             int32_t rawRPM = *((int32_t*) rxPayload);
+            brakeAndThrottle_setMotorSpeed(rawRPM);                 // regen interlock - negative when rolling backwards
             if(rawRPM >= 0)
             {
                 uint16_t rpm = (uint16_t) (rawRPM & 0xFFFF);
                 //send rpm to dataAnalysis
                 //dataAnalysis_mcData(rpmID, &rpm);
             }
-            else
-            {
-                // what if rawRPM is negative???  Would rawRPM be negative??? Rolling in reverse or measurement error???
-            }
             break;
         }
 // ********************    Need to create new REG_IDs
@@ -323,6 +333,7 @@ static void motorcontrol_rxMsgCb(uint8_t *rxMsg, STM32MCP_txMsgNode_t *STM32MCP_
  */
 static void motorcontrol_exMsgCb(uint8_t exceptionCode)
 {
+    blackBox_error(BLACK_BOX_TYPE_STM32_EXCEPTION, exceptionCode);
     switch(exceptionCode)
         {
         case STM32MCP_QUEUE_OVERLOAD:
@@ -345,6 +356,7 @@ static void motorcontrol_exMsgCb(uint8_t exceptionCode)
  */
 static void motorcontrol_erMsgCb(uint8_t errorCode)
 {
+    blackBox_error(BLACK_BOX_TYPE_STM32_ERROR, errorCode);
     switch(errorCode)
     {
     case STM32MCP_BAD_FRAME_ID:
@@ -382,13 +394,16 @@ static void motorcontrol_erMsgCb(uint8_t errorCode)
  */
 uint16_t execute_rpm;
 //static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, uint16_t IQValue, uint8_t errorMsg)
-static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, uint16_t IQValue, uint8_t errorMsg)
+static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, int16_t IQValue, uint8_t errorMsg)
 {
+    brakeLatency_mark(BRAKE_LATENCY_STAGE_MOTOR_CB);
+    blackBox_setDrive((uint8_t) brakeAndThrottle_getThrottlePercent(), IQValue, errorMsg);
     if((errorMsg == BRAKE_AND_THROTTLE_NORMAL))
     {
         //uint16_t
         //execute_rpm = (uint16_t) (allowableSpeed * throttlePercent / 100) & 0xFFFF;
-        STM32MCP_setDynamicCurrent(allowableSpeed,IQValue); //Torque Mode + Dynamic Current
+        brakeLatency_mark(BRAKE_LATENCY_STAGE_TX_QUEUE);
+        STM32MCP_setDynamicCurrent(allowableSpeed,IQValue); //Torque Mode + Dynamic Current, negative IQ = regen brake
         //STM32MCP_executeRampFrame(STM32MCP_MOTOR_1_ID, execute_rpm, 200);
         //STM32MCP_executeCommandFrame(STM32MCP_MOTOR_1_ID, STM32MCP_START_MOTOR_COMMAND_ID);
     }
@@ -400,6 +415,41 @@ static void motorcontrol_brakeAndThrottleCB(uint16_t allowableSpeed, uint16_t IQ
 
 }
 
+/*********************************************************************
+ * @fn      motorcontrol_riderInputEventCB
+ *
+ * @brief   Rider input event subscriber.  Toggles the tail light on brake pressed / released
+ *          and reports a brake or throttle sensor fault to the App.
+ *
+ * @param   evt - the rider input event
+ *
+ * @return  None.
+ */
+static void motorcontrol_riderInputEventCB(brakeAndThrottle_event_t *evt)
+{
+    switch(evt->event)
+    {
+    case BRAKE_AND_THROTTLE_EVT_BRAKE_PRESSED:
+        {
+            STM32MCP_setSystemControlConfigFrame(STM32MCP_TAIL_LIGHT_ON);
+            break;
+        }
+    case BRAKE_AND_THROTTLE_EVT_BRAKE_RELEASED:
+        {
+            STM32MCP_setSystemControlConfigFrame(STM32MCP_TAIL_LIGHT_OFF);
+            break;
+        }
+    case BRAKE_AND_THROTTLE_EVT_SENSOR_FAULT:
+        {
+            uint8_t errorCode = (evt->value == BRAKE_ERROR) ? BRAKE_SENSOR_ABNORMAL : THROTTLE_SENSOR_ABNORMAL;
+            motorcontrol_setGatt(DASHBOARD_SERV_UUID, DASHBOARD_ERROR_CODE, DASHBOARD_ERROR_CODE_LEN, &errorCode);
+            break;
+        }
+    default:
+        break;
+    }
+}
+
 /*********************************************************************
  * @fn      motorcontrol_speedModeChgCB
  *
@@ -446,6 +496,33 @@ static void motorcontrol_controllerCB(uint8_t paramID)
             break;
     }
 }
+/*********************************************************************
+ * @fn      motorcontrol_controllerReadCB
+ *
+ * @brief   When the client (The mobile app) reads a Controller characteristic that is not kept in
+ *          the profile, it is filled here
+ *
+ * @param   paramID - the characteristic
+ *          offset - offset in the value
+ *          pValue - destination
+ *          len - bytes to fill
+ *
+ * @return  None.
+ */
+static void motorcontrol_controllerReadCB(uint8_t paramID, uint16_t offset, uint8_t *pValue, uint16_t len)
+{
+    switch(paramID)
+    {
+        case CONTROLLER_BLACK_BOX:
+            {
+                blackBox_read(offset, pValue, len);
+                break;
+            }
+        default:
+            memset(pValue, 0, len);
+            break;
+    }
+}
 /*********************************************************************
  * @fn      motorcontrol_dashboardCB
  *
@@ -468,6 +545,13 @@ static void motorcontrol_dashboardCB(uint8_t paramID)
             lightControl_lightModeChange();
             break;
         }
+    case DASHBOARD_CALIBRATION: // App starts / aborts the brake and throttle calibration, or restores the factory defaults
+        {
+            uint8_t calibrationVal[DASHBOARD_CALIBRATION_LEN];
+            Dashboard_GetParameter(DASHBOARD_CALIBRATION, calibrationVal);
+            brakeAndThrottle_calibrationCommand(calibrationVal[0]);
+            break;
+        }
     default:
         break;
     }
@@ -503,8 +587,9 @@ static void motorcontrol_singleButtonCB(uint8_t messageID)
                 //  turn off TSL2561
                 //  turn off all tasks
                 // At very last:
-                //  call nvs write to write into NVS memory only when power off - will take a few milliseconds to complete
-                //  nvsControl_nvsWrite();
+                //  write the pending usage data, checkpoint, settings, trip summary, analytics snapshot and black box - programs only, no erase
+                blackBox_event(BLACK_BOX_TYPE_POWER_OFF, 0, 0);
+                dataAnalysis_powerOff();
             }
             // if Powering Off -> switch to Power On
             else if(powerOn == 0){
@@ -0,0 +1,129 @@
+/******************************************************************************
+
+ @file  nvsJob.c
+
+ @brief This file contains the radio pacing of the flash erases made ahead
+        by the NVS logs, and the longest of those erases.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <xdc/std.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include "nvsJob.h"
+#include "fixedPoint.h"
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static volatile uint8_t paced = 0;                                  // 1 while a BLE connection is up
+static volatile uint8_t slots = 0;                                  // steps allowed until the next connection event
+static uint32_t blockStartTicks = 0;
+static uint32_t blockMaxTicks = 0;                                  // longest erase timed
+
+/*********************************************************************
+ * @fn      nvsJob_setRadioPacing
+ *
+ * @brief   Pace the erases by the connection events (connected) or not (disconnected).  Called from
+ *          the BLE application task.
+ *
+ * @param   enable - 1 while a connection is up
+ *
+ * @return  none
+ */
+void nvsJob_setRadioPacing( uint8_t enable )
+{
+    paced = enable;
+    slots = 0;
+}
+/*********************************************************************
+ * @fn      nvsJob_connectionEvent
+ *
+ * @brief   A connection event has ended: allow NVS_JOB_STEPS_PER_EVENT steps before the next one.
+ *          Unused steps are not carried over.  Called from the BLE application task.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void nvsJob_connectionEvent( void )
+{
+    slots = NVS_JOB_STEPS_PER_EVENT;
+}
+/*********************************************************************
+ * @fn      nvsJob_claimStep
+ *
+ * @brief   Take a step for an erase ahead of need.  Always given while disconnected; while
+ *          connected it takes one of the steps the last connection event allowed.  Analytics
+ *          task only.
+ *
+ * @param   none
+ *
+ * @return  1 if the erase may be made now, 0 if it is to wait for the next connection event
+ */
+uint8_t nvsJob_claimStep( void )
+{
+    UInt key;
+    uint8_t claimed = 1;
+    if (paced == 1)
+    {
+        key = Hwi_disable();
+        if (slots == 0)
+        {
+            claimed = 0;
+        }
+        else
+        {
+            slots--;
+        }
+        Hwi_restore(key);
+    }
+    return claimed;
+}
+/*********************************************************************
+ * @fn      nvsJob_blockStart
+ *
+ * @brief   An erase starts.  Analytics task only.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void nvsJob_blockStart( void )
+{
+    blockStartTicks = Timestamp_get32();
+}
+/*********************************************************************
+ * @fn      nvsJob_blockEnd
+ *
+ * @brief   The erase started by nvsJob_blockStart is done: keep the longest.  Analytics task only.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void nvsJob_blockEnd( void )
+{
+    uint32_t elapsedTicks = Timestamp_get32() - blockStartTicks;
+    if (elapsedTicks > blockMaxTicks)
+    {
+        blockMaxTicks = elapsedTicks;
+    }
+}
+/*********************************************************************
+ * @fn      nvsJob_getBlockMaxUs
+ *
+ * @brief   Longest erase timed since boot (pre-emption included)
+ *
+ * @param   none
+ *
+ * @return  time in micro-seconds
+ */
+uint32_t nvsJob_getBlockMaxUs( void )
+{
+    Types_FreqHz freq;
+    Timestamp_getFreq(&freq);
+    return fixedPoint_ticksToUs(blockMaxTicks, freq.lo);
+}
@@ -0,0 +1,55 @@
+/**********************************************************************************************
+ * nvsJob.h
+ *
+ * Description:    Radio pacing of the flash erases made ahead of need by the NVS logs (the shared
+ *                 record log, the black box ring), and their worst case blocking time.
+ *
+ *                 An erase stalls the flash, and the radio with it, for the whole erase.  While a
+ *                 BLE connection is up each connection event end allows NVS_JOB_STEPS_PER_EVENT
+ *                 steps, and a log erases ahead only when nvsJob_claimStep gives it one, so the
+ *                 erase falls between radio events instead of across them.  Without a connection
+ *                 a step is always given.  An erase that cannot wait (the black box has records
+ *                 staged and no erased slot left) is made without a step.
+ *
+ *                 Each erase made by writeBehind_taskFxn and blackBox_taskFxn is timed between
+ *                 nvsJob_blockStart and nvsJob_blockEnd; the longest (pre-emption included) is
+ *                 in the black box report.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_NVSJOB_H_
+#define APPLICATION_NVSJOB_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define NVS_JOB_STEPS_PER_EVENT         1               // steps allowed after each BLE connection event
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void nvsJob_setRadioPacing( uint8_t enable );
+extern void nvsJob_connectionEvent( void );
+extern uint8_t nvsJob_claimStep( void );
+extern void nvsJob_blockStart( void );
+extern void nvsJob_blockEnd( void );
+extern uint32_t nvsJob_getBlockMaxUs( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_NVSJOB_H_ */
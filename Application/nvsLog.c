@@ -0,0 +1,454 @@
+/******************************************************************************
+
+ @file  nvsLog.c
+
+ @brief This file contains the append only record log on internal flash.
+        Appends are made from task context; an append that fills the current
+        sector erases the oldest sector first.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include "nvsLog.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define NVS_LOG_RECORD_VALID            0
+#define NVS_LOG_RECORD_BLANK            1
+#define NVS_LOG_RECORD_CORRUPT          2               // torn write or bit error - nothing after it in the sector is trusted
+#define NVS_LOG_CRC_INIT                0xFFFF
+#define NVS_LOG_CRC_POLY                0x1021
+#define NVS_LOG_CHUNK                   16              // bytes read per step while checking a record
+
+// Record positions in the area are kept in 16 bits, the record length in the bits below the tag
+typedef char nvsLog_sectorSizeCheck[(NVS_LOG_SECTOR_SIZE * NVS_LOG_MAX_SECTORS <= 0x10000) ? 1 : -1];
+typedef char nvsLog_lengthCheck[(NVS_LOG_MAX_LENGTH < NVS_LOG_LENGTH_MASK) && (NVS_LOG_TAGS <= (0xFFFF >> NVS_LOG_TAG_SHIFT)) ? 1 : -1];
+
+/**********************************************************************
+ *  Local functions
+ */
+static uint16_t nvsLog_crc(uint16_t crc, const uint8_t *data, size_t length);
+static uint8_t nvsLog_readRecord(nvsLog_t *log, uint8_t sector, uint16_t offset, nvsLog_recordHeader_t *header);
+static void nvsLog_rotate(nvsLog_t *log);
+
+/*********************************************************************
+ * @fn      nvsLog_init
+ *
+ * @brief   Find the append position and the newest record of each tag.  Reads the first record of
+ *          every sector to find the newest sector, then checks the records of every sector, oldest
+ *          first.  A corrupted record closes its sector: the next append starts a new one.  A
+ *          formatted, empty sector after the newest one (erased ahead by nvsLog_reserve) takes the
+ *          next record.
+ *
+ * @param   log - log instance
+ *          nvsManager - NVS functions of the log area, NULL if there is no NVS
+ *          sectors - sectors in the log area, 2 to NVS_LOG_MAX_SECTORS
+ *
+ * @return  none
+ */
+void nvsLog_init( nvsLog_t *log, nvsLog_nvsManager_t *nvsManager, uint8_t sectors )
+{
+    nvsLog_sectorHeader_t sectorHeader;
+    nvsLog_recordHeader_t header;
+    uint8_t  newest = 0;
+    uint8_t  found = 0;
+    uint32_t newestSequence = 0;
+    uint8_t  sector;
+    uint8_t  sectorsLeft;
+    uint8_t  tag;
+    uint16_t offset = NVS_LOG_SECTOR_SIZE;
+
+    if (sectors > NVS_LOG_MAX_SECTORS)
+    {
+        sectors = NVS_LOG_MAX_SECTORS;
+    }
+    log->nvsManager = nvsManager;
+    log->sectors = sectors;
+    // Empty log: the first append rotates onto sector 0
+    log->sector = sectors - 1;
+    log->writeOffset = NVS_LOG_SECTOR_SIZE;
+    log->sequence = 0;
+    for (tag = 0; tag < NVS_LOG_TAGS; tag++)
+    {
+        log->latest[tag] = 0;
+    }
+    if (nvsManager == NULL)
+    {
+        return;
+    }
+
+    for (sector = 0; sector < sectors; sector++)
+    {
+        nvsManager->nvsLog_NVS_Read((size_t) sector * NVS_LOG_SECTOR_SIZE, &sectorHeader, sizeof(sectorHeader));
+        if ((sectorHeader.magic == NVS_LOG_MAGIC) &&
+            (nvsLog_readRecord(log, sector, sizeof(sectorHeader), &header) == NVS_LOG_RECORD_VALID) &&
+            ((found == 0) || ((int32_t) (header.sequence - newestSequence) > 0)))
+        {
+            newest = sector;
+            newestSequence = header.sequence;
+            found = 1;
+        }
+    }
+    if (found == 0)
+    {
+        return;
+    }
+
+    // Oldest sector first, so the newest record of a tag is the last one seen; the newest sector is last
+    log->sector = newest;
+    sector = newest;
+    for (sectorsLeft = sectors; sectorsLeft > 0; sectorsLeft--)
+    {
+        sector = (sector + 1 < sectors) ? sector + 1 : 0;
+        nvsManager->nvsLog_NVS_Read((size_t) sector * NVS_LOG_SECTOR_SIZE, &sectorHeader, sizeof(sectorHeader));
+        if (sectorHeader.magic != NVS_LOG_MAGIC)
+        {
+            continue;
+        }
+        offset = sizeof(sectorHeader);
+        while (offset + sizeof(header) <= NVS_LOG_SECTOR_SIZE)
+        {
+            uint8_t status = nvsLog_readRecord(log, sector, offset, &header);
+            if (status == NVS_LOG_RECORD_BLANK)
+            {
+                break;
+            }
+            if (status == NVS_LOG_RECORD_CORRUPT)
+            {
+                offset = NVS_LOG_SECTOR_SIZE;
+                break;
+            }
+            tag = NVS_LOG_RECORD_TAG(header.length);
+            if (tag < NVS_LOG_TAGS)
+            {
+                log->latest[tag] = (uint16_t) (sector * NVS_LOG_SECTOR_SIZE + offset);
+            }
+            if (sector == newest)
+            {
+                log->sequence = header.sequence + 1;
+            }
+            offset += NVS_LOG_RECORD_SIZE(NVS_LOG_RECORD_LENGTH(header.length));
+        }
+    }
+    log->writeOffset = offset;
+
+    sector = (newest + 1 < sectors) ? newest + 1 : 0;
+    nvsManager->nvsLog_NVS_Read((size_t) sector * NVS_LOG_SECTOR_SIZE, &sectorHeader, sizeof(sectorHeader));
+    if ((sectorHeader.magic == NVS_LOG_MAGIC) &&
+        (nvsLog_readRecord(log, sector, sizeof(sectorHeader), &header) == NVS_LOG_RECORD_BLANK))
+    {
+        log->sector = sector;
+        log->writeOffset = sizeof(sectorHeader);
+    }
+}
+/*********************************************************************
+ * @fn      nvsLog_append
+ *
+ * @brief   Program a record after the newest one.  If it does not fit in the current sector the
+ *          next sector (the oldest) is erased and formatted first.  Task context only.
+ *
+ * @param   log - log instance
+ *          tag - record tag, below NVS_LOG_TAGS
+ *          data - record data
+ *          length - record length, at most NVS_LOG_MAX_LENGTH
+ *
+ * @return  1 if the record was written, 0 if there is no NVS, or the tag or the length is out of range
+ */
+uint8_t nvsLog_append( nvsLog_t *log, uint8_t tag, const void *data, uint16_t length )
+{
+    nvsLog_recordHeader_t header;
+    size_t recordOffset;
+
+    if ((log->nvsManager == NULL) || (tag >= NVS_LOG_TAGS) || (length > NVS_LOG_MAX_LENGTH))
+    {
+        return 0;
+    }
+    if (log->writeOffset + NVS_LOG_RECORD_SIZE(length) > NVS_LOG_SECTOR_SIZE)
+    {
+        nvsLog_rotate(log);
+    }
+
+    header.length = length | ((uint16_t) tag << NVS_LOG_TAG_SHIFT);
+    header.sequence = log->sequence;
+    header.crc = nvsLog_crc(NVS_LOG_CRC_INIT, (const uint8_t *) &header.sequence, sizeof(header.sequence));
+    header.crc = nvsLog_crc(header.crc, (const uint8_t *) &header.length, sizeof(header.length));
+    header.crc = nvsLog_crc(header.crc, (const uint8_t *) data, length);
+
+    // Header first: a write torn in the data leaves a header whose CRC fails, which closes the sector
+    recordOffset = (size_t) log->sector * NVS_LOG_SECTOR_SIZE + log->writeOffset;
+    log->nvsManager->nvsLog_NVS_Program(recordOffset, &header, sizeof(header));
+    if (length > 0)
+    {
+        log->nvsManager->nvsLog_NVS_Program(recordOffset + sizeof(header), (void *) data, length);
+    }
+    log->latest[tag] = (uint16_t) recordOffset;
+    log->writeOffset += NVS_LOG_RECORD_SIZE(length);
+    log->sequence++;
+    return 1;
+}
+/*********************************************************************
+ * @fn      nvsLog_hasRoom
+ *
+ * @brief   Whether a record fits in the current sector, so that its append only programs
+ *
+ * @param   log - log instance
+ *          length - length of the record
+ *
+ * @return  1 if it fits or there is no NVS, 0 if nvsLog_reserve would erase
+ */
+uint8_t nvsLog_hasRoom( nvsLog_t *log, uint16_t length )
+{
+    return ((log->nvsManager == NULL) || (log->writeOffset + NVS_LOG_RECORD_SIZE(length) <= NVS_LOG_SECTOR_SIZE)) ? 1 : 0;
+}
+/*********************************************************************
+ * @fn      nvsLog_reserve
+ *
+ * @brief   Make room for a record now: if it would not fit in the current sector, erase and format
+ *          the next sector so that the append only programs.  Task context only.
+ *
+ * @param   log - log instance
+ *          length - length of the next record
+ *
+ * @return  1 if a sector was erased, 0 if there was room already or there is no NVS
+ */
+uint8_t nvsLog_reserve( nvsLog_t *log, uint16_t length )
+{
+    if (nvsLog_hasRoom(log, length) == 1)
+    {
+        return 0;
+    }
+    nvsLog_rotate(log);
+    return 1;
+}
+/*********************************************************************
+ * @fn      nvsLog_isExpiring
+ *
+ * @brief   Whether the newest record of a tag is in the sector that the next rotation erases.  The
+ *          owner writes the record again before the current sector fills up to keep it.
+ *
+ * @param   log - log instance
+ *          tag - record tag
+ *
+ * @return  1 if the record is to be written again, 0 if it is safe or there is none
+ */
+uint8_t nvsLog_isExpiring( nvsLog_t *log, uint8_t tag )
+{
+    uint8_t next = (log->sector + 1 < log->sectors) ? log->sector + 1 : 0;
+    return ((tag < NVS_LOG_TAGS) && (log->latest[tag] != 0) && (log->latest[tag] / NVS_LOG_SECTOR_SIZE == next));
+}
+/*********************************************************************
+ * @fn      nvsLog_readLatest
+ *
+ * @brief   Read the newest record of a tag
+ *
+ * @param   log - log instance
+ *          tag - record tag
+ *          data - destination
+ *          maxLength - size of the destination
+ *
+ * @return  bytes copied, 0 if there is no record of the tag
+ */
+uint16_t nvsLog_readLatest( nvsLog_t *log, uint8_t tag, void *data, uint16_t maxLength )
+{
+    nvsLog_recordHeader_t header;
+
+    if ((log->nvsManager == NULL) || (tag >= NVS_LOG_TAGS) || (log->latest[tag] == 0))
+    {
+        return 0;
+    }
+    log->nvsManager->nvsLog_NVS_Read(log->latest[tag], &header, sizeof(header));
+    if (NVS_LOG_RECORD_LENGTH(header.length) < maxLength)
+    {
+        maxLength = NVS_LOG_RECORD_LENGTH(header.length);
+    }
+    log->nvsManager->nvsLog_NVS_Read(log->latest[tag] + sizeof(header), data, maxLength);
+    return maxLength;
+}
+/*********************************************************************
+ * @fn      nvsLog_readFirst
+ *
+ * @brief   Start reading the log from its oldest record.  The oldest sector is the one after the
+ *          sector being filled.
+ *
+ * @param   log - log instance
+ *          cursor - read position, kept by the caller
+ *
+ * @return  none
+ */
+void nvsLog_readFirst( nvsLog_t *log, nvsLog_cursor_t *cursor )
+{
+    cursor->sector = (log->sector + 1 < log->sectors) ? log->sector + 1 : 0;
+    cursor->sectorsLeft = (log->nvsManager == NULL) ? 0 : log->sectors;
+    cursor->offset = 0;                                             // sector header not checked yet
+    cursor->length = 0;
+    cursor->tag = 0;
+    cursor->sequence = 0;
+}
+/*********************************************************************
+ * @fn      nvsLog_readNext
+ *
+ * @brief   Read the next valid record.  A blank or corrupted record ends its sector, as in
+ *          nvsLog_init; unformatted sectors are skipped.  Task context only.
+ *
+ * @param   log - log instance
+ *          cursor - read position from nvsLog_readFirst; returns the length, tag and sequence
+ *                   number of the record read
+ *          data - destination
+ *          maxLength - size of the destination; a longer record is truncated
+ *
+ * @return  1 if a record was read, 0 at the end of the log
+ */
+uint8_t nvsLog_readNext( nvsLog_t *log, nvsLog_cursor_t *cursor, void *data, uint16_t maxLength )
+{
+    nvsLog_sectorHeader_t sectorHeader;
+    nvsLog_recordHeader_t header;
+
+    while (cursor->sectorsLeft > 0)
+    {
+        if (cursor->offset == 0)
+        {
+            log->nvsManager->nvsLog_NVS_Read((size_t) cursor->sector * NVS_LOG_SECTOR_SIZE, &sectorHeader, sizeof(sectorHeader));
+            cursor->offset = (sectorHeader.magic == NVS_LOG_MAGIC) ? sizeof(sectorHeader) : NVS_LOG_SECTOR_SIZE;
+        }
+        if ((cursor->offset + sizeof(header) <= NVS_LOG_SECTOR_SIZE) &&
+            (nvsLog_readRecord(log, cursor->sector, cursor->offset, &header) == NVS_LOG_RECORD_VALID))
+        {
+            cursor->length = NVS_LOG_RECORD_LENGTH(header.length);
+            cursor->tag = NVS_LOG_RECORD_TAG(header.length);
+            cursor->sequence = header.sequence;
+            if (cursor->length < maxLength)
+            {
+                maxLength = cursor->length;
+            }
+            log->nvsManager->nvsLog_NVS_Read((size_t) cursor->sector * NVS_LOG_SECTOR_SIZE + cursor->offset + sizeof(header), data, maxLength);
+            cursor->offset += NVS_LOG_RECORD_SIZE(cursor->length);
+            return 1;
+        }
+        cursor->sector = (cursor->sector + 1 < log->sectors) ? cursor->sector + 1 : 0;
+        cursor->sectorsLeft--;
+        cursor->offset = 0;
+    }
+    return 0;
+}
+/*********************************************************************
+ * @fn      nvsLog_readCurrent
+ *
+ * @brief   Read the record last returned by nvsLog_readNext again, e.g. in full after a truncated
+ *          read
+ *
+ * @param   log - log instance
+ *          cursor - read position
+ *          data - destination
+ *          maxLength - size of the destination
+ *
+ * @return  bytes copied
+ */
+uint16_t nvsLog_readCurrent( nvsLog_t *log, nvsLog_cursor_t *cursor, void *data, uint16_t maxLength )
+{
+    size_t dataOffset = (size_t) cursor->sector * NVS_LOG_SECTOR_SIZE + cursor->offset - NVS_LOG_RECORD_SIZE(cursor->length) +
+                        sizeof(nvsLog_recordHeader_t);
+    if (cursor->length < maxLength)
+    {
+        maxLength = cursor->length;
+    }
+    log->nvsManager->nvsLog_NVS_Read(dataOffset, data, maxLength);
+    return maxLength;
+}
+/*********************************************************************
+ * @fn      nvsLog_rotate
+ *
+ * @brief   Erase and format the sector after the current one.  The records in it are the oldest
+ *          in the log and are dropped, with the newest record of any tag that was not written again
+ *          (nvsLog_isExpiring).
+ *
+ * @param   log - log instance
+ *
+ * @return  none
+ */
+static void nvsLog_rotate(nvsLog_t *log)
+{
+    nvsLog_sectorHeader_t sectorHeader;
+    size_t sectorOffset;
+    uint8_t tag;
+
+    log->sector = (log->sector + 1 < log->sectors) ? log->sector + 1 : 0;
+    sectorOffset = (size_t) log->sector * NVS_LOG_SECTOR_SIZE;
+    log->nvsManager->nvsLog_NVS_Read(sectorOffset, &sectorHeader, sizeof(sectorHeader));
+    sectorHeader.eraseCount = (sectorHeader.magic == NVS_LOG_MAGIC) ? sectorHeader.eraseCount + 1 : 1;
+    sectorHeader.magic = NVS_LOG_MAGIC;
+    log->nvsManager->nvsLog_NVS_Erase(sectorOffset);
+    log->nvsManager->nvsLog_NVS_Program(sectorOffset, &sectorHeader, sizeof(sectorHeader));
+    log->writeOffset = sizeof(sectorHeader);
+    for (tag = 0; tag < NVS_LOG_TAGS; tag++)
+    {
+        if ((log->latest[tag] != 0) && (log->latest[tag] / NVS_LOG_SECTOR_SIZE == log->sector))
+        {
+            log->latest[tag] = 0;
+        }
+    }
+}
+/*********************************************************************
+ * @fn      nvsLog_readRecord
+ *
+ * @brief   Read a record header and check the record against its CRC
+ *
+ * @param   log - log instance
+ *          sector - sector of the record
+ *          offset - offset of the record in the sector
+ *          header - destination of the record header
+ *
+ * @return  NVS_LOG_RECORD_VALID, NVS_LOG_RECORD_BLANK or NVS_LOG_RECORD_CORRUPT
+ */
+static uint8_t nvsLog_readRecord(nvsLog_t *log, uint8_t sector, uint16_t offset, nvsLog_recordHeader_t *header)
+{
+    uint8_t  chunk[NVS_LOG_CHUNK];
+    uint16_t crc;
+    uint16_t done;
+    uint16_t length;
+    size_t   dataOffset = (size_t) sector * NVS_LOG_SECTOR_SIZE + offset + sizeof(*header);
+
+    log->nvsManager->nvsLog_NVS_Read(dataOffset - sizeof(*header), header, sizeof(*header));
+    if (header->length == NVS_LOG_BLANK_LENGTH)
+    {
+        return NVS_LOG_RECORD_BLANK;
+    }
+    length = NVS_LOG_RECORD_LENGTH(header->length);
+    if ((length > NVS_LOG_MAX_LENGTH) || (offset + NVS_LOG_RECORD_SIZE(length) > NVS_LOG_SECTOR_SIZE))
+    {
+        return NVS_LOG_RECORD_CORRUPT;
+    }
+    crc = nvsLog_crc(NVS_LOG_CRC_INIT, (const uint8_t *) &header->sequence, sizeof(header->sequence));
+    crc = nvsLog_crc(crc, (const uint8_t *) &header->length, sizeof(header->length));
+    for (done = 0; done < length; done += NVS_LOG_CHUNK)
+    {
+        uint16_t n = (length - done < NVS_LOG_CHUNK) ? length - done : NVS_LOG_CHUNK;
+        log->nvsManager->nvsLog_NVS_Read(dataOffset + done, chunk, n);
+        crc = nvsLog_crc(crc, chunk, n);
+    }
+    return (crc == header->crc) ? NVS_LOG_RECORD_VALID : NVS_LOG_RECORD_CORRUPT;
+}
+/*********************************************************************
+ * @fn      nvsLog_crc
+ *
+ * @brief   CRC-16/CCITT, bit by bit - no table in RAM or flash
+ *
+ * @param   crc - running CRC, NVS_LOG_CRC_INIT to start
+ *          data - bytes
+ *          length - number of bytes
+ *
+ * @return  updated CRC
+ */
+static uint16_t nvsLog_crc(uint16_t crc, const uint8_t *data, size_t length)
+{
+    uint8_t bit;
+    while (length--)
+    {
+        crc ^= (uint16_t) (*data++) << 8;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ NVS_LOG_CRC_POLY) : (uint16_t) (crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,133 @@
+/**********************************************************************************************
+ * nvsLog.h
+ *
+ * Description:    Append only record log over two or more internal flash sectors.
+ *
+ *                 Records are programmed into erased flash one after the other, each with a
+ *                 sequence number and a CRC.  A sector is erased only when the log wraps around
+ *                 onto it, so a sector takes about NVS_LOG_SECTOR_SIZE / record size records per
+ *                 erase and the sectors wear evenly.  The older sectors keep the previous records
+ *                 while the newest one is being filled, so a power loss during a write costs at
+ *                 most the record being written.
+ *
+ *                 Every record carries a small tag, so several owners can share one log.  At power
+ *                 on nvsLog_init checks every record once and keeps the position of the newest
+ *                 record of each tag (NVS_LOG_TAGS offsets in RAM); nvsLog_readLatest reads it
+ *                 back without a scan.  nvsLog_isExpiring tells an owner that its newest record is
+ *                 in the sector erased next, so it can write it again before it is lost.
+ *
+ *                 nvsLog_reserve lets a caller do the erase ahead of time, so that a later append
+ *                 only programs (bounded write at power off).
+ *
+ *                 nvsLog_readFirst / nvsLog_readNext stream every valid record, oldest first, with
+ *                 a small cursor.
+ *
+ *                 Offsets passed to the NVS manager are relative to the start of the log area.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_NVSLOG_H_
+#define APPLICATION_NVSLOG_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define NVS_LOG_SECTOR_SIZE             0x1000          // CC2640R2 flash sector
+#define NVS_LOG_MAGIC                   0x314C4F47      // "GOL1" - formatted log sector
+#define NVS_LOG_ALIGN                   4               // records start on a word boundary
+#define NVS_LOG_BLANK_LENGTH            0xFFFF          // length of an unprogrammed record header
+#define NVS_LOG_MAX_LENGTH              (NVS_LOG_SECTOR_SIZE - sizeof(nvsLog_sectorHeader_t) - sizeof(nvsLog_recordHeader_t))
+#define NVS_LOG_MAX_SECTORS             16              // record positions are kept in 16 bits
+#define NVS_LOG_TAGS                    8               // tags with a newest record position in RAM, 0 to NVS_LOG_TAGS - 1
+
+// The tag is kept in the top bits of the record length
+#define NVS_LOG_TAG_SHIFT               12
+#define NVS_LOG_LENGTH_MASK             0x0FFF
+#define NVS_LOG_RECORD_LENGTH(length)   ((length) & NVS_LOG_LENGTH_MASK)
+#define NVS_LOG_RECORD_TAG(length)      ((uint8_t) ((length) >> NVS_LOG_TAG_SHIFT))
+
+// Flash taken by a record: header and data padded to NVS_LOG_ALIGN
+#define NVS_LOG_RECORD_SIZE(length)     (sizeof(nvsLog_recordHeader_t) + (((length) + NVS_LOG_ALIGN - 1) & ~(NVS_LOG_ALIGN - 1)))
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef void (*nvsLog_NVS_Read)(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize);
+typedef void (*nvsLog_NVS_Program)(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
+typedef void (*nvsLog_NVS_Erase)(size_t nvsOffset);
+typedef struct
+{
+    nvsLog_NVS_Read     nvsLog_NVS_Read;                    // read from the log area
+    nvsLog_NVS_Program  nvsLog_NVS_Program;                 // program erased flash, no erase - task context only
+    nvsLog_NVS_Erase    nvsLog_NVS_Erase;                   // erase the sector at the offset - task context only
+}nvsLog_nvsManager_t;
+
+// First word pair of every formatted sector
+typedef struct
+{
+    uint32_t magic;                                         // NVS_LOG_MAGIC
+    uint32_t eraseCount;                                    // erases of this sector, for wear monitoring
+}nvsLog_sectorHeader_t;
+
+// Header programmed in front of every record; the record data follows, padded to NVS_LOG_ALIGN
+typedef struct
+{
+    uint16_t length;                                        // data length in bytes and tag << NVS_LOG_TAG_SHIFT, NVS_LOG_BLANK_LENGTH if unprogrammed
+    uint16_t crc;                                           // CRC-16/CCITT of sequence number, length and tag, and data
+    uint32_t sequence;                                      // increases by one per record over the life of the log
+}nvsLog_recordHeader_t;
+
+// Log instance - one per log area
+typedef struct
+{
+    nvsLog_nvsManager_t *nvsManager;
+    uint8_t  sectors;                                       // sectors in the log area, 2 to NVS_LOG_MAX_SECTORS
+    uint8_t  sector;                                        // sector being filled
+    uint16_t writeOffset;                                   // offset of the next record in that sector, NVS_LOG_SECTOR_SIZE when full
+    uint32_t sequence;                                      // sequence number of the next record
+    uint16_t latest[NVS_LOG_TAGS];                          // offset in the area of the newest record of each tag, 0 if none
+}nvsLog_t;
+
+// Read position of nvsLog_readNext, and the record it read last
+typedef struct
+{
+    uint8_t  sector;                                        // sector being read
+    uint8_t  sectorsLeft;                                   // sectors still to read, this one included
+    uint16_t offset;                                        // offset of the next record in the sector
+    uint16_t length;                                        // length of the record read
+    uint8_t  tag;                                           // tag of the record read
+    uint32_t sequence;                                      // sequence number of the record read
+}nvsLog_cursor_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void nvsLog_init( nvsLog_t *log, nvsLog_nvsManager_t *nvsManager, uint8_t sectors );
+extern uint8_t nvsLog_append( nvsLog_t *log, uint8_t tag, const void *data, uint16_t length );
+extern uint8_t nvsLog_hasRoom( nvsLog_t *log, uint16_t length );
+extern uint8_t nvsLog_reserve( nvsLog_t *log, uint16_t length );
+extern uint8_t nvsLog_isExpiring( nvsLog_t *log, uint8_t tag );
+extern uint16_t nvsLog_readLatest( nvsLog_t *log, uint8_t tag, void *data, uint16_t maxLength );
+extern void nvsLog_readFirst( nvsLog_t *log, nvsLog_cursor_t *cursor );
+extern uint8_t nvsLog_readNext( nvsLog_t *log, nvsLog_cursor_t *cursor, void *data, uint16_t maxLength );
+extern uint16_t nvsLog_readCurrent( nvsLog_t *log, nvsLog_cursor_t *cursor, void *data, uint16_t maxLength );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_NVSLOG_H_ */
@@ -17,11 +17,15 @@
 #include "simple_peripheral.h"
 #include "Controller.h"
 #include "dataAnalysis.h"
+#include "brakeAndThrottle.h"
+#include "blackBox.h"
 #include "simple_peripheral.h"
 #include <icall.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <xdc/runtime/Types.h>
+#include <xdc/runtime/Timestamp.h>
 /*********************************************************************
  * CONSTANTS
  */
@@ -35,6 +39,7 @@ static motorcontrol_timerManager_t *motorcontrol_hftimerManager;
 static motorcontrol_timerManager_t *motorcontrol_lftimerManager;
 static simplePeripheral_bleCBs_t *motorcontrol_BLE_GATT;
 static uint8_t state = PERIODIC_COMMUNICATION_DEACTIVATE;
+static uint32_t hfCallbackMaxTicks = 0;     // worst case time spent in periodicCommunication_hf_communication, Timestamp ticks
 
 /**********************************************************************
  *  Local functions
@@ -165,13 +170,14 @@ void periodicCommunication_registerBLE_Gatt(simplePeripheral_bleCBs_t *obj)
 uint8_t x_hf = 1;
 uint16_t x_tt = 0;
 uint16_t STM32MCP_batteryVoltage;
-uint16_t STM32MCP_batteryCurrent;
+int16_t STM32MCP_batteryCurrent;
 uint16_t STM32MCP_rpm;
 int8_t STM32MCP_heatSinkTemp;
 int8_t STM32MCP_motorTemp;
 
 void periodicCommunication_hf_communication()
 {
+    uint32_t startTicks = Timestamp_get32();
     /*************************************************
      *  Get Bus Voltage
      *  Get Bus Current
@@ -187,10 +193,15 @@ void periodicCommunication_hf_communication()
     STM32MCP_batteryVoltage = 6000 *sin(M_PI * x_tt /180) + 36000;                               // get battery voltage from MCU:  unit in mV
     //STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_BUS_CURRENT_REG_ID);       // Need to create a getRegisterFrame for battery current
     // Sim Battery Current
-    STM32MCP_batteryCurrent = 3000; //rand()%13 * 1000;                                          // get battery current from MCU:  unit in mA
+    STM32MCP_batteryCurrent = 3000; //rand()%13 * 1000;                                          // get battery current from MCU:  unit in mA, negative when regen braking
     //STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_SPEED_MEASURED_REG_ID);    // is speed in RPM
     // Sim RPM
     STM32MCP_rpm = 350 * sin(M_PI * x_tt / 60) + 380;                                            // get RPM from MCU:  unit in rpm,  188 rpm @ r = 0.1016m => 200 cm/sec = 7 km/hr
+    // Sim regen battery current: phase current (IQ 15750 = 14.0 Amp) scaled by back-emf, i.e. rpm / maximum rpm
+    if (brakeAndThrottle_getRegenIQ() < 0)
+    {
+        STM32MCP_batteryCurrent = (int32_t) brakeAndThrottle_getRegenIQ() * 14000 / BRAKE_AND_THROTTLE_TORQUEIQ_MAX * STM32MCP_rpm / BRAKE_AND_THROTTLE_MAXIMUMN_SPEED;
+    }
     //STM32MCP_getRegisterFrame(STM32MCP_MOTOR_1_ID,STM32MCP_HEATSINK_TEMPERATURE_REG_ID);
     // Sim Heatsink Temp
     STM32MCP_heatSinkTemp = 20 *sin(M_PI * x_tt /180) + 15;                        // temperature is shifted by 20 degrees for taking care of - negative temperature
@@ -200,6 +211,8 @@ void periodicCommunication_hf_communication()
     STM32MCP_motorTemp = 30 *sin(M_PI * x_tt /180) + 20;                            // temperature is shifted by 20 degrees for taking care of - negative temperature
                                                                                         // get motor temperature from MCU: unit in degrees Celsius
 
+    blackBox_telemetry(STM32MCP_rpm, STM32MCP_batteryVoltage);                                  // before the sample wakes the analytics task, which programs it
+
     // Passing motor sensor data to data analysis
     dataAnalysis_sampling(x_hf, STM32MCP_batteryVoltage, STM32MCP_batteryCurrent, STM32MCP_rpm, STM32MCP_heatSinkTemp, STM32MCP_motorTemp);
 
@@ -210,6 +223,32 @@ void periodicCommunication_hf_communication()
         x_hf = 1;
     }
 
+    uint32_t elapsedTicks = Timestamp_get32() - startTicks;
+    if (elapsedTicks > hfCallbackMaxTicks)
+    {
+        hfCallbackMaxTicks = elapsedTicks;
+    }
+}
+
+/*********************************************************************
+ * @fn      periodicCommunication_getHfCallbackMaxUs
+ *
+ * @brief   Worst case time spent in the hf clock callback.  The analytics that used to run in the
+ *          callback are measured separately by dataAnalysis_getProcessMaxUs.
+ *
+ * @param   none
+ *
+ * @return  worst case in micro-seconds
+ *********************************************************************/
+uint32_t periodicCommunication_getHfCallbackMaxUs()
+{
+    Types_FreqHz freq;
+    Timestamp_getFreq(&freq);
+    if (freq.lo == 0)
+    {
+        return 0;
+    }
+    return (uint32_t) (((uint64_t) hfCallbackMaxTicks * 1000000) / freq.lo);
 }
 
 /*********************************************************************
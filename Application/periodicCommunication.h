@@ -61,6 +61,7 @@ extern void periodicCommunication_register_hfTimer(motorcontrol_timerManager_t *
 extern void periodicCommunication_register_lfTimer(motorcontrol_timerManager_t *obj);
 extern void periodicCommunication_registerBLE_Gatt(simplePeripheral_bleCBs_t *obj);
 extern void periodicCommunication_hf_communication();
+extern uint32_t periodicCommunication_getHfCallbackMaxUs();
 extern void periodicCommunication_lf_communication();
 extern uint8_t periodicCommunication_getxlf();
 extern uint8_t periodicCommunication_getxhf();
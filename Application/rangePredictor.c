@@ -0,0 +1,347 @@
+/******************************************************************************
+
+ @file  rangePredictor.c
+
+ @brief This file contains the recursive least squares range predictor.
+        It is updated once per analytics window from dataAnalyt.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include "rangePredictor.h"
+#include "dataAnalysis.h"
+#include "fixedPoint.h"
+#include "Controller.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define RANGE_PREDICTOR_X_ONE           ((int32_t) 1 << RANGE_PREDICTOR_X_SHIFT)
+#define RANGE_PREDICTOR_X_MAX           (2 * RANGE_PREDICTOR_X_ONE)
+#define RANGE_PREDICTOR_LAMBDA_Q20      FIXEDPOINT_QN(RANGE_PREDICTOR_LAMBDA, RANGE_PREDICTOR_P_SHIFT)
+#define RANGE_PREDICTOR_INV_LAMBDA_Q20  FIXEDPOINT_QN(1.0 / RANGE_PREDICTOR_LAMBDA, RANGE_PREDICTOR_P_SHIFT)
+#define RANGE_PREDICTOR_P_INIT_Q20      FIXEDPOINT_QN(RANGE_PREDICTOR_P_INIT, RANGE_PREDICTOR_P_SHIFT)
+#define RANGE_PREDICTOR_P_TRACE_MAX_Q20 FIXEDPOINT_QN(RANGE_PREDICTOR_P_TRACE_MAX, RANGE_PREDICTOR_P_SHIFT)
+#define RANGE_PREDICTOR_ERROR_MAX       ((int32_t) 32767 << RANGE_PREDICTOR_THETA_SHIFT)   // keeps k x e within 63 bits
+#define RANGE_PREDICTOR_ENERGY          ((uint32_t) FIXEDPOINT_ROUND(BATTERY_MAX_CAPACITY * BCF))   // usable mW-hr at 100 %
+
+// The Controller characteristic must hold the whole report
+typedef char rangePredictor_reportLenCheck[(CONTROLLER_RANGE_LEN == RANGE_PREDICTOR_REPORT_LEN) ? 1 : -1];
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int32_t  theta[RANGE_PREDICTOR_FEATURES];                            // coefficients, Q8 W-hr/km x 100 per unit feature
+static int32_t  P[RANGE_PREDICTOR_FEATURES][RANGE_PREDICTOR_FEATURES];      // covariance, Q20
+static int32_t  xAvg[RANGE_PREDICTOR_FEATURES];                             // recent riding conditions, Q14
+static uint32_t residualVar;                                                // variance of the published prediction error, (W-hr/km x 100)^2
+static uint16_t updates;                                                    // windows fitted, saturates
+
+/**********************************************************************
+ *  Local functions
+ */
+static void rangePredictor_resetCovariance(void);
+static int32_t rangePredictor_clampFeature(int32_t x);
+static void rangePredictor_features(uint8_t avgSpeed_kph, uint8_t speedMode, int8_t temperature_C, int32_t *x);
+static void rangePredictor_covarianceProduct(const int32_t *x, int64_t *Px);
+static uint32_t rangePredictor_rangeFor(uint16_t soc, uint32_t economy_100Whpk);
+
+/*********************************************************************
+ * @fn      rangePredictor_init
+ *
+ * @brief   Start with no knowledge of the consumption: zero coefficients and a large covariance
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void rangePredictor_init( void )
+{
+    memset(theta, 0, sizeof(theta));
+    memset(xAvg, 0, sizeof(xAvg));
+    residualVar = 0;
+    updates = 0;
+    rangePredictor_resetCovariance();
+}
+/*********************************************************************
+ * @fn      rangePredictor_resetCovariance
+ *
+ * @brief   P = RANGE_PREDICTOR_P_INIT x I
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void rangePredictor_resetCovariance(void)
+{
+    uint8_t ii;
+    memset(P, 0, sizeof(P));
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        P[ii][ii] = RANGE_PREDICTOR_P_INIT_Q20;
+    }
+}
+/*********************************************************************
+ * @fn      rangePredictor_clampFeature
+ *
+ * @brief   Limit a feature to +-2.0 so the fixed point products cannot overflow
+ *
+ * @param   x - feature in Q14
+ *
+ * @return  clamped feature
+ */
+static int32_t rangePredictor_clampFeature(int32_t x)
+{
+    if (x > RANGE_PREDICTOR_X_MAX)
+    {
+        return RANGE_PREDICTOR_X_MAX;
+    }
+    if (x < -RANGE_PREDICTOR_X_MAX)
+    {
+        return -RANGE_PREDICTOR_X_MAX;
+    }
+    return x;
+}
+/*********************************************************************
+ * @fn      rangePredictor_features
+ *
+ * @brief   Feature vector of a window: 1, v / 32 km/hr, (v / 32 km/hr)^2, speed mode / 2, temperature / 64 C
+ *
+ * @param   avgSpeed_kph - average speed of the window
+ *          speedMode - BRAKE_AND_THROTTLE_SPEED_MODE_xxx
+ *          temperature_C - average heat sink temperature of the window
+ *          x - destination, RANGE_PREDICTOR_FEATURES features in Q14
+ *
+ * @return  none
+ */
+static void rangePredictor_features(uint8_t avgSpeed_kph, uint8_t speedMode, int8_t temperature_C, int32_t *x)
+{
+    x[0] = RANGE_PREDICTOR_X_ONE;
+    x[1] = rangePredictor_clampFeature(((int32_t) avgSpeed_kph << RANGE_PREDICTOR_X_SHIFT) / RANGE_PREDICTOR_SPEED_SCALE);
+    x[2] = rangePredictor_clampFeature((x[1] * x[1]) >> RANGE_PREDICTOR_X_SHIFT);
+    x[3] = rangePredictor_clampFeature(((int32_t) speedMode << RANGE_PREDICTOR_X_SHIFT) / 2);
+    x[4] = rangePredictor_clampFeature(((int32_t) temperature_C << RANGE_PREDICTOR_X_SHIFT) / RANGE_PREDICTOR_TEMP_SCALE);
+}
+/*********************************************************************
+ * @fn      rangePredictor_covarianceProduct
+ *
+ * @brief   P x
+ *
+ * @param   x - features, Q14
+ *          Px - destination, Q20
+ *
+ * @return  none
+ */
+static void rangePredictor_covarianceProduct(const int32_t *x, int64_t *Px)
+{
+    uint8_t ii;
+    uint8_t jj;
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        int64_t acc = 0;
+        for (jj = 0; jj < RANGE_PREDICTOR_FEATURES; jj++)
+        {
+            acc += (int64_t) P[ii][jj] * x[jj];
+        }
+        Px[ii] = acc >> RANGE_PREDICTOR_X_SHIFT;
+    }
+}
+/*********************************************************************
+ * @fn      rangePredictor_update
+ *
+ * @brief   Fit the economy of a finished window:
+ *              e = y - theta.x,  k = P x / (lambda + x.P x),  theta += k e,  P = (P - k (P x)') / lambda
+ *          Forgetting is suspended while trace(P) > RANGE_PREDICTOR_P_TRACE_MAX so directions that are
+ *          not excited (e.g. a constant speed mode) do not wind up, and P is reset if rounding ever
+ *          makes it lose positive definiteness.
+ *
+ * @param   avgSpeed_kph - average speed of the window
+ *          speedMode - BRAKE_AND_THROTTLE_SPEED_MODE_xxx
+ *          temperature_C - average heat sink temperature of the window
+ *          economy_100Whpk - instant economy of the window, W-hr/km x 100
+ *          deltaMileage_dm - distance of the window
+ *
+ * @return  none
+ */
+void rangePredictor_update( uint8_t avgSpeed_kph, uint8_t speedMode, int8_t temperature_C, uint16_t economy_100Whpk, uint32_t deltaMileage_dm )
+{
+    int32_t x[RANGE_PREDICTOR_FEATURES];
+    int64_t Px[RANGE_PREDICTOR_FEATURES];
+    int64_t k[RANGE_PREDICTOR_FEATURES];
+    int64_t s = RANGE_PREDICTOR_LAMBDA_Q20;
+    int64_t yHat = 0;
+    int64_t yPublished = 0;
+    int64_t trace = 0;
+    int32_t e;
+    uint8_t ii;
+    uint8_t jj;
+
+    if ((deltaMileage_dm < RANGE_PREDICTOR_MIN_DISTANCE_DM) || (economy_100Whpk == 65535))
+    {
+        return;
+    }
+    rangePredictor_features(avgSpeed_kph, speedMode, temperature_C, x);
+    rangePredictor_covarianceProduct(x, Px);
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        s += (x[ii] * Px[ii]) >> RANGE_PREDICTOR_X_SHIFT;
+        yHat += (int64_t) theta[ii] * x[ii];
+        yPublished += (int64_t) theta[ii] * xAvg[ii];
+        trace += P[ii][ii];
+    }
+    // a priori error, Q8
+    e = fixedPoint_sat32(((int64_t) economy_100Whpk << RANGE_PREDICTOR_THETA_SHIFT) - (yHat >> RANGE_PREDICTOR_X_SHIFT));
+    if (e > RANGE_PREDICTOR_ERROR_MAX)
+    {
+        e = RANGE_PREDICTOR_ERROR_MAX;
+    }
+    else if (e < -RANGE_PREDICTOR_ERROR_MAX)
+    {
+        e = -RANGE_PREDICTOR_ERROR_MAX;
+    }
+    // Variance of the error of the economy published for the recent conditions, so the band covers the
+    // window to window changes of speed and temperature as well as the model residual.  Accumulated from
+    // the first errors of a model that has seen every feature at least once.
+    if (updates >= RANGE_PREDICTOR_FEATURES)
+    {
+        int32_t eInt = fixedPoint_sat32((int64_t) economy_100Whpk - fixedPoint_roundShift(yPublished >> RANGE_PREDICTOR_X_SHIFT, RANGE_PREDICTOR_THETA_SHIFT));
+        uint32_t e2;
+        if (eInt > 32767)
+        {
+            eInt = 32767;
+        }
+        else if (eInt < -32767)
+        {
+            eInt = -32767;
+        }
+        e2 = (uint32_t) (eInt * eInt);
+        if (updates == RANGE_PREDICTOR_FEATURES)
+        {
+            residualVar = e2;
+        }
+        else
+        {
+            residualVar = (uint32_t) ((int64_t) residualVar + (((int64_t) e2 - (int64_t) residualVar) >> RANGE_PREDICTOR_AVG_SHIFT));
+        }
+    }
+    // gain and coefficients
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        k[ii] = (Px[ii] << RANGE_PREDICTOR_P_SHIFT) / s;
+        theta[ii] = fixedPoint_sat32((int64_t) theta[ii] + ((k[ii] * e) >> RANGE_PREDICTOR_P_SHIFT));
+    }
+    // covariance, upper triangle mirrored to keep it symmetric
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        for (jj = ii; jj < RANGE_PREDICTOR_FEATURES; jj++)
+        {
+            int64_t p = (int64_t) P[ii][jj] - ((k[ii] * Px[jj]) >> RANGE_PREDICTOR_P_SHIFT);
+            if (trace <= RANGE_PREDICTOR_P_TRACE_MAX_Q20)
+            {
+                p = (p * RANGE_PREDICTOR_INV_LAMBDA_Q20) >> RANGE_PREDICTOR_P_SHIFT;
+            }
+            P[ii][jj] = fixedPoint_sat32(p);
+            P[jj][ii] = P[ii][jj];
+        }
+    }
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        if (P[ii][ii] <= 0)
+        {
+            rangePredictor_resetCovariance();
+            break;
+        }
+    }
+    // recent riding conditions the range is predicted for
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        xAvg[ii] = (updates == 0) ? x[ii] : xAvg[ii] + ((x[ii] - xAvg[ii]) >> RANGE_PREDICTOR_AVG_SHIFT);
+    }
+    if (updates < 0xFFFF)
+    {
+        updates++;
+    }
+}
+/*********************************************************************
+ * @fn      rangePredictor_rangeFor
+ *
+ * @brief   Distance the remaining energy lasts at a given economy
+ *
+ * @param   soc - state of charge in 0.01 %
+ *          economy_100Whpk - W-hr/km x 100, at least RANGE_PREDICTOR_ECONOMY_MIN
+ *
+ * @return  range in metres
+ */
+static uint32_t rangePredictor_rangeFor(uint16_t soc, uint32_t economy_100Whpk)
+{
+    // 10000 x RANGE_PREDICTOR_ENERGY < 2^32
+    return ((uint32_t) soc * RANGE_PREDICTOR_ENERGY) / (economy_100Whpk * 100);
+}
+/*********************************************************************
+ * @fn      rangePredictor_predict
+ *
+ * @brief   Range and band for the recent riding conditions.  The economy is theta.xAvg and its
+ *          variance sigma^2 (1 + xAvg.P xAvg).  Until RANGE_PREDICTOR_MIN_UPDATES windows have been
+ *          fitted, the average economy is used and the band is empty.
+ *
+ * @param   soc - state of charge in 0.01 %
+ *          averageEconomy_100Whpk - economy over the stored history, W-hr/km x 100
+ *          range - destination
+ *
+ * @return  none
+ */
+void rangePredictor_predict( uint16_t soc, uint16_t averageEconomy_100Whpk, rangePredictor_range_t *range )
+{
+    int64_t Px[RANGE_PREDICTOR_FEATURES];
+    int64_t yHat = 0;
+    int64_t h = 0;
+    int32_t economy;
+    uint32_t band;
+    uint64_t variance;
+    uint8_t ii;
+
+    if (updates < RANGE_PREDICTOR_MIN_UPDATES)
+    {
+        range->range_m = (averageEconomy_100Whpk == 0) ? 0 : rangePredictor_rangeFor(soc, averageEconomy_100Whpk);
+        range->rangeLow_m = range->range_m;
+        range->rangeHigh_m = range->range_m;
+        return;
+    }
+    rangePredictor_covarianceProduct(xAvg, Px);
+    for (ii = 0; ii < RANGE_PREDICTOR_FEATURES; ii++)
+    {
+        yHat += (int64_t) theta[ii] * xAvg[ii];
+        h += (xAvg[ii] * Px[ii]) >> RANGE_PREDICTOR_X_SHIFT;
+    }
+    economy = (int32_t) fixedPoint_roundShift(yHat >> RANGE_PREDICTOR_X_SHIFT, RANGE_PREDICTOR_THETA_SHIFT);
+    if (economy < RANGE_PREDICTOR_ECONOMY_MIN)
+    {
+        economy = RANGE_PREDICTOR_ECONOMY_MIN;
+    }
+    variance = (uint64_t) residualVar + (((uint64_t) residualVar * (uint64_t) h) >> RANGE_PREDICTOR_P_SHIFT);
+    band = RANGE_PREDICTOR_BAND_SIGMAS * (uint32_t) fixedPoint_sqrt32((variance > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) variance);
+
+    range->range_m = rangePredictor_rangeFor(soc, economy);
+    range->rangeLow_m = rangePredictor_rangeFor(soc, economy + band);
+    range->rangeHigh_m = rangePredictor_rangeFor(soc, (economy > (int32_t) band + RANGE_PREDICTOR_ECONOMY_MIN) ? economy - band : RANGE_PREDICTOR_ECONOMY_MIN);
+}
+/*********************************************************************
+ * @fn      rangePredictor_getReport
+ *
+ * @brief   Pack a range into the RANGE_PREDICTOR_REPORT_LEN byte report (little endian)
+ *
+ * @param   range - predicted range and band
+ *          report - destination, RANGE_PREDICTOR_REPORT_LEN bytes
+ *
+ * @return  none
+ */
+void rangePredictor_getReport( rangePredictor_range_t *range, uint8_t *report )
+{
+    uint8_t ii;
+    for (ii = 0; ii < 4; ii++)
+    {
+        report[ii]     = (range->range_m >> (8 * ii)) & 0xFF;
+        report[ii + 4] = (range->rangeLow_m >> (8 * ii)) & 0xFF;
+        report[ii + 8] = (range->rangeHigh_m >> (8 * ii)) & 0xFF;
+    }
+}
@@ -0,0 +1,78 @@
+/**********************************************************************************************
+ * rangePredictor.h
+ *
+ * Description:    Range prediction from a recursive least squares model of energy consumption.
+ *
+ *                 At the end of each analytics window the instant economy (W-hr/km x 100) is fitted
+ *                 online to the features [1, v, v^2, speed mode, heat sink temperature] with an
+ *                 exponential forgetting factor.  The range is the remaining energy divided by the
+ *                 economy the model predicts for the recent riding conditions, with a band of
+ *                 +- RANGE_PREDICTOR_BAND_SIGMAS standard deviations of the prediction.
+ *
+ *                 Fixed point: features Q14, coefficients Q8, covariance Q20.  Memory and time per
+ *                 window are constant; the update is one pass over the 5 x 5 covariance matrix.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_RANGEPREDICTOR_H_
+#define APPLICATION_RANGEPREDICTOR_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define RANGE_PREDICTOR_FEATURES        5               // 1, v, v^2, speed mode, heat sink temperature
+#define RANGE_PREDICTOR_X_SHIFT         14              // features in Q14, each clamped to +-2.0
+#define RANGE_PREDICTOR_THETA_SHIFT     8               // coefficients in Q8 of W-hr/km x 100
+#define RANGE_PREDICTOR_P_SHIFT         20              // covariance in Q20
+#define RANGE_PREDICTOR_SPEED_SCALE     32              // km/hr for a speed feature of 1.0
+#define RANGE_PREDICTOR_TEMP_SCALE      64              // degrees Celsius for a temperature feature of 1.0
+#define RANGE_PREDICTOR_LAMBDA          0.99            // forgetting factor: memory of about 100 windows
+#define RANGE_PREDICTOR_P_INIT          10.0            // initial covariance diagonal
+#define RANGE_PREDICTOR_P_TRACE_MAX     64.0            // forgetting is suspended above this trace (no wind-up while cruising);
+                                                        // at most 64 so k x (P x) stays within 63 bits for |x| <= 2
+#define RANGE_PREDICTOR_MIN_DISTANCE_DM 30              // windows shorter than this are not fitted (economy undefined when stopped)
+#define RANGE_PREDICTOR_MIN_UPDATES     8               // fitted windows before the model replaces the average economy
+#define RANGE_PREDICTOR_AVG_SHIFT       3               // recent features and residual variance: 1/8 per window
+#define RANGE_PREDICTOR_BAND_SIGMAS     2               // band half width in standard deviations (about 95 %)
+#define RANGE_PREDICTOR_ECONOMY_MIN     100             // 1 W-hr/km - lowest economy used to compute a range
+
+// Range report (Controller range characteristic, little endian)
+//      [0] predicted range m (4)   [4] lower bound m (4)   [8] upper bound m (4)
+#define RANGE_PREDICTOR_REPORT_LEN      12
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+    uint32_t range_m;                                   // predicted range
+    uint32_t rangeLow_m;                                // lower bound of the band
+    uint32_t rangeHigh_m;                               // upper bound of the band
+}rangePredictor_range_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void rangePredictor_init( void );
+extern void rangePredictor_update( uint8_t avgSpeed_kph, uint8_t speedMode, int8_t temperature_C, uint16_t economy_100Whpk, uint32_t deltaMileage_dm );
+extern void rangePredictor_predict( uint16_t soc, uint16_t averageEconomy_100Whpk, rangePredictor_range_t *range );
+extern void rangePredictor_getReport( rangePredictor_range_t *range, uint8_t *report );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_RANGEPREDICTOR_H_ */
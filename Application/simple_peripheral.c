@@ -90,6 +90,7 @@
 #include "UDHAL/UDHAL.h"
 #include "STM32MCP/STM32MCP.h"
 #include "periodicCommunication.h"
+#include "nvsJob.h"
 /*********************************************************************
  * CONSTANTS
  */
@@ -197,7 +198,7 @@ Task_Struct sbpTask;
 Char sbpTaskStack[SBP_TASK_STACK_SIZE];
 
 // Scan response data (max size = 31 bytes)
-static uint8_t scanRspData[] =
+static const uint8_t scanRspData[] =
 {
   // complete name // This is the name seen under Local name in advertisement data
   0x09,
@@ -220,7 +221,7 @@ static uint8_t scanRspData[] =
 
 // Advertisement data (max size = 31 bytes, though this is
 // best kept short to conserve power while advertising)
-static uint8_t advertData[] =
+static const uint8_t advertData[] =
 {
   // Flags: this field sets the device to use general discoverable
   // mode (advertises indefinitely) instead of general
@@ -241,7 +242,7 @@ static uint8_t advertData[] =
 };
 
 // GAP GATT Attributes: GAP_DEVICE_NAME_LEN = 21
-static uint8_t attDeviceName[GAP_DEVICE_NAME_LEN] = "GENEV Go";    // this is the name seen during advertising - shall be device name: GENEV GO
+static const uint8_t attDeviceName[GAP_DEVICE_NAME_LEN] = "GENEV Go";    // this is the name seen during advertising - shall be device name: GENEV GO
 
 /*********************************************************************
  * LOCAL FUNCTIONS
@@ -317,7 +318,8 @@ typedef enum
    FOR_AOA_SCAN       = 1,
    FOR_ATT_RSP        = 2,
    FOR_AOA_SEND       = 4,
-   FOR_TOF_SEND       = 8
+   FOR_TOF_SEND       = 8,
+   FOR_NVS_JOB        = 16
 }connectionEventRegisterCause_u;
 
 // Handle the registration and un-registration for the connection event, since only one can be registered.
@@ -465,9 +467,9 @@ static void SimplePeripheral_init(void)
 
     GAPRole_SetParameter(GAPROLE_ADVERT_OFF_TIME, sizeof(uint16_t), &advertOffTime); // <- this sets the time / how long to remain off (in sec) after advertising stops before starting again
 
-    GAPRole_SetParameter(GAPROLE_SCAN_RSP_DATA, sizeof(scanRspData), scanRspData);
+    GAPRole_SetParameter(GAPROLE_SCAN_RSP_DATA, sizeof(scanRspData), (void *) scanRspData);
 
-    GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(advertData), advertData);
+    GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(advertData), (void *) advertData);
 
     GAPRole_SetParameter(GAPROLE_PARAM_UPDATE_ENABLE, sizeof(uint8_t), &enableUpdateRequest);
 
@@ -483,7 +485,7 @@ static void SimplePeripheral_init(void)
   // Set the Device Name characteristic in the GAP GATT Service
   // For more information, see the section in the User's Guide:
   // http://software-dl.ti.com/lprf/sdg-latest/html
-  GGS_SetParameter(GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN, attDeviceName);
+  GGS_SetParameter(GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN, (void *) attDeviceName);
  // GGS_SetParameter(GGS_APPEARANCE_ATT,  GGS_APPEARANCE_LEN, appearance);
   // Set GAP Parameters to set the advertising interval
   // For more information, see the GAP section of the User's Guide:
@@ -914,6 +916,12 @@ static void SimplePeripheral_processStateChangeEvt(gaprole_States_t newState)
 
           GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, peerAddress);
         }
+
+        // The NVS logs erase ahead between connection events
+        if (SimplePeripheral_RegistertToAllConnectionEvent(FOR_NVS_JOB) == SUCCESS)
+        {
+          nvsJob_setRadioPacing(1);
+        }
         }
         break;
 
@@ -927,6 +935,8 @@ static void SimplePeripheral_processStateChangeEvt(gaprole_States_t newState)
         {
         //Dashboard LED not lit
         attRsp_freeAttRsp(bleNotConnected);
+        nvsJob_setRadioPacing(0);
+        SimplePeripheral_UnRegistertToAllConnectionEvent(FOR_NVS_JOB);
         }
         break;
 
@@ -934,6 +944,8 @@ static void SimplePeripheral_processStateChangeEvt(gaprole_States_t newState)
         {
         //Dashboard LED not lit
         attRsp_freeAttRsp(bleNotConnected);
+        nvsJob_setRadioPacing(0);
+        SimplePeripheral_UnRegistertToAllConnectionEvent(FOR_NVS_JOB);
         }
         break;
     case GAPROLE_ERROR:
@@ -1089,6 +1101,12 @@ static void SimplePeripheral_processConnEvt(Gap_ConnEventRpt_t *pReport)
         SimplePeripheral_UnRegistertToAllConnectionEvent (FOR_ATT_RSP);
     }
   }
+
+  if( CONNECTION_EVENT_REGISTRATION_CAUSE(FOR_NVS_JOB))
+  {
+    // The radio is idle until the next connection event: allow an erase ahead
+    nvsJob_connectionEvent();
+  }
 }
 /*********************************************************************
  * @fn      SimplePeripheral_processMC_GATT_Evt
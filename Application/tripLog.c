@@ -0,0 +1,283 @@
+/******************************************************************************
+
+ @file  tripLog.c
+
+ @brief This file contains the trip segmentation and the trip log.  Samples
+        and analytics windows are added from the analytics task; the report
+        is written behind and sent to the App from the analytics task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include "tripLog.h"
+#include "writeBehind.h"
+#include "periodicCommunication.h"
+#include "motorControl.h"
+#include "Controller.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+// The report is sent as it is laid out in RAM: no padding, and the Controller characteristic holds all of it
+typedef char tripLog_summarySizeCheck[(sizeof(tripLog_summary_t) == 28) ? 1 : -1];
+typedef char tripLog_reportLenCheck[(sizeof(tripLog_report_t) == TRIP_LOG_REPORT_LEN) ? 1 : -1];
+typedef char tripLog_charLenCheck[(CONTROLLER_TRIP_LOG_LEN == TRIP_LOG_REPORT_LEN) ? 1 : -1];
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static tripLog_report_t report;
+static writeBehind_entry_t tripEntry = {WRITE_BEHIND_TAG_TRIP, &report, sizeof(report), sizeof(report), NULL, 0};
+static tripLog_summary_t trip;                                      // trip being ridden
+static uint32_t nextTrip = 1;
+static uint32_t samples = 0;                                        // samples since the trip started
+static uint16_t idleCount = 0;                                      // stopped samples in a row while riding
+static uint8_t  moveCount = 0;                                      // moving samples in a row while not riding
+static uint8_t  startPending = 0;                                   // start window not known yet
+static volatile uint8_t closePending = 0;                           // power off requested - the trip is closed in task context
+static uint8_t  publishPending = 0;                                 // report waiting to be sent from task context
+
+/**********************************************************************
+ *  Local functions
+ */
+static void tripLog_start( void );
+static void tripLog_end( uint8_t endReason );
+static void tripLog_push( const tripLog_summary_t *summary );
+
+/*********************************************************************
+ * @fn      tripLog_init
+ *
+ * @brief   Load the report saved last from the shared record log and continue the trip numbers.
+ *          A trip open when it was saved is not resumed.  Registers the report with the write
+ *          behind cache.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void tripLog_init( void )
+{
+    if ((nvsLog_readLatest(writeBehind_getLog(), WRITE_BEHIND_TAG_TRIP, &report, sizeof(report)) != sizeof(report)) ||
+        (report.summarySize != sizeof(tripLog_summary_t)) || (report.count > TRIP_LOG_REPORT_TRIPS))
+    {
+        memset(&report, 0, sizeof(report));
+        report.summarySize = sizeof(tripLog_summary_t);
+    }
+    report.riding = 0;
+    if (report.count > 0)
+    {
+        nextTrip = report.summary[0].trip + 1;
+    }
+    writeBehind_register(&tripEntry);
+    publishPending = 1;
+}
+/*********************************************************************
+ * @fn      tripLog_sample
+ *
+ * @brief   Start or end a trip, and update the peaks of the trip being ridden.  Called for every
+ *          sample, before the window it completes is added.
+ *
+ * @param   rpm - motor speed
+ *          throttleEngaged - 1 if the throttle is engaged
+ *          speed_cmph - speed in cm/s
+ *          batteryVoltage_mV - battery voltage
+ *          heatSinkTemperature_C - heat sink temperature
+ *          motorTemperature_C - motor temperature
+ *
+ * @return  none
+ */
+void tripLog_sample( uint16_t rpm, uint8_t throttleEngaged, uint16_t speed_cmph, uint16_t batteryVoltage_mV,
+                     int8_t heatSinkTemperature_C, int8_t motorTemperature_C )
+{
+    if (report.riding == 0)
+    {
+        moveCount = ((rpm >= TRIP_LOG_START_RPM) || (throttleEngaged == 1)) ? moveCount + 1 : 0;
+        if (moveCount < TRIP_LOG_START_SAMPLES)
+        {
+            return;
+        }
+        tripLog_start();
+    }
+    else
+    {
+        samples++;
+        idleCount = ((rpm < TRIP_LOG_STOP_RPM) && (throttleEngaged == 0)) ? idleCount + 1 : 0;
+        if (idleCount >= TRIP_LOG_STOP_SAMPLES)
+        {
+            tripLog_end(TRIP_LOG_END_IDLE);
+            return;
+        }
+    }
+    if (speed_cmph > trip.maxSpeed_cmph)
+    {
+        trip.maxSpeed_cmph = speed_cmph;
+    }
+    if (batteryVoltage_mV < trip.minBatteryVoltage_mV)
+    {
+        trip.minBatteryVoltage_mV = batteryVoltage_mV;
+    }
+    if (heatSinkTemperature_C > trip.maxHeatSinkTemperature_C)
+    {
+        trip.maxHeatSinkTemperature_C = heatSinkTemperature_C;
+    }
+    if (motorTemperature_C > trip.maxMotorTemperature_C)
+    {
+        trip.maxMotorTemperature_C = motorTemperature_C;
+    }
+}
+/*********************************************************************
+ * @fn      tripLog_addWindow
+ *
+ * @brief   Add the energy and distance of an analytics window to the trip being ridden
+ *
+ * @param   ADCounter - analytics window counter
+ *          energy_mWh - net energy of the window, negative when regen exceeded consumption
+ *          distance_dm - distance of the window
+ *
+ * @return  none
+ */
+void tripLog_addWindow( uint32_t ADCounter, int32_t energy_mWh, uint32_t distance_dm )
+{
+    if (report.riding == 0)
+    {
+        return;
+    }
+    if (startPending == 1)
+    {
+        startPending = 0;
+        trip.startADCounter = ADCounter;
+    }
+    trip.energy_mWh += energy_mWh;
+    trip.distance_dm += distance_dm;
+}
+/*********************************************************************
+ * @fn      tripLog_powerOff
+ *
+ * @brief   End the trip being ridden at the next tripLog_taskFxn, so its summary is part of the
+ *          power off commit.  May be called from any context.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void tripLog_powerOff( void )
+{
+    closePending = 1;
+}
+/*********************************************************************
+ * @fn      tripLog_taskFxn
+ *
+ * @brief   End the trip at power off and send a pending report.  Called from task context,
+ *          before writeBehind_taskFxn.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void tripLog_taskFxn( void )
+{
+    if (closePending == 1)
+    {
+        closePending = 0;
+        if (report.riding == 1)
+        {
+            tripLog_end(TRIP_LOG_END_POWER_OFF);
+        }
+    }
+    if (publishPending == 1)
+    {
+        publishPending = 0;
+        tripLog_publish();
+    }
+}
+/*********************************************************************
+ * @fn      tripLog_publish
+ *
+ * @brief   Update the Controller trip log characteristic
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void tripLog_publish( void )
+{
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_TRIP_LOG, CONTROLLER_TRIP_LOG_LEN, (uint8_t *) &report);
+}
+/*********************************************************************
+ * @fn      tripLog_start
+ *
+ * @brief   Open a trip.  The moving samples that started it are part of it.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void tripLog_start( void )
+{
+    memset(&trip, 0, sizeof(trip));
+    trip.trip = nextTrip;
+    trip.minBatteryVoltage_mV = UINT16_MAX;
+    trip.maxHeatSinkTemperature_C = INT8_MIN;
+    trip.maxMotorTemperature_C = INT8_MIN;
+    samples = moveCount;
+    moveCount = 0;
+    idleCount = 0;
+    startPending = 1;
+    report.riding = 1;
+    publishPending = 1;
+}
+/*********************************************************************
+ * @fn      tripLog_end
+ *
+ * @brief   Close the trip: the duration stops at the last moving sample.  A trip long enough is
+ *          added to the report, and the report is queued for the shared record log.
+ *
+ * @param   endReason - TRIP_LOG_END_xxx
+ *
+ * @return  none
+ */
+static void tripLog_end( uint8_t endReason )
+{
+    uint32_t duration_s = ((samples - idleCount) * PERIODIC_COMMUNICATION_HF_SAMPLING_TIME) / 1000;
+    uint64_t economy;
+
+    report.riding = 0;
+    publishPending = 1;
+    if (trip.distance_dm < TRIP_LOG_MIN_DISTANCE_DM)
+    {
+        return;
+    }
+    trip.duration_s = (duration_s > UINT16_MAX) ? UINT16_MAX : (uint16_t) duration_s;
+    if (trip.energy_mWh <= 0)
+    {
+        trip.economy_100Whpk = 0;
+    }
+    else
+    {
+        economy = ((uint64_t) trip.energy_mWh * 1000) / trip.distance_dm;      // same unit as computeInstantEconomy
+        trip.economy_100Whpk = (economy > UINT16_MAX) ? UINT16_MAX : (uint16_t) economy;
+    }
+    trip.endReason = endReason;
+    nextTrip++;
+    tripLog_push(&trip);
+    writeBehind_markDirty(&tripEntry);
+}
+/*********************************************************************
+ * @fn      tripLog_push
+ *
+ * @brief   Put a summary at the front of the report, the oldest drops out
+ *
+ * @param   summary - trip summary
+ *
+ * @return  none
+ */
+static void tripLog_push( const tripLog_summary_t *summary )
+{
+    memmove(&report.summary[1], &report.summary[0], (TRIP_LOG_REPORT_TRIPS - 1) * sizeof(tripLog_summary_t));
+    report.summary[0] = *summary;
+    if (report.count < TRIP_LOG_REPORT_TRIPS)
+    {
+        report.count++;
+    }
+}
@@ -0,0 +1,106 @@
+/**********************************************************************************************
+ * tripLog.h
+ *
+ * Description:    Trip segmentation and per-trip summaries.
+ *
+ *                 A trip starts when the motor turns at TRIP_LOG_START_RPM or more, or the throttle
+ *                 is engaged, for TRIP_LOG_START_SAMPLES samples in a row.  It ends when the motor is
+ *                 below TRIP_LOG_STOP_RPM with the throttle released for TRIP_LOG_STOP_SAMPLES samples
+ *                 in a row, or at power off.  The start threshold is above the stop threshold, and
+ *                 a stop needs a much longer idle than a start needs movement, so a trip is not cut
+ *                 at traffic lights nor started by pushing the scooter a few steps.
+ *
+ *                 The summary is built while riding: peaks per sample, energy and distance per
+ *                 analytics window (the same Simpson's integration as the usage totals).  At the end
+ *                 of a trip it is put at the front of the report, and the report (the latest
+ *                 TRIP_LOG_REPORT_TRIPS summaries) is saved to the shared record log (write behind);
+ *                 a trip shorter than TRIP_LOG_MIN_DISTANCE_DM is dropped.  The App reads the report
+ *                 in one (long) read of the Controller trip log characteristic; the trip number
+ *                 tells it which summaries it has not seen yet.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_TRIPLOG_H_
+#define APPLICATION_TRIPLOG_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define TRIP_LOG_START_RPM              50              // about 2 km/hr
+#define TRIP_LOG_STOP_RPM               20              // about 0.8 km/hr
+#define TRIP_LOG_START_SAMPLES          3               // 0.9 s of movement or throttle starts a trip
+#define TRIP_LOG_STOP_SAMPLES           400             // 2 minutes stopped with the throttle released ends it
+#define TRIP_LOG_MIN_DISTANCE_DM        100             // shorter trips are not logged
+#define TRIP_LOG_REPORT_TRIPS           8               // latest summaries in the report
+
+#define TRIP_LOG_END_IDLE               0x00            // stopped for TRIP_LOG_STOP_SAMPLES
+#define TRIP_LOG_END_POWER_OFF          0x01
+
+// Trip log report (Controller trip log characteristic, little endian) - tripLog_report_t as laid out in RAM
+//      [0] summaries in the report (1)  [1] summary size (1)  [2] 1 while a trip is open (1)  [3] reserved (1)
+//      [4] summaries, newest first (28): trip number (4), analytics window the trip started in (4),
+//          distance dm (4), net energy mW-hr (4, signed), duration s (2), economy W-hr/km x 100 (2),
+//          highest speed cm/s (2), lowest battery voltage mV (2), highest motor and heat sink
+//          temperature (1 + 1, signed), end reason TRIP_LOG_END_xxx (1), reserved (1)
+#define TRIP_LOG_REPORT_HEADER          4
+#define TRIP_LOG_REPORT_LEN             (TRIP_LOG_REPORT_HEADER + 28 * TRIP_LOG_REPORT_TRIPS)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+// Trip summary
+typedef struct
+{
+    uint32_t trip;                                          // trip number, from 1
+    uint32_t startADCounter;                                // analytics window the trip started in (there is no real time clock)
+    uint32_t distance_dm;
+    int32_t  energy_mWh;                                    // net of regen
+    uint16_t duration_s;                                    // first to last moving sample, saturated
+    uint16_t economy_100Whpk;                               // W-hr/km x 100 (saturated), 0 if regen exceeded consumption
+    uint16_t maxSpeed_cmph;
+    uint16_t minBatteryVoltage_mV;
+    int8_t   maxMotorTemperature_C;
+    int8_t   maxHeatSinkTemperature_C;
+    uint8_t  endReason;                                     // TRIP_LOG_END_xxx
+    uint8_t  reserved;
+}tripLog_summary_t;
+
+// Report, also the record saved to the shared record log
+typedef struct
+{
+    uint8_t  count;                                         // summaries filled
+    uint8_t  summarySize;                                   // sizeof(tripLog_summary_t)
+    uint8_t  riding;                                        // 1 while a trip is open
+    uint8_t  reserved;
+    tripLog_summary_t summary[TRIP_LOG_REPORT_TRIPS];       // newest first
+}tripLog_report_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void tripLog_init( void );
+extern void tripLog_sample( uint16_t rpm, uint8_t throttleEngaged, uint16_t speed_cmph, uint16_t batteryVoltage_mV,
+                            int8_t heatSinkTemperature_C, int8_t motorTemperature_C );
+extern void tripLog_addWindow( uint32_t ADCounter, int32_t energy_mWh, uint32_t distance_dm );
+extern void tripLog_powerOff( void );
+extern void tripLog_taskFxn( void );
+extern void tripLog_publish( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_TRIPLOG_H_ */
@@ -0,0 +1,218 @@
+/******************************************************************************
+
+ @file  usageHistory.c
+
+ @brief This file contains the delta / zig-zag varint encoding of the usage
+        history entries kept in the shared record log.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include "usageHistory.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define USAGE_HISTORY_KEYFRAME          1               // header of a keyframe; delta headers are even
+
+/**********************************************************************
+ *  Local functions
+ */
+static uint32_t usageHistory_zigzag(uint32_t value);
+static uint32_t usageHistory_unzigzag(uint32_t value);
+static uint8_t usageHistory_putVarint(uint8_t *ptr, uint32_t value);
+static uint8_t usageHistory_getVarint(const uint8_t *record, uint16_t length, uint16_t *pos, uint32_t *value);
+
+/*********************************************************************
+ * @fn      usageHistory_reset
+ *
+ * @brief   Forget the previous entry: the next entry encoded is a keyframe, and a decoder waits for
+ *          the next keyframe
+ *
+ * @param   codec - encoder or decoder state
+ *
+ * @return  none
+ */
+void usageHistory_reset( usageHistory_codec_t *codec )
+{
+    codec->valid = 0;
+    codec->sinceKeyframe = 0;
+    codec->ADStep = 0;
+}
+/*********************************************************************
+ * @fn      usageHistory_encode
+ *
+ * @brief   Encode an entry as a delta from the previous one, or as a keyframe when there is no
+ *          previous entry, a keyframe is due, UDCounter did not step by one or the ADCounter step
+ *          changed by 2^30 or more
+ *
+ * @param   codec - encoder state
+ *          entry - entry to encode
+ *          record - destination, USAGE_HISTORY_ENTRY_MAX bytes
+ *
+ * @return  record length
+ */
+uint8_t usageHistory_encode( usageHistory_codec_t *codec, const usageHistory_entry_t *entry, uint8_t *record )
+{
+    uint32_t step = entry->ADCounter - codec->last.ADCounter;
+    uint32_t header = usageHistory_zigzag(step - codec->ADStep);
+    uint8_t  n = 0;
+
+    if ((codec->valid == 0) || (codec->sinceKeyframe >= USAGE_HISTORY_KEYFRAME_INTERVAL - 1) ||
+        (entry->UDCounter != codec->last.UDCounter + 1) || ((header & 0x80000000) != 0))
+    {
+        n += usageHistory_putVarint(record + n, USAGE_HISTORY_KEYFRAME);
+        n += usageHistory_putVarint(record + n, entry->UDCounter);
+        n += usageHistory_putVarint(record + n, entry->ADCounter);
+        n += usageHistory_putVarint(record + n, entry->mileage_dm);
+        n += usageHistory_putVarint(record + n, entry->energy_mWh);
+        codec->sinceKeyframe = 0;
+        codec->ADStep = 0;
+    }
+    else
+    {
+        n += usageHistory_putVarint(record + n, header << 1);
+        n += usageHistory_putVarint(record + n, usageHistory_zigzag(entry->mileage_dm - codec->last.mileage_dm));
+        n += usageHistory_putVarint(record + n, usageHistory_zigzag(entry->energy_mWh - codec->last.energy_mWh));
+        codec->sinceKeyframe++;
+        codec->ADStep = step;
+    }
+    codec->last = *entry;
+    codec->valid = 1;
+    return n;
+}
+/*********************************************************************
+ * @fn      usageHistory_decode
+ *
+ * @brief   Decode the next entry of the log.  A delta is applied to the entry decoded before it; the
+ *          caller resets the decoder where entries are missing.  Anything that does not decode
+ *          exactly makes the decoder wait for the next keyframe.
+ *
+ * @param   codec - decoder state, reset before the first record
+ *          record - record data
+ *          length - record length
+ *          entry - destination, valid if 1 is returned
+ *
+ * @return  1 if an entry was decoded, 0 if the record was skipped
+ */
+uint8_t usageHistory_decode( usageHistory_codec_t *codec, const uint8_t *record, uint16_t length, usageHistory_entry_t *entry )
+{
+    uint16_t pos = 0;
+    uint32_t header;
+    uint32_t deltaMileage;
+    uint32_t deltaEnergy;
+    uint8_t  ok = 0;
+
+    if (usageHistory_getVarint(record, length, &pos, &header) == 0)
+    {
+        // not an entry
+    }
+    else if (header == USAGE_HISTORY_KEYFRAME)
+    {
+        ok = usageHistory_getVarint(record, length, &pos, &entry->UDCounter) &&
+             usageHistory_getVarint(record, length, &pos, &entry->ADCounter) &&
+             usageHistory_getVarint(record, length, &pos, &entry->mileage_dm) &&
+             usageHistory_getVarint(record, length, &pos, &entry->energy_mWh) && (pos == length);
+        codec->ADStep = 0;
+    }
+    else if (((header & 1) == 0) && (codec->valid == 1))
+    {
+        ok = usageHistory_getVarint(record, length, &pos, &deltaMileage) &&
+             usageHistory_getVarint(record, length, &pos, &deltaEnergy) && (pos == length);
+        if (ok)
+        {
+            codec->ADStep += usageHistory_unzigzag(header >> 1);
+            entry->UDCounter = codec->last.UDCounter + 1;
+            entry->ADCounter = codec->last.ADCounter + codec->ADStep;
+            entry->mileage_dm = codec->last.mileage_dm + usageHistory_unzigzag(deltaMileage);
+            entry->energy_mWh = codec->last.energy_mWh + usageHistory_unzigzag(deltaEnergy);
+        }
+    }
+
+    if (ok == 0)
+    {
+        codec->valid = 0;
+        return 0;
+    }
+    codec->last = *entry;
+    codec->valid = 1;
+    return 1;
+}
+/*********************************************************************
+ * @fn      usageHistory_zigzag
+ *
+ * @brief   Map a two's complement difference to an unsigned value, small magnitudes first:
+ *          0, -1, 1, -2 ... -> 0, 1, 2, 3 ...
+ *
+ * @param   value - difference modulo 2^32
+ *
+ * @return  zig-zag value
+ */
+static uint32_t usageHistory_zigzag(uint32_t value)
+{
+    return (value << 1) ^ (0 - (value >> 31));
+}
+/*********************************************************************
+ * @fn      usageHistory_unzigzag
+ *
+ * @brief   Inverse of usageHistory_zigzag
+ *
+ * @param   value - zig-zag value
+ *
+ * @return  difference modulo 2^32
+ */
+static uint32_t usageHistory_unzigzag(uint32_t value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+/*********************************************************************
+ * @fn      usageHistory_putVarint
+ *
+ * @brief   Write a value 7 bits per byte, least significant first, bit 7 set on all but the last
+ *
+ * @param   ptr - destination, USAGE_HISTORY_VARINT_MAX bytes
+ *          value - value
+ *
+ * @return  bytes written
+ */
+static uint8_t usageHistory_putVarint(uint8_t *ptr, uint32_t value)
+{
+    uint8_t n = 0;
+    while (value >= 0x80)
+    {
+        ptr[n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    ptr[n++] = (uint8_t) value;
+    return n;
+}
+/*********************************************************************
+ * @fn      usageHistory_getVarint
+ *
+ * @brief   Read a varint.  Fails on the end of the record or a value over 32 bits.
+ *
+ * @param   record - record data
+ *          length - record length
+ *          pos - read position, advanced past the varint
+ *          value - destination
+ *
+ * @return  1 if a value was read, else 0
+ */
+static uint8_t usageHistory_getVarint(const uint8_t *record, uint16_t length, uint16_t *pos, uint32_t *value)
+{
+    uint32_t result = 0;
+    uint8_t  shift = 0;
+    uint8_t  byte;
+    do
+    {
+        if ((*pos >= length) || ((shift == 28) && (record[*pos] > 0x0F)))
+        {
+            return 0;
+        }
+        byte = record[(*pos)++];
+        result |= (uint32_t) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *value = result;
+    return 1;
+}
@@ -0,0 +1,81 @@
+/**********************************************************************************************
+ * usageHistory.h
+ *
+ * Description:    Compact encoding of the usage history saved every UDTRIGGER windows.
+ *
+ *                 Each save is one usage entry of the shared record log: total mileage, total
+ *                 energy and the data counters.  Most entries are deltas from the entry before them, as zig-zag
+ *                 varints (small changes take one to three bytes); every
+ *                 USAGE_HISTORY_KEYFRAME_INTERVAL entries, and whenever a delta cannot be used, a
+ *                 keyframe carries the absolute values.  A decoder that starts anywhere in the log,
+ *                 or meets a corrupted entry, resumes at the next keyframe; the caller resets it
+ *                 where records are missing (a gap in the log sequence numbers).
+ *
+ *                 Encoder and decoder keep only the previous entry (O(1) RAM); the log is decoded
+ *                 streaming, one record at a time.
+ *
+ *                 Entry format (varints are little endian base 128, at most 5 bytes):
+ *                   keyframe: varint 1, varint UDCounter, varint ADCounter, varint mileage_dm,
+ *                             varint energy_mWh
+ *                   delta:    varint (zigzag(ADCounter step - previous ADCounter step) << 1),
+ *                             zigzag varint mileage_dm delta, zigzag varint energy_mWh delta;
+ *                             UDCounter is the previous UDCounter + 1
+ *                 Deltas are taken modulo 2^32, so energy net of regen may go down.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_USAGEHISTORY_H_
+#define APPLICATION_USAGEHISTORY_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define USAGE_HISTORY_KEYFRAME_INTERVAL 16              // entries from one keyframe to the next, at most
+#define USAGE_HISTORY_VARINT_MAX        5               // bytes of a 32 bit varint
+#define USAGE_HISTORY_ENTRY_MAX         (1 + 4 * USAGE_HISTORY_VARINT_MAX)      // keyframe, the longest entry
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+    uint32_t UDCounter;                                     // usage data save counter
+    uint32_t ADCounter;                                     // analytics windows
+    uint32_t mileage_dm;                                    // total mileage
+    uint32_t energy_mWh;                                    // total energy, net of regen
+}usageHistory_entry_t;
+
+// Encoder or decoder state: the previous entry
+typedef struct
+{
+    usageHistory_entry_t last;
+    uint32_t ADStep;                                        // ADCounter step of the last entry
+    uint8_t  valid;                                         // 0 until a keyframe has been encoded / decoded
+    uint8_t  sinceKeyframe;                                 // deltas since the last keyframe (encoder)
+}usageHistory_codec_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void usageHistory_reset( usageHistory_codec_t *codec );
+extern uint8_t usageHistory_encode( usageHistory_codec_t *codec, const usageHistory_entry_t *entry, uint8_t *record );
+extern uint8_t usageHistory_decode( usageHistory_codec_t *codec, const uint8_t *record, uint16_t length, usageHistory_entry_t *entry );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_USAGEHISTORY_H_ */
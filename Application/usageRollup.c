@@ -0,0 +1,246 @@
+/******************************************************************************
+
+ @file  usageRollup.c
+
+ @brief This file contains the multi-resolution usage history.  It is updated
+        once per analytics window from dataAnalyt; the record is written behind
+        and the report is sent to the App from the analytics task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include "usageRollup.h"
+#include "writeBehind.h"
+#include "periodicCommunication.h"
+#include "motorControl.h"
+#include "Controller.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define USAGE_ROLLUP_SAMPLES(minutes)   ((uint32_t) (minutes) * 60000 / PERIODIC_COMMUNICATION_HF_SAMPLING_TIME)
+
+// The report is sent as it is laid out in RAM: no padding, and the Controller characteristic holds all of it
+typedef char usageRollup_reportLenCheck[(sizeof(usageRollup_report_t) == USAGE_ROLLUP_REPORT_LEN) ? 1 : -1];
+typedef char usageRollup_charLenCheck[(CONTROLLER_USAGE_ROLLUP_LEN == USAGE_ROLLUP_REPORT_LEN) ? 1 : -1];
+
+typedef struct
+{
+    uint16_t span_min;                                      // bucket span in minutes, 0 for one analytics window
+    uint32_t samples;                                       // samples that close a bucket
+    uint8_t  buckets;                                       // ring size
+    uint8_t  first;                                         // index of the ring in the report buckets
+    uint8_t  scale;                                         // energy shift (low nibble), distance shift (high nibble)
+}usageRollup_tierConfig_t;
+
+// Scales keep an hour at 1 kW and 35 km/hr, and a day of it, within 16 bits
+static const usageRollup_tierConfig_t tierConfig[USAGE_ROLLUP_TIERS] =
+{
+    {0,    1,                          USAGE_ROLLUP_WINDOW_BUCKETS, 0,                                                         0x00},
+    {1,    USAGE_ROLLUP_SAMPLES(1),    USAGE_ROLLUP_MINUTE_BUCKETS, USAGE_ROLLUP_WINDOW_BUCKETS,                               0x00},
+    {60,   USAGE_ROLLUP_SAMPLES(60),   USAGE_ROLLUP_HOUR_BUCKETS,   USAGE_ROLLUP_WINDOW_BUCKETS + USAGE_ROLLUP_MINUTE_BUCKETS, 0x35},
+    {1440, USAGE_ROLLUP_SAMPLES(1440), USAGE_ROLLUP_DAY_BUCKETS,    USAGE_ROLLUP_BUCKETS - USAGE_ROLLUP_DAY_BUCKETS,           0x8A}
+};
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static usageRollup_record_t record;
+static writeBehind_entry_t rollupEntry = {WRITE_BEHIND_TAG_ROLLUP, &record, sizeof(record), sizeof(record), NULL, 0};
+static uint8_t publishPending = 0;                                  // report waiting to be sent from task context
+
+/**********************************************************************
+ *  Local functions
+ */
+static void usageRollup_reset( void );
+static uint8_t usageRollup_valid( void );
+static void usageRollup_close(uint8_t tier);
+
+/*********************************************************************
+ * @fn      usageRollup_init
+ *
+ * @brief   Load the newest rollup record, or start empty if there is none or it was saved with
+ *          other tiers.  Registers the record with the write behind cache.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void usageRollup_init( void )
+{
+    if ((nvsLog_readLatest(writeBehind_getLog(), WRITE_BEHIND_TAG_ROLLUP, &record, sizeof(record)) != sizeof(record)) ||
+        (usageRollup_valid() == 0))
+    {
+        usageRollup_reset();
+    }
+    writeBehind_register(&rollupEntry);
+    publishPending = 1;
+}
+/*********************************************************************
+ * @fn      usageRollup_add
+ *
+ * @brief   Add an analytics window to the open bucket of every tier, and close the buckets that
+ *          have covered their span
+ *
+ * @param   energy_mWh - net energy of the window, negative when regen exceeded consumption
+ *          distance_dm - distance of the window
+ *          samples - length of the window in samples
+ *          minBatteryVoltage_mV - lowest battery voltage of the window
+ *          maxMotorTemperature_C - highest motor temperature of the window
+ *
+ * @return  none
+ */
+void usageRollup_add( int32_t energy_mWh, uint32_t distance_dm, uint16_t samples,
+                      uint16_t minBatteryVoltage_mV, int8_t maxMotorTemperature_C )
+{
+    uint8_t tier;
+    usageRollup_open_t *open;
+    for (tier = 0; tier < USAGE_ROLLUP_TIERS; tier++)
+    {
+        open = &record.open[tier];
+        if ((open->samples == 0) || (minBatteryVoltage_mV < open->minBatteryVoltage_mV))
+        {
+            open->minBatteryVoltage_mV = minBatteryVoltage_mV;
+        }
+        if ((open->samples == 0) || (maxMotorTemperature_C > open->maxMotorTemperature_C))
+        {
+            open->maxMotorTemperature_C = maxMotorTemperature_C;
+        }
+        open->energy_mWh += energy_mWh;
+        open->distance_dm += distance_dm;
+        open->samples += samples;
+        if (open->samples >= tierConfig[tier].samples)
+        {
+            usageRollup_close(tier);
+        }
+    }
+    publishPending = 1;
+}
+/*********************************************************************
+ * @fn      usageRollup_save
+ *
+ * @brief   Queue the record for the shared record log.  Called with every usage data save and at
+ *          power off; may be called from any context.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void usageRollup_save( void )
+{
+    writeBehind_markDirty(&rollupEntry);
+}
+/*********************************************************************
+ * @fn      usageRollup_taskFxn
+ *
+ * @brief   Send a pending report.  Called from task context.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void usageRollup_taskFxn( void )
+{
+    if (publishPending == 1)
+    {
+        publishPending = 0;
+        usageRollup_publish();
+    }
+}
+/*********************************************************************
+ * @fn      usageRollup_publish
+ *
+ * @brief   Update the Controller usage rollup characteristic
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void usageRollup_publish( void )
+{
+    motorcontrol_setGatt(CONTROLLER_SERV_UUID, CONTROLLER_USAGE_ROLLUP, CONTROLLER_USAGE_ROLLUP_LEN, (uint8_t *) &record.report);
+}
+/*********************************************************************
+ * @fn      usageRollup_reset
+ *
+ * @brief   Empty rings and open buckets
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void usageRollup_reset( void )
+{
+    uint8_t tier;
+    memset(&record, 0, sizeof(record));
+    record.report.tiers = USAGE_ROLLUP_TIERS;
+    record.report.bucketSize = sizeof(usageRollup_bucket_t);
+    for (tier = 0; tier < USAGE_ROLLUP_TIERS; tier++)
+    {
+        record.report.tier[tier].span_min = tierConfig[tier].span_min;
+        record.report.tier[tier].scale = tierConfig[tier].scale;
+    }
+}
+/*********************************************************************
+ * @fn      usageRollup_valid
+ *
+ * @brief   Check that a loaded record has the tiers of this build
+ *
+ * @param   none
+ *
+ * @return  1 if the record can be used, else 0
+ */
+static uint8_t usageRollup_valid( void )
+{
+    uint8_t tier;
+    if ((record.report.tiers != USAGE_ROLLUP_TIERS) || (record.report.bucketSize != sizeof(usageRollup_bucket_t)))
+    {
+        return 0;
+    }
+    for (tier = 0; tier < USAGE_ROLLUP_TIERS; tier++)
+    {
+        if ((record.report.tier[tier].span_min != tierConfig[tier].span_min) ||
+            (record.report.tier[tier].scale != tierConfig[tier].scale) ||
+            (record.report.tier[tier].count > tierConfig[tier].buckets))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+/*********************************************************************
+ * @fn      usageRollup_close
+ *
+ * @brief   Pack the open bucket of a tier to the tier's scale, push it at the front of the tier's
+ *          ring and open a new bucket
+ *
+ * @param   tier - USAGE_ROLLUP_TIER_xxx
+ *
+ * @return  none
+ */
+static void usageRollup_close(uint8_t tier)
+{
+    const usageRollup_tierConfig_t *config = &tierConfig[tier];
+    usageRollup_bucket_t *ring = &record.report.bucket[config->first];
+    usageRollup_open_t *open = &record.open[tier];
+    uint8_t  energyShift = config->scale & 0x0F;
+    uint8_t  distanceShift = config->scale >> 4;
+    int32_t  energy;
+    uint32_t distance = open->distance_dm >> distanceShift;
+    uint32_t voltage = (open->minBatteryVoltage_mV > USAGE_ROLLUP_VOLTAGE_BASE_MV) ?
+                       (open->minBatteryVoltage_mV - USAGE_ROLLUP_VOLTAGE_BASE_MV) / USAGE_ROLLUP_VOLTAGE_STEP_MV : 0;
+
+    // Truncate towards zero, so regen and consumption scale alike
+    energy = (open->energy_mWh >= 0) ? (open->energy_mWh >> energyShift) : -((-open->energy_mWh) >> energyShift);
+
+    memmove(&ring[1], &ring[0], (config->buckets - 1) * sizeof(usageRollup_bucket_t));
+    ring[0].energy = (energy > INT16_MAX) ? INT16_MAX : ((energy < INT16_MIN) ? INT16_MIN : (int16_t) energy);
+    ring[0].distance = (distance > UINT16_MAX) ? UINT16_MAX : (uint16_t) distance;
+    ring[0].minBatteryVoltage = (voltage > UINT8_MAX) ? UINT8_MAX : (uint8_t) voltage;
+    ring[0].maxMotorTemperature_C = open->maxMotorTemperature_C;
+    if (record.report.tier[tier].count < config->buckets)
+    {
+        record.report.tier[tier].count++;
+    }
+    memset(open, 0, sizeof(*open));
+}
@@ -0,0 +1,124 @@
+/**********************************************************************************************
+ * usageRollup.h
+ *
+ * Description:    Multi-resolution usage history: analytics windows, minutes, hours and days.
+ *
+ *                 Every analytics window is added to the open bucket of each tier.  When a tier's
+ *                 bucket has covered its span it is closed into that tier's ring (newest first,
+ *                 the oldest bucket drops out) and a new one is opened, so the fine tiers hold the
+ *                 recent past and the coarse tiers reach back weeks in constant RAM and flash.
+ *                 Buckets keep the sums of net energy and distance, the lowest battery voltage and
+ *                 the highest motor temperature.
+ *
+ *                 Time is powered-on time, counted in samples - there is no real time clock.  A
+ *                 bucket is closed by the window that completes its span, so it may run over by up
+ *                 to one window (a minute bucket holds 13 windows of 4.8 s).
+ *
+ *                 The rings and open buckets are appended to the shared record log (write behind)
+ *                 at every usage data save and at power off.  The App reads all the rings in one (long) read
+ *                 of the Controller usage rollup characteristic.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_USAGEROLLUP_H_
+#define APPLICATION_USAGEROLLUP_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define USAGE_ROLLUP_TIERS              4
+#define USAGE_ROLLUP_TIER_WINDOW        0
+#define USAGE_ROLLUP_TIER_MINUTE        1
+#define USAGE_ROLLUP_TIER_HOUR          2
+#define USAGE_ROLLUP_TIER_DAY           3
+#define USAGE_ROLLUP_WINDOW_BUCKETS     3               // latest analytics windows
+#define USAGE_ROLLUP_MINUTE_BUCKETS     10
+#define USAGE_ROLLUP_HOUR_BUCKETS       12
+#define USAGE_ROLLUP_DAY_BUCKETS        14
+#define USAGE_ROLLUP_BUCKETS            (USAGE_ROLLUP_WINDOW_BUCKETS + USAGE_ROLLUP_MINUTE_BUCKETS + \
+                                         USAGE_ROLLUP_HOUR_BUCKETS + USAGE_ROLLUP_DAY_BUCKETS)
+#define USAGE_ROLLUP_VOLTAGE_BASE_MV    25000           // bucket battery voltage = base + value x step
+#define USAGE_ROLLUP_VOLTAGE_STEP_MV    100
+
+// Rollup report (Controller usage rollup characteristic, little endian) - usageRollup_report_t as laid out in RAM
+//      [0] tiers (1)  [1] bucket size (1)
+//      [2] per tier (4): span in minutes (2), 0 for one analytics window; buckets filled (1);
+//          scale (1): energy unit = 2^(low nibble) mW-hr, distance unit = 2^(high nibble) dm
+//      [18] buckets, tier by tier, newest first (6): net energy (2, signed), distance (2),
+//          lowest battery voltage (1, see USAGE_ROLLUP_VOLTAGE_BASE_MV), highest motor temperature (1, signed)
+#define USAGE_ROLLUP_REPORT_HEADER      (2 + 4 * USAGE_ROLLUP_TIERS)
+#define USAGE_ROLLUP_REPORT_LEN         (USAGE_ROLLUP_REPORT_HEADER + 6 * USAGE_ROLLUP_BUCKETS)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+// Closed bucket, packed to the tier's scale and saturated
+typedef struct
+{
+    int16_t  energy;                                        // net energy, regen included
+    uint16_t distance;
+    uint8_t  minBatteryVoltage;
+    int8_t   maxMotorTemperature_C;
+}usageRollup_bucket_t;
+
+typedef struct
+{
+    uint16_t span_min;                                      // bucket span in minutes, 0 for one analytics window
+    uint8_t  count;                                         // buckets filled
+    uint8_t  scale;                                         // energy shift (low nibble), distance shift (high nibble)
+}usageRollup_tier_t;
+
+typedef struct
+{
+    uint8_t  tiers;                                         // USAGE_ROLLUP_TIERS
+    uint8_t  bucketSize;                                    // sizeof(usageRollup_bucket_t)
+    usageRollup_tier_t   tier[USAGE_ROLLUP_TIERS];
+    usageRollup_bucket_t bucket[USAGE_ROLLUP_BUCKETS];      // rings, tier by tier, newest first
+}usageRollup_report_t;
+
+// Bucket being filled, full precision
+typedef struct
+{
+    int32_t  energy_mWh;
+    uint32_t distance_dm;
+    uint32_t samples;                                       // powered-on time of the bucket
+    uint16_t minBatteryVoltage_mV;
+    int8_t   maxMotorTemperature_C;
+    uint8_t  reserved;
+}usageRollup_open_t;
+
+// Record saved to the shared record log
+typedef struct
+{
+    usageRollup_report_t report;
+    usageRollup_open_t   open[USAGE_ROLLUP_TIERS];
+}usageRollup_record_t;
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void usageRollup_init( void );
+extern void usageRollup_add( int32_t energy_mWh, uint32_t distance_dm, uint16_t samples,
+                             uint16_t minBatteryVoltage_mV, int8_t maxMotorTemperature_C );
+extern void usageRollup_save( void );
+extern void usageRollup_taskFxn( void );
+extern void usageRollup_publish( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_USAGEROLLUP_H_ */
@@ -0,0 +1,205 @@
+/******************************************************************************
+
+ @file  writeBehind.c
+
+ @brief This file contains the write behind cache of the NVS logs and the
+        record log shared by its entries.
+        Entries may be marked dirty from any context; flash operations are made
+        from the analytics task.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include "writeBehind.h"
+#include "nvsJob.h"
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static nvsLog_nvsManager_t *writeBehind_nvsManager = NULL;
+static nvsLog_t recordLog;
+static writeBehind_entry_t *entries[WRITE_BEHIND_ENTRIES];
+static uint8_t entryCount = 0;
+static uint16_t carrySize = 0;                                      // flash taken by the longest record of every entry
+static volatile uint8_t commitPending = 0;                          // power off requested - write everything now
+
+/*********************************************************************
+ * @fn      writeBehind_registerNVS
+ *
+ * @brief   Register the NVS functions of the shared record log area.
+ *          Must be registered before writeBehind_init.
+ *
+ * @param   nvsManager - NVS manager
+ *
+ * @return  none
+ */
+void writeBehind_registerNVS( nvsLog_nvsManager_t *nvsManager )
+{
+    writeBehind_nvsManager = nvsManager;
+}
+/*********************************************************************
+ * @fn      writeBehind_init
+ *
+ * @brief   Mount the shared record log.  Called once NVS is open, before the owners read their
+ *          records back.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void writeBehind_init( void )
+{
+    nvsLog_init(&recordLog, writeBehind_nvsManager, WRITE_BEHIND_SECTORS);
+}
+/*********************************************************************
+ * @fn      writeBehind_getLog
+ *
+ * @brief   The shared record log, for the owners to read their records (nvsLog_readLatest,
+ *          nvsLog_readFirst / nvsLog_readNext with the record tag)
+ *
+ * @param   none
+ *
+ * @return  log instance
+ */
+nvsLog_t *writeBehind_getLog( void )
+{
+    return &recordLog;
+}
+/*********************************************************************
+ * @fn      writeBehind_register
+ *
+ * @brief   Add an entry.  Called at initialisation, before the analytics task runs.  Entries are
+ *          written in the order they are registered.  The longest records of all entries must fit
+ *          in WRITE_BEHIND_CARRY_MAX, so that they can all be written again in a new sector with
+ *          room left for new records.
+ *
+ * @param   entry - entry, kept by the caller
+ *
+ * @return  1 if registered, 0 if the table or the record log is full
+ */
+uint8_t writeBehind_register( writeBehind_entry_t *entry )
+{
+    uint16_t size = NVS_LOG_RECORD_SIZE(entry->maxLength);
+    if ((entryCount >= WRITE_BEHIND_ENTRIES) || (carrySize + size > WRITE_BEHIND_CARRY_MAX))
+    {
+        return 0;
+    }
+    carrySize += size;
+    entry->dirty = 0;
+    entries[entryCount++] = entry;
+    return 1;
+}
+/*********************************************************************
+ * @fn      writeBehind_markDirty
+ *
+ * @brief   Queue the record of an entry for writing.  Marking an entry that is already dirty costs
+ *          nothing: only the newest value is written.
+ *
+ * @param   entry - entry
+ *
+ * @return  none
+ */
+void writeBehind_markDirty( writeBehind_entry_t *entry )
+{
+    entry->dirty = 1;
+}
+/*********************************************************************
+ * @fn      writeBehind_requestCommit
+ *
+ * @brief   Ask for every dirty record to be written at the next writeBehind_taskFxn.  May be called
+ *          from any context (power off from the single button callback).
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void writeBehind_requestCommit( void )
+{
+    commitPending = 1;
+}
+/*********************************************************************
+ * @fn      writeBehind_taskFxn
+ *
+ * @brief   Queue again the entries whose newest record is in the sector erased next (no flash
+ *          operation), then do at most one flash operation: the commit if one was requested, else
+ *          an erase ahead if the current sector would have no room left for the longest record of
+ *          every entry after the next append (paced by nvsJob_claimStep; nothing is appended until
+ *          it is done), else the append of the first dirty record.  Task context only.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void writeBehind_taskFxn( void )
+{
+    uint8_t ii;
+    uint16_t room;
+    for (ii = 0; ii < entryCount; ii++)
+    {
+        // A dirty entry is written anyway, unless its owner has more to keep than the record in RAM
+        if (((entries[ii]->dirty == 0) || (entries[ii]->carry != NULL)) &&
+            (nvsLog_isExpiring(&recordLog, entries[ii]->tag) == 1))
+        {
+            if (entries[ii]->carry != NULL)
+            {
+                entries[ii]->carry(entries[ii]);
+            }
+            else
+            {
+                entries[ii]->dirty = 1;
+            }
+        }
+    }
+    if (commitPending == 1)
+    {
+        commitPending = 0;
+        writeBehind_commit();
+        return;
+    }
+    ii = 0;
+    while ((ii < entryCount) && (entries[ii]->dirty == 0))    // first dirty record
+    {
+        ii++;
+    }
+    // Room for one record of every entry left after the append, so a commit never erases
+    room = carrySize + ((ii < entryCount) ? NVS_LOG_RECORD_SIZE(entries[ii]->length) : 0);
+    if (nvsLog_hasRoom(&recordLog, room) == 0)
+    {
+        if (nvsJob_claimStep() == 1)                        // between radio events while connected
+        {
+            nvsJob_blockStart();
+            nvsLog_reserve(&recordLog, room);
+            nvsJob_blockEnd();
+        }
+        return;
+    }
+    if (ii < entryCount)
+    {
+        entries[ii]->dirty = 0;
+        nvsLog_append(&recordLog, entries[ii]->tag, entries[ii]->data, entries[ii]->length);
+    }
+}
+/*********************************************************************
+ * @fn      writeBehind_commit
+ *
+ * @brief   Write every dirty record now, in registration order.  With the room reserved by
+ *          writeBehind_taskFxn this only programs.  Task context only.
+ *
+ * @param   none
+ *
+ * @return  number of records written
+ */
+uint8_t writeBehind_commit( void )
+{
+    uint8_t ii;
+    uint8_t written = 0;
+    for (ii = 0; ii < entryCount; ii++)
+    {
+        if (entries[ii]->dirty == 1)
+        {
+            entries[ii]->dirty = 0;
+            written += nvsLog_append(&recordLog, entries[ii]->tag, entries[ii]->data, entries[ii]->length);
+        }
+    }
+    return written;
+}
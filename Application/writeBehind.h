@@ -0,0 +1,90 @@
+/**********************************************************************************************
+ * writeBehind.h
+ *
+ * Description:    Write behind cache in front of the NVS logs.
+ *
+ *                 Each entry is a record kept in RAM by its owner, saved with its own tag to the
+ *                 record log shared by every owner (WRITE_BEHIND_SECTORS sectors at the start of
+ *                 the NVS region).  Owners mark an entry dirty after changing it; the flash write
+ *                 is done later by writeBehind_taskFxn, one flash operation per call: erasing
+ *                 ahead when the log would have no room left for one record of every entry
+ *                 after the next append, else appending one dirty record.  Entries are served in registration order, so a
+ *                 record that others refer to is registered first and reaches flash first.
+ *
+ *                 An entry whose newest record is in the sector erased next is written again
+ *                 from RAM (or by its carry callback) before that sector is erased, so a small
+ *                 log keeps the newest record of every owner however rarely it changes.
+ *
+ *                 Because the erase is done ahead, the commit at power off only programs the dirty
+ *                 records - at most one small program per entry, no erase.
+ *
+ **********************************************************************************************/
+
+#ifndef APPLICATION_WRITEBEHIND_H_
+#define APPLICATION_WRITEBEHIND_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include "nvsLog.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define WRITE_BEHIND_ENTRIES            7               // usage data, usage checkpoint, analytics snapshot, settings, usage rollups, trip report, efficiency map
+#define WRITE_BEHIND_SECTORS            2               // flash sectors of the shared record log
+#define WRITE_BEHIND_CARRY_MAX          ((NVS_LOG_SECTOR_SIZE - sizeof(nvsLog_sectorHeader_t)) / 2)  // flash the longest records of all entries may take
+
+// Record tags in the shared log - never renumber
+#define WRITE_BEHIND_TAG_USAGE          0               // dataAnalysis usage history entry, or UDBuffer image
+#define WRITE_BEHIND_TAG_CHECKPOINT     1               // dataAnalysis usage checkpoint
+#define WRITE_BEHIND_TAG_SETTINGS       2               // configStore values
+#define WRITE_BEHIND_TAG_ROLLUP         3               // usageRollup rings and open buckets
+#define WRITE_BEHIND_TAG_SNAPSHOT       4               // dataAnalysis analytics snapshot
+#define WRITE_BEHIND_TAG_TRIP           5               // tripLog report
+#define WRITE_BEHIND_TAG_EFFICIENCY_MAP 6               // efficiencyMap cells
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct writeBehind_entry writeBehind_entry_t;
+
+// Called instead of marking the entry dirty when its newest record is about to be erased
+typedef void (*writeBehind_carryCB_t)(writeBehind_entry_t *entry);
+
+struct writeBehind_entry
+{
+    uint8_t     tag;                                    // WRITE_BEHIND_TAG_xxx
+    const void  *data;                                  // record in RAM - the value at write time is saved
+    uint16_t    length;                                 // record length
+    uint16_t    maxLength;                              // longest record of the entry - room is kept for it by the erase ahead
+    writeBehind_carryCB_t carry;                        // NULL to write the record in RAM again
+    uint8_t     dirty;                                  // set by the owner, cleared when the record is written
+};
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void writeBehind_registerNVS( nvsLog_nvsManager_t *nvsManager );
+extern void writeBehind_init( void );
+extern nvsLog_t *writeBehind_getLog( void );
+extern uint8_t writeBehind_register( writeBehind_entry_t *entry );
+extern void writeBehind_markDirty( writeBehind_entry_t *entry );
+extern void writeBehind_requestCommit( void );
+extern void writeBehind_taskFxn( void );
+extern uint8_t writeBehind_commit( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPLICATION_WRITEBEHIND_H_ */
@@ -1231,7 +1231,7 @@ void Flashing (I2C_Handle handle,uint8_t status_buf, uint8_t brightness_buf, uin
 }
 // Function tables
 
-IS31FL3236A_Function functionTable[FUNCTION_COUNT] = {
+const IS31FL3236A_Function functionTable[FUNCTION_COUNT] = {
     Brightness,
     IS31FL3236A_Sports_Mode,
     IS31FL3236A_Leisure_Mode,
@@ -307,7 +307,7 @@ typedef enum {
     FUNCTION_COUNT
 } IS31FL3236A_FunctionIndex;
 
-extern IS31FL3236A_Function functionTable[FUNCTION_COUNT];
+extern const IS31FL3236A_Function functionTable[FUNCTION_COUNT];
 
 
 #ifdef _cplusplus
@@ -113,14 +113,14 @@ static BatteryCBs_t *pAppCBs = NULL;
 static CONST gattAttrType_t BatteryDecl = { ATT_BT_UUID_SIZE, BatteryUUID };
 
 // Characteristic "Battery_Level" Properties (for declaration)
-static uint8 Battery_Battery_LevelProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Battery_Battery_LevelProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Battery_Level" Value variable
 static uint8 Battery_Battery_LevelVal[BATTERY_BATTERY_LEVEL_LEN] = {100};  //{0};
 // Characteristic "Battery_Level" CCCD
 static gattCharCfg_t *Battery_Battery_LevelConfig;
 
 // Characteristic "BATTERY_VOLTAGE" Properties (for declaration)
-static uint8 Battery_Battery_VoltageProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Battery_Battery_VoltageProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "BATTERY_VOLTAGE" Value variable
 static uint8 Battery_Battery_VoltageVal[BATTERY_BATTERY_VOLTAGE_LEN] = {255};  // voltage is in mV
 // Characteristic "BATTERY_VOLTAGE" CCCD
@@ -128,7 +128,7 @@ static gattCharCfg_t *Battery_Battery_VoltageConfig;
 
 // **** The current battery version does not feedback temperature information - For Future Use Only   *****
 // Characteristic "BATTERY_TEMPERATURE" Properties (for declaration)
-static uint8 Battery_Battery_TemperatureProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Battery_Battery_TemperatureProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "BATTERY_TEMPERATURE" Value variable
 static uint8 Battery_Battery_TemperatureVal[BATTERY_BATTERY_TEMPERATURE_LEN] = {15};
 // Characteristic "BATTERY_TEMPERATURE" CCCD
@@ -136,14 +136,14 @@ static gattCharCfg_t *Battery_Battery_TemperatureConfig;
 
 // **** The current battery version does not support error code information - For Future Use Only   *****
 // Characteristic "BATTERY_ERROR_CODE" Properties (for declaration)
-static uint8 Battery_Battery_Error_CodeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Battery_Battery_Error_CodeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "BATTERY_ERROR_CODE" Value variable
 static uint8 Battery_Battery_Error_CodeVal[BATTERY_BATTERY_ERROR_CODE_LEN] = {0};
 // Characteristic "BATTERY_ERROR_CODE" CCCD
 static gattCharCfg_t *Battery_Battery_Error_CodeConfig;
 
 // Characteristic "BATTERY_STATUS" Properties (for declaration)
-static uint8 Battery_Battery_StatusProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Battery_Battery_StatusProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "BATTERY_STATUS" Value variable
 static uint8 Battery_Battery_StatusVal[BATTERY_BATTERY_STATUS_LEN] = {5};   // = GLOWING_AQUA in dataAnalysis.h
 // Characteristic "BATTERY_STATUS" CCCD
@@ -167,7 +167,7 @@ static gattAttribute_t BatteryAttrTbl[] =
     { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Battery_Battery_LevelProps
+      (uint8 *)&Battery_Battery_LevelProps
   },
       // Battery_Level Characteristic Value
       {
@@ -196,7 +196,7 @@ static gattAttribute_t BatteryAttrTbl[] =
     { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Battery_Battery_VoltageProps
+      (uint8 *)&Battery_Battery_VoltageProps
   },
       // BATTERY_VOLTAGE Characteristic Value
       {
@@ -225,7 +225,7 @@ static gattAttribute_t BatteryAttrTbl[] =
     { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Battery_Battery_TemperatureProps
+      (uint8 *)&Battery_Battery_TemperatureProps
   },
           // BATTERY_TEMPERATURE Characteristic Value
       {
@@ -254,7 +254,7 @@ static gattAttribute_t BatteryAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Battery_Battery_StatusProps
+      (uint8 *)&Battery_Battery_StatusProps
   },
            // BATTERY_STATUS Characteristic Value
           {
@@ -282,7 +282,7 @@ static gattAttribute_t BatteryAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
         GATT_PERMIT_READ,
         0,
-        &Battery_Battery_Error_CodeProps
+        (uint8 *)&Battery_Battery_Error_CodeProps
     },
             // BATTERY_ERROR_CODE Characteristic Value
         {
@@ -153,6 +153,36 @@ static CONST uint8 Controller_Instant_EconomyUUID[ATT_UUID_SIZE] =
   TI_BASE_UUID_128(CONTROLLER_INSTANT_ECONOMY_UUID)
 };
 
+// Controller_Brake_Latency UUID
+static CONST uint8 Controller_Brake_LatencyUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(CONTROLLER_BRAKE_LATENCY_UUID)
+};
+
+// Controller_Efficiency_Map UUID
+static CONST uint8 Controller_Efficiency_MapUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(CONTROLLER_EFFICIENCY_MAP_UUID)
+};
+
+// Controller_Usage_Rollup UUID
+static CONST uint8 Controller_Usage_RollupUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(CONTROLLER_USAGE_ROLLUP_UUID)
+};
+
+// Controller_Trip_Log UUID
+static CONST uint8 Controller_Trip_LogUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(CONTROLLER_TRIP_LOG_UUID)
+};
+
+// Controller_Black_Box UUID
+static CONST uint8 Controller_Black_BoxUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(CONTROLLER_BLACK_BOX_UUID)
+};
+
 /*********************************************************************
  * LOCAL VARIABLES
  */
@@ -168,96 +198,119 @@ static CONST gattAttrType_t ControllerDecl = { ATT_UUID_SIZE, ControllerUUID };
 
 
 // Characteristic "Controller_Voltage" Properties (for declaration)
-static uint8_t Controller_VoltageProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_VoltageProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Voltage" Value variable -> need to break it up into bits of 8 bits for communication
 static uint8_t Controller_VoltageVal[CONTROLLER_VOLTAGE_LEN] = {0};
 // Characteristic "Controller_Voltage" CCCD
 static gattCharCfg_t *Controller_VoltageConfig;
 
 // Characteristic "Controller_Current" Properties (for declaration)
-static uint8_t Controller_CurrentProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_CurrentProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Current" Value variable
 static uint8_t Controller_CurrentVal[CONTROLLER_CURRENT_LEN] = {0};
 // Characteristic "Controller_Current" CCCD
 static gattCharCfg_t *Controller_CurrentConfig;
 
 // Characteristic "Controller_Heat_Sink_Temperature" Properties (for declaration)
-static uint8_t Controller_Heat_Sink_TemperatureProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Heat_Sink_TemperatureProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Heat_Sink_Temperature" Value variable
 static uint8_t Controller_Heat_Sink_TemperatureVal[CONTROLLER_HEAT_SINK_TEMPERATURE_LEN] = {15};        // Should change type to int8_t because temperature can be negative
 // Characteristic "Controller_Heat_Sink_Temperature" CCCD
 static gattCharCfg_t *Controller_Heat_Sink_TemperatureConfig;
 
 // Characteristic "Controller_Error_Code" Properties (for declaration)
-static uint8_t Controller_Error_CodeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Error_CodeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Error_Code" Value variable
 static uint8_t Controller_Error_CodeVal[CONTROLLER_ERROR_CODE_LEN] = {0};
 // Characteristic "Controller_Error_Code" CCCD
 static gattCharCfg_t *Controller_Error_CodeConfig;
 
 // Characteristic "Controller_Motor_RPM" Properties (for declaration)
-static uint8_t Controller_Motor_RPM_Props = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Motor_RPM_Props = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Motor_RPM" Value variable
 static uint8_t Controller_Motor_RPM_Val[CONTROLLER_MOTOR_RPM_LEN] = {0};
 // Characteristic "Controller_Motor_RPM" CCCD
 static gattCharCfg_t *Controller_Motor_RPM_Config;
 
 // Characteristic "Controller_Motor_Speed" Properties (for declaration)
-static uint8_t Controller_Motor_SpeedProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Motor_SpeedProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Motor_Speed" Value variable
 static uint8_t Controller_Motor_SpeedVal[CONTROLLER_MOTOR_SPEED_LEN] = {0}; // round(Controller_Motor_RPM_Val * 2 * (float) M_PI / 60 * WHEELRADIUS);
 // Characteristic "Controller_Motor_Speed" CCCD
 static gattCharCfg_t *Controller_Motor_SpeedConfig;
 
 // Characteristic "Controller_Total_Distance_Travelled" Properties (for declaration)
-static uint8_t Controller_Total_Distance_TravelledProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Total_Distance_TravelledProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Total_Distance_Travelled" Value variable
 static uint8_t Controller_Total_Distance_TravelledVal[CONTROLLER_TOTAL_DISTANCE_TRAVELLED_LEN] = {0};
 // Characteristic "Controller_Total_Distance_Travelled" CCCD
 static gattCharCfg_t *Controller_Total_Distance_TravelledConfig;
 
 // Characteristic "Controller_Total_Energy_Consumption" Properties (for declaration)
-static uint8_t Controller_Total_Energy_ConsumptionProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Total_Energy_ConsumptionProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Total_Energy_Consumption" Value variable
 static uint8_t Controller_Total_Energy_ConsumptionVal[CONTROLLER_TOTAL_ENERGY_CONSUMPTION_LEN] = {0};
 // Characteristic "Controller_Total_Energy_Consumption" CCCD
 static gattCharCfg_t *Controller_Total_Energy_ConsumptionConfig;
 
 // Characteristic "Controller_Total_Energy_Efficiency" Properties (for declaration)
-static uint8_t Controller_Total_Energy_EfficiencyProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Total_Energy_EfficiencyProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Total_Energy_Efficiency" Value variable
 static uint8_t Controller_Total_Energy_EfficiencyVal[CONTROLLER_TOTAL_ENERGY_EFFICIENCY_LEN] = {0};
 // Characteristic "Controller_Total_Energy_Efficiency" CCCD
 static gattCharCfg_t *Controller_Total_Energy_EfficiencyConfig;
 
 // Characteristic "Controller_Range" Properties (for declaration)
-static uint8 Controller_RangeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Controller_RangeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Range" Value variable
 static uint8 Controller_RangeVal[CONTROLLER_RANGE_LEN] = {0};
 // Characteristic "Controller_Range" CCCD
 static gattCharCfg_t *Controller_RangeConfig;
 
 // Characteristic "Controller_co2Saved" Properties (for declaration)
-static uint8 Controller_co2SavedProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Controller_co2SavedProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_co2Saved" Value variable
 static uint8 Controller_co2SavedVal[CONTROLLER_CO2SAVED_LEN] = {0};
 // Characteristic "Controller_co2Saved" CCCD
 static gattCharCfg_t *Controller_co2SavedConfig;
 
 // Characteristic "Controller_Motor_Temperature" Properties (for declaration)
-static uint8_t Controller_Motor_TemperatureProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8_t Controller_Motor_TemperatureProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Motor_Temperature" Value variable
 static uint8_t Controller_Motor_TemperatureVal[CONTROLLER_MOTOR_TEMPERATURE_LEN] = {0};
 // Characteristic "Controller_Motor_Temperature" CCCD
 static gattCharCfg_t *Controller_Motor_TemperatureConfig;
 
 // Characteristic "Controller_Instant_Economy" Properties (for declaration)
-static uint8 Controller_Instant_EconomyProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Controller_Instant_EconomyProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Controller_Instant_Economy" Value variable
 static uint8 Controller_Instant_EconomyVal[CONTROLLER_INSTANT_ECONOMY_LEN] = {0};
 // Characteristic "Controller_Instant_Economy" CCCD
 static gattCharCfg_t *Controller_Instant_EconomyConfig;
 
+// Characteristic "Controller_Brake_Latency" Properties (for declaration)
+static CONST uint8 Controller_Brake_LatencyProps = GATT_PROP_READ;
+// Characteristic "Controller_Brake_Latency" Value variable
+static uint8 Controller_Brake_LatencyVal[CONTROLLER_BRAKE_LATENCY_LEN] = {0};
+
+// Characteristic "Controller_Efficiency_Map" Properties (for declaration)
+static CONST uint8 Controller_Efficiency_MapProps = GATT_PROP_READ;
+// Characteristic "Controller_Efficiency_Map" Value variable
+static uint8 Controller_Efficiency_MapVal[CONTROLLER_EFFICIENCY_MAP_LEN] = {0};
+
+// Characteristic "Controller_Usage_Rollup" Properties (for declaration)
+static CONST uint8 Controller_Usage_RollupProps = GATT_PROP_READ;
+// Characteristic "Controller_Usage_Rollup" Value variable
+static uint8 Controller_Usage_RollupVal[CONTROLLER_USAGE_ROLLUP_LEN] = {0};
+
+// Characteristic "Controller_Trip_Log" Properties (for declaration)
+static CONST uint8 Controller_Trip_LogProps = GATT_PROP_READ;
+// Characteristic "Controller_Trip_Log" Value variable
+static uint8 Controller_Trip_LogVal[CONTROLLER_TRIP_LOG_LEN] = {0};
+
+// Characteristic "Controller_Black_Box" Properties (for declaration)
+static CONST uint8 Controller_Black_BoxProps = GATT_PROP_READ;
+
 /*********************************************************************
 *
 *
@@ -278,7 +331,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_VoltageProps
+      (uint8 *)&Controller_VoltageProps
     },
         // Controller_Voltage Characteristic Value
         {
@@ -306,7 +359,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_CurrentProps
+      (uint8 *)&Controller_CurrentProps
     },
         // Controller_Current Characteristic Value
         {
@@ -334,7 +387,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Heat_Sink_TemperatureProps
+      (uint8 *)&Controller_Heat_Sink_TemperatureProps
     },
       // Controller_Heat_Sink_Temperature Characteristic Value
       {
@@ -362,7 +415,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Error_CodeProps
+      (uint8 *)&Controller_Error_CodeProps
     },
       // Controller_Error_Code_Temperature Characteristic Value
       {
@@ -390,7 +443,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Motor_RPM_Props
+      (uint8 *)&Controller_Motor_RPM_Props
     },
       // Controller_Motor_RPM Characteristic Value
       {
@@ -418,7 +471,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Motor_SpeedProps
+      (uint8 *)&Controller_Motor_SpeedProps
     },
       // Controller_Motor_Speed Characteristic Value
       {
@@ -446,7 +499,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Total_Distance_TravelledProps
+      (uint8 *)&Controller_Total_Distance_TravelledProps
     },
       // Controller_Total_Distance_Travelled Characteristic Value
       {
@@ -474,7 +527,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Total_Energy_ConsumptionProps
+      (uint8 *)&Controller_Total_Energy_ConsumptionProps
     },
       // Controller_Total_Energy_Consumption Characteristic Value
       {
@@ -502,7 +555,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Total_Energy_EfficiencyProps
+      (uint8 *)&Controller_Total_Energy_EfficiencyProps
     },
       // Controller_Total_Energy_Efficiency Characteristic Value
       {
@@ -531,7 +584,7 @@ static gattAttribute_t ControllerAttrTbl[] =
           { ATT_BT_UUID_SIZE, characterUUID },
           GATT_PERMIT_READ,
           0,
-          &Controller_RangeProps
+          (uint8 *)&Controller_RangeProps
       },
           // Controller_Range Characteristic Value
           {
@@ -560,7 +613,7 @@ static gattAttribute_t ControllerAttrTbl[] =
         { ATT_BT_UUID_SIZE, characterUUID },
         GATT_PERMIT_READ,
         0,
-        &Controller_co2SavedProps
+        (uint8 *)&Controller_co2SavedProps
     },
         // Controller_co2Saved Characteristic Value
         {
@@ -588,7 +641,7 @@ static gattAttribute_t ControllerAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Controller_Motor_TemperatureProps
+      (uint8 *)&Controller_Motor_TemperatureProps
     },
       // Controller_Motor_Temperature Characteristic Value
       {
@@ -616,7 +669,7 @@ static gattAttribute_t ControllerAttrTbl[] =
     { ATT_BT_UUID_SIZE, characterUUID },
     GATT_PERMIT_READ,
     0,
-    &Controller_Instant_EconomyProps
+    (uint8 *)&Controller_Instant_EconomyProps
   },
     // Controller_Instant_Economy Characteristic Value
     {
@@ -638,6 +691,111 @@ static gattAttribute_t ControllerAttrTbl[] =
       GATT_PERMIT_READ,
       0,
       "Instantaneous Economy (100Whpk)"   // unit in W-hr / km x 100
+    },
+  // Controller_Brake_Latency Characteristic Declaration
+  {
+    { ATT_BT_UUID_SIZE, characterUUID },
+    GATT_PERMIT_READ,
+    0,
+    (uint8 *)&Controller_Brake_LatencyProps
+  },
+    // Controller_Brake_Latency Characteristic Value
+    {
+      { ATT_UUID_SIZE, Controller_Brake_LatencyUUID },
+      GATT_PERMIT_READ,
+      0,
+      Controller_Brake_LatencyVal
+    },
+    // Controller_Brake_Latency user descriptor
+    {
+      {ATT_BT_UUID_SIZE, charUserDescUUID},
+      GATT_PERMIT_READ,
+      0,
+      "Brake Latency Report (us)"
+    },
+  // Controller_Efficiency_Map Characteristic Declaration
+  {
+    { ATT_BT_UUID_SIZE, characterUUID },
+    GATT_PERMIT_READ,
+    0,
+    (uint8 *)&Controller_Efficiency_MapProps
+  },
+    // Controller_Efficiency_Map Characteristic Value
+    {
+      { ATT_UUID_SIZE, Controller_Efficiency_MapUUID },
+      GATT_PERMIT_READ,
+      0,
+      Controller_Efficiency_MapVal
+    },
+    // Controller_Efficiency_Map user descriptor
+    {
+      {ATT_BT_UUID_SIZE, charUserDescUUID},
+      GATT_PERMIT_READ,
+      0,
+      "Efficiency Map (speed bin x mode)"
+    },
+  // Controller_Usage_Rollup Characteristic Declaration
+  {
+    { ATT_BT_UUID_SIZE, characterUUID },
+    GATT_PERMIT_READ,
+    0,
+    (uint8 *)&Controller_Usage_RollupProps
+  },
+    // Controller_Usage_Rollup Characteristic Value
+    {
+      { ATT_UUID_SIZE, Controller_Usage_RollupUUID },
+      GATT_PERMIT_READ,
+      0,
+      Controller_Usage_RollupVal
+    },
+    // Controller_Usage_Rollup user descriptor
+    {
+      {ATT_BT_UUID_SIZE, charUserDescUUID},
+      GATT_PERMIT_READ,
+      0,
+      "Usage Rollups (window/min/hour/day)"
+    },
+  // Controller_Trip_Log Characteristic Declaration
+  {
+    { ATT_BT_UUID_SIZE, characterUUID },
+    GATT_PERMIT_READ,
+    0,
+    (uint8 *)&Controller_Trip_LogProps
+  },
+    // Controller_Trip_Log Characteristic Value
+    {
+      { ATT_UUID_SIZE, Controller_Trip_LogUUID },
+      GATT_PERMIT_READ,
+      0,
+      Controller_Trip_LogVal
+    },
+    // Controller_Trip_Log user descriptor
+    {
+      {ATT_BT_UUID_SIZE, charUserDescUUID},
+      GATT_PERMIT_READ,
+      0,
+      "Trip Log (latest trip summaries)"
+    },
+  // Controller_Black_Box Characteristic Declaration
+  {
+    { ATT_BT_UUID_SIZE, characterUUID },
+    GATT_PERMIT_READ,
+    0,
+    (uint8 *)&Controller_Black_BoxProps
+  },
+    // Controller_Black_Box Characteristic Value - not kept here, filled by pfnReadCb when it is read
+    {
+      { ATT_UUID_SIZE, Controller_Black_BoxUUID },
+      GATT_PERMIT_READ,
+      0,
+      NULL
+    },
+    // Controller_Black_Box user descriptor
+    {
+      {ATT_BT_UUID_SIZE, charUserDescUUID},
+      GATT_PERMIT_READ,
+      0,
+      "Black Box (latest telemetry and faults)"
     }
 };
 
@@ -1043,6 +1201,54 @@ bStatus_t Controller_SetParameter( uint8 param, uint8 len, void *value )
             }
             break;
     }
+    case CONTROLLER_BRAKE_LATENCY:
+    {
+        if ( len == CONTROLLER_BRAKE_LATENCY_LEN )
+            {
+            memcpy(Controller_Brake_LatencyVal, value, len);   // read only - bulk read by the App, no notification
+            }
+            else
+            {
+            ret = bleInvalidRange;
+            }
+            break;
+    }
+    case CONTROLLER_EFFICIENCY_MAP:
+    {
+        if ( len == CONTROLLER_EFFICIENCY_MAP_LEN )
+            {
+            memcpy(Controller_Efficiency_MapVal, value, len);  // read only - bulk read by the App, no notification
+            }
+            else
+            {
+            ret = bleInvalidRange;
+            }
+            break;
+    }
+    case CONTROLLER_USAGE_ROLLUP:
+    {
+        if ( len == CONTROLLER_USAGE_ROLLUP_LEN )
+            {
+            memcpy(Controller_Usage_RollupVal, value, len);  // read only - bulk read by the App, no notification
+            }
+            else
+            {
+            ret = bleInvalidRange;
+            }
+            break;
+    }
+    case CONTROLLER_TRIP_LOG:
+    {
+        if ( len == CONTROLLER_TRIP_LOG_LEN )
+            {
+            memcpy(Controller_Trip_LogVal, value, len);  // read only - bulk read by the App, no notification
+            }
+            else
+            {
+            ret = bleInvalidRange;
+            }
+            break;
+    }
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -1103,6 +1309,28 @@ bStatus_t Controller_GetParameter( uint8 param, void *value )
     case CONTROLLER_INSTANT_ECONOMY:
         memcpy((uint8_t*)value, Controller_Instant_EconomyVal, CONTROLLER_INSTANT_ECONOMY_LEN);
         break;
+    case CONTROLLER_BRAKE_LATENCY:
+        memcpy((uint8_t*)value, Controller_Brake_LatencyVal, CONTROLLER_BRAKE_LATENCY_LEN);
+        break;
+    case CONTROLLER_EFFICIENCY_MAP:
+        memcpy((uint8_t*)value, Controller_Efficiency_MapVal, CONTROLLER_EFFICIENCY_MAP_LEN);
+        break;
+    case CONTROLLER_USAGE_ROLLUP:
+        memcpy((uint8_t*)value, Controller_Usage_RollupVal, CONTROLLER_USAGE_ROLLUP_LEN);
+        break;
+    case CONTROLLER_TRIP_LOG:
+        memcpy((uint8_t*)value, Controller_Trip_LogVal, CONTROLLER_TRIP_LOG_LEN);
+        break;
+    case CONTROLLER_BLACK_BOX:
+        if ( pAppCBs && pAppCBs->pfnReadCb )
+        {
+          pAppCBs->pfnReadCb( CONTROLLER_BLACK_BOX, 0, (uint8_t*)value, CONTROLLER_BLACK_BOX_LEN );
+        }
+        else
+        {
+          memset((uint8_t*)value, 0, CONTROLLER_BLACK_BOX_LEN);
+        }
+        break;
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -1301,6 +1529,78 @@ static bStatus_t Controller_ReadAttrCB( uint16 connHandle, gattAttribute_t *pAtt
       memcpy(pValue, pAttr->pValue + offset, *pLen);
     }
   }
+  // See if request is regarding the Brake Latency Characteristic Value
+  else if (! memcmp(pAttr->type.uuid, Controller_Brake_LatencyUUID, pAttr->type.len) )
+  {
+    if ( offset > CONTROLLER_BRAKE_LATENCY_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, CONTROLLER_BRAKE_LATENCY_LEN - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
+  // See if request is regarding the Efficiency Map Characteristic Value
+  else if (! memcmp(pAttr->type.uuid, Controller_Efficiency_MapUUID, pAttr->type.len) )
+  {
+    if ( offset > CONTROLLER_EFFICIENCY_MAP_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, CONTROLLER_EFFICIENCY_MAP_LEN - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
+  // See if request is regarding the Usage Rollup Characteristic Value
+  else if (! memcmp(pAttr->type.uuid, Controller_Usage_RollupUUID, pAttr->type.len) )
+  {
+    if ( offset > CONTROLLER_USAGE_ROLLUP_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, CONTROLLER_USAGE_ROLLUP_LEN - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
+  // See if request is regarding the Trip Log Characteristic Value
+  else if (! memcmp(pAttr->type.uuid, Controller_Trip_LogUUID, pAttr->type.len) )
+  {
+    if ( offset > CONTROLLER_TRIP_LOG_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, CONTROLLER_TRIP_LOG_LEN - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
+  // See if request is regarding the Black Box Characteristic Value
+  else if (! memcmp(pAttr->type.uuid, Controller_Black_BoxUUID, pAttr->type.len) )
+  {
+    if ( offset > CONTROLLER_BLACK_BOX_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, CONTROLLER_BLACK_BOX_LEN - offset);  // Transmit as much as possible
+      if ( pAppCBs && pAppCBs->pfnReadCb )
+      {
+        pAppCBs->pfnReadCb( CONTROLLER_BLACK_BOX, offset, pValue, *pLen );  // read from flash, not kept in RAM
+      }
+      else
+      {
+        memset(pValue, 0, *pLen);
+      }
+    }
+  }
   else
   {
     // If we get here, that means you've forgotten to add an if clause for a
@@ -106,7 +106,7 @@ extern "C"
 //  Characteristic definition
 #define CONTROLLER_RANGE                            9
 #define CONTROLLER_RANGE_UUID                       0x7807
-#define CONTROLLER_RANGE_LEN                        4
+#define CONTROLLER_RANGE_LEN                        12        // = RANGE_PREDICTOR_REPORT_LEN: range, lower and upper bound (m), see rangePredictor.h
 
 //  Characteristic definition
 #define CONTROLLER_CO2SAVED                         10
@@ -123,6 +123,31 @@ extern "C"
 #define CONTROLLER_MOTOR_TEMPERATURE_UUID           0x2A1C
 #define CONTROLLER_MOTOR_TEMPERATURE_LEN            1
 
+//  Characteristic definition
+#define CONTROLLER_BRAKE_LATENCY                    13
+#define CONTROLLER_BRAKE_LATENCY_UUID               0x780A
+#define CONTROLLER_BRAKE_LATENCY_LEN                42        // = BRAKE_LATENCY_REPORT_LEN, see brakeLatency.h
+
+//  Characteristic definition
+#define CONTROLLER_EFFICIENCY_MAP                   14
+#define CONTROLLER_EFFICIENCY_MAP_UUID              0x780B
+#define CONTROLLER_EFFICIENCY_MAP_LEN               198       // = EFFICIENCY_MAP_REPORT_LEN, see efficiencyMap.h
+
+//  Characteristic definition
+#define CONTROLLER_USAGE_ROLLUP                     15
+#define CONTROLLER_USAGE_ROLLUP_UUID                0x780C
+#define CONTROLLER_USAGE_ROLLUP_LEN                 252       // = USAGE_ROLLUP_REPORT_LEN, see usageRollup.h
+
+//  Characteristic definition
+#define CONTROLLER_TRIP_LOG                         16
+#define CONTROLLER_TRIP_LOG_UUID                    0x780D
+#define CONTROLLER_TRIP_LOG_LEN                     228       // = TRIP_LOG_REPORT_LEN, see tripLog.h
+
+//  Characteristic definition
+#define CONTROLLER_BLACK_BOX                        17
+#define CONTROLLER_BLACK_BOX_UUID                   0x780E
+#define CONTROLLER_BLACK_BOX_LEN                    512       // = BLACK_BOX_REPORT_LEN, see blackBox.h - filled by pfnReadCb as it is read
+
 // Controller Error Codes
 #define CONTROLLER_NORMAL                           20
 #define PHASE_CURRENT_ABNORMAL                      21
@@ -147,10 +172,13 @@ extern "C"
  */
 // Callback when a characteristic value has changed
 typedef void (*ControllerChange_t)( uint8 paramID );
+// Callback filling a characteristic value that is not kept in the profile, when it is read
+typedef void (*ControllerRead_t)( uint8 paramID, uint16 offset, uint8 *pValue, uint16 len );
 
 typedef struct
 {
   ControllerChange_t        pfnChangeCb;  // Called when characteristic value changes
+  ControllerRead_t          pfnReadCb;    // Called when the black box characteristic is read
 } ControllerCBs_t;
 
 /*********************************************************************
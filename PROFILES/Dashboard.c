@@ -107,6 +107,12 @@ CONST uint8 Dashboard_ADCounterUUID[ATT_UUID_SIZE] =
 {
   TI_BASE_UUID_128(DASHBOARD_ADCOUNTER_UUID)
 };
+
+// Dashboard_Calibration UUID
+CONST uint8 Dashboard_CalibrationUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(DASHBOARD_CALIBRATION_UUID)
+};
 /*********************************************************************
  * LOCAL VARIABLES
  */
@@ -122,7 +128,7 @@ static CONST gattAttrType_t DashboardDecl = { ATT_UUID_SIZE, DashboardUUID };
 
 
 // Characteristic "Dashboard_Error_Code" Properties (for declaration) - Client (App) side
-static uint8 Dashboard_Error_CodeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Dashboard_Error_CodeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Dashboard_Error_Code" Value variable
 static uint8 Dashboard_Error_CodeVal[DASHBOARD_ERROR_CODE_LEN] = {0};
 // Characteristic "Dashboard_Error_Code" CCCD
@@ -130,7 +136,7 @@ static gattCharCfg_t *Dashboard_Error_CodeConfig;
 
 
 // Characteristic "Dashboard_Speed_Mode" Properties (for declaration)
-static uint8 Dashboard_Speed_ModeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Dashboard_Speed_ModeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Dashboard_Speed_Mode" Value variable
 static uint8 Dashboard_Speed_ModeVal[DASHBOARD_SPEED_MODE_LEN] = {1};
 // Characteristic "Dashboard_Speed_Mode" CCCD
@@ -138,7 +144,7 @@ static gattCharCfg_t *Dashboard_Speed_ModeConfig;
 
 
 // Characteristic "Dashboard_Light_Status" Properties (for declaration)
-static uint8 Dashboard_Light_StatusProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Dashboard_Light_StatusProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Dashboard_Light_Status" Value variable
 static uint8 Dashboard_Light_StatusVal[DASHBOARD_LIGHT_STATUS_LEN] = {0};
 // Characteristic "Dashboard_Light_Status" CCCD
@@ -146,26 +152,33 @@ static gattCharCfg_t *Dashboard_Light_StatusConfig;
 
 
 // Characteristic "Dashboard_Light_Mode" Properties (for declaration)
-static uint8 Dashboard_Light_ModeProps = GATT_PROP_READ | GATT_PROP_NOTIFY | GATT_PROP_WRITE;
+static CONST uint8 Dashboard_Light_ModeProps = GATT_PROP_READ | GATT_PROP_NOTIFY | GATT_PROP_WRITE;
 // Characteristic "Dashboard_Light_Mode" Value variable
 static uint8 Dashboard_Light_ModeVal[DASHBOARD_LIGHT_MODE_LEN] = {2};
 // Characteristic "Dashboard_Light_Mode" CCCD
 static gattCharCfg_t *Dashboard_Light_ModeConfig;
 
 // Characteristic "Dashboard_Power_On_Time" Properties (for declaration)
-static uint8 Dashboard_Power_On_TimeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Dashboard_Power_On_TimeProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Dashboard_Power_On_Time" Value variable
 static uint8 Dashboard_Power_On_TimeVal[DASHBOARD_POWER_ON_TIME_LEN] = {0};
 // Characteristic "Dashboard_Power_On_Time" CCCD
 static gattCharCfg_t *Dashboard_Power_On_TimeConfig;
 
 // Characteristic "Dashboard_ADCounter" Properties (for declaration)
-static uint8 Dashboard_ADCounterProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+static CONST uint8 Dashboard_ADCounterProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
 // Characteristic "Dashboard_ADCounter" Value variable
 static uint8 Dashboard_ADCounterVal[DASHBOARD_ADCOUNTER_LEN] = {0};
 // Characteristic "Dashboard_ADCounter" CCCD
 static gattCharCfg_t *Dashboard_ADCounterConfig;
 
+// Characteristic "Dashboard_Calibration" Properties (for declaration)
+static CONST uint8 Dashboard_CalibrationProps = GATT_PROP_READ | GATT_PROP_NOTIFY | GATT_PROP_WRITE;
+// Characteristic "Dashboard_Calibration" Value variable
+static uint8 Dashboard_CalibrationVal[DASHBOARD_CALIBRATION_LEN] = {0};
+// Characteristic "Dashboard_Calibration" CCCD
+static gattCharCfg_t *Dashboard_CalibrationConfig;
+
 /*********************************************************************
 *
 *
@@ -188,7 +201,7 @@ static gattAttribute_t DashboardAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Dashboard_Error_CodeProps
+      (uint8 *)&Dashboard_Error_CodeProps
     },
       // Dashboard_Error_Code Characteristic Value
       {
@@ -217,7 +230,7 @@ static gattAttribute_t DashboardAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Dashboard_Speed_ModeProps
+      (uint8 *)&Dashboard_Speed_ModeProps
     },
       // Dashboard_Speed_Mode Characteristic Value
       {
@@ -246,7 +259,7 @@ static gattAttribute_t DashboardAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Dashboard_Light_StatusProps
+      (uint8 *)&Dashboard_Light_StatusProps
     },
       // Dashboard_Light_Status Characteristic Value
       {
@@ -275,7 +288,7 @@ static gattAttribute_t DashboardAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Dashboard_Light_ModeProps
+      (uint8 *)&Dashboard_Light_ModeProps
     },
       // Dashboard_Light_Mode Characteristic Value
       {
@@ -304,7 +317,7 @@ static gattAttribute_t DashboardAttrTbl[] =
       { ATT_BT_UUID_SIZE, characterUUID },
       GATT_PERMIT_READ,
       0,
-      &Dashboard_Power_On_TimeProps
+      (uint8 *)&Dashboard_Power_On_TimeProps
     },
       // Dashboard_Power_On_Time Characteristic Value
       {
@@ -333,7 +346,7 @@ static gattAttribute_t DashboardAttrTbl[] =
         { ATT_BT_UUID_SIZE, characterUUID },
         GATT_PERMIT_READ,
         0,
-        &Dashboard_ADCounterProps
+        (uint8 *)&Dashboard_ADCounterProps
       },
       // Dashboard_ADCounter Characteristic Value
       {
@@ -355,6 +368,35 @@ static gattAttribute_t DashboardAttrTbl[] =
         GATT_PERMIT_READ,
         0,
         "Data ID"
+      },
+    // CALIBRATION
+    // Dashboard_Calibration Characteristic Declaration
+      {
+        { ATT_BT_UUID_SIZE, characterUUID },
+        GATT_PERMIT_READ,
+        0,
+        (uint8 *)&Dashboard_CalibrationProps
+      },
+      // Dashboard_Calibration Characteristic Value
+      {
+        { ATT_UUID_SIZE, Dashboard_CalibrationUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,   // Client writes the calibration command
+        0,
+        Dashboard_CalibrationVal
+      },
+      // Dashboard_Calibration CCCD
+      {
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        (uint8 *)&Dashboard_CalibrationConfig
+      },
+      // Dashboard_Calibration user descriptor
+      {
+        {ATT_BT_UUID_SIZE, charUserDescUUID},
+        GATT_PERMIT_READ,
+        0,
+        "Brake and Throttle Calibration"
       }
 };
 
@@ -446,6 +488,15 @@ bStatus_t Dashboard_AddService( void )
   // Initialize Client Characteristic Configuration attributes
   GATTServApp_InitCharCfg( INVALID_CONNHANDLE, Dashboard_ADCounterConfig );
 
+  // Allocate Client Characteristic Configuration table
+  Dashboard_CalibrationConfig = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) * linkDBNumConns );
+  if ( Dashboard_CalibrationConfig == NULL )
+  {
+    return ( bleMemAllocError );
+  }
+  // Initialize Client Characteristic Configuration attributes
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, Dashboard_CalibrationConfig );
+
   // Register GATT attribute list and CBs with GATT Server App
   status = GATTServApp_RegisterService( DashboardAttrTbl,
                                         GATT_NUM_ATTRS( DashboardAttrTbl ),
@@ -574,6 +625,20 @@ bStatus_t Dashboard_SetParameter( uint8 param, uint8 len, void *value )
               ret = bleInvalidRange;
             }
             break;
+    case DASHBOARD_CALIBRATION:
+            if ( len == DASHBOARD_CALIBRATION_LEN )
+            {
+              memcpy(Dashboard_CalibrationVal, value, len);
+              // Try to send notification.
+              GATTServApp_ProcessCharCfg( Dashboard_CalibrationConfig, (uint8_t *)&Dashboard_CalibrationVal, FALSE,
+                                          DashboardAttrTbl, GATT_NUM_ATTRS( DashboardAttrTbl ),
+                                          INVALID_TASK_ID,  Dashboard_ReadAttrCB);
+            }
+            else
+            {
+              ret = bleInvalidRange;
+            }
+            break;
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -609,6 +674,9 @@ bStatus_t Dashboard_GetParameter( uint8 param, void *value )
   case DASHBOARD_ADCOUNTER:
           memcpy(value, Dashboard_ADCounterVal, DASHBOARD_ADCOUNTER_LEN);
         break;
+  case DASHBOARD_CALIBRATION:
+          memcpy(value, Dashboard_CalibrationVal, DASHBOARD_CALIBRATION_LEN);
+        break;
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -713,6 +781,19 @@ static bStatus_t Dashboard_ReadAttrCB( uint16 connHandle, gattAttribute_t *pAttr
       memcpy(pValue, pAttr->pValue + offset, *pLen);
     }
   }
+  // See if request is regarding the Dashboard_Calibration Characteristic Value
+  else if (! memcmp(pAttr->type.uuid, Dashboard_CalibrationUUID, pAttr->type.len) )
+  {
+    if ( offset > DASHBOARD_CALIBRATION_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, DASHBOARD_CALIBRATION_LEN - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
   else
   {
     // If we get here, that means you've forgotten to add an if clause for a
@@ -769,6 +850,19 @@ static bStatus_t Dashboard_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAtt
           paramID = DASHBOARD_LIGHT_MODE;
       }
   }
+  else if(! memcmp(pAttr->type.uuid, Dashboard_CalibrationUUID, pAttr->type.len))
+  {
+      // The App writes a single command byte; the full value is the calibration report
+      if ( ( offset != 0 ) || ( len != 1 ) )
+      {
+            status = ATT_ERR_INVALID_VALUE_SIZE;
+      }
+      else
+      {
+        memcpy(pAttr->pValue, pValue, len);
+        paramID = DASHBOARD_CALIBRATION;
+      }
+  }
   else
   {
     // If we get here, that means you've forgotten to add an if clause for a
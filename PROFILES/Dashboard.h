@@ -84,6 +84,10 @@ extern "C"
 #define DASHBOARD_ADCOUNTER_UUID                0x6805
 #define DASHBOARD_ADCOUNTER_LEN                 4
 
+#define DASHBOARD_CALIBRATION                   6
+#define DASHBOARD_CALIBRATION_UUID              0x6806
+#define DASHBOARD_CALIBRATION_LEN               10      // written by the App as a 1 byte command
+
 
 // Dashboard Error Codes
 #define DASHBOARD_NORMAL                        40
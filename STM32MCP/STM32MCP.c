@@ -16,7 +16,6 @@
 /*********************************************************************
  * LOCAL VARIABLES
  */
-static STM32MCP_regAttribute_t  *regAttribute;             // pointer to the first motor controller register attribute
 static STM32MCP_CBs_t           *STM32MCP_CBs;
 static STM32MCP_timerManager_t  *STM32MCP_timerManager;
 static STM32MCP_timerManager_t  *STM32MCP_heartbeatManager;
@@ -50,7 +49,8 @@ static uint8_t STM32MCP_regSpeedKP[2]                = {0, 0};
  *  Developers should modify the following data structures if they wish to use more or less registers
  */
 //Note: Please put the frequently accessed attribute the the top
-static STM32MCP_regAttribute_t STM32MCP_registerAttributes[]=
+//The table is const (flash); only the register values above are in RAM
+static const STM32MCP_regAttribute_t STM32MCP_registerAttributes[]=
 {
     {
          STM32MCP_FLUX_REFERENCE_REG_ID,
@@ -119,6 +119,7 @@ static STM32MCP_regAttribute_t STM32MCP_registerAttributes[]=
          STM32MCP_REGISTER_PERMIT_READ | STM32MCP_REGISTER_PERMIT_WRITE,
     },
 };
+#define STM32MCP_REGISTER_TABLE_SIZE    (sizeof(STM32MCP_registerAttributes) / sizeof(STM32MCP_registerAttributes[0]))
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -145,17 +146,6 @@ void STM32MCP_init()
 {
     STM32MCP_initQueue();
 
-    //Initialize motor control registers
-    uint8_t singleMotorServerSize = sizeof(STM32MCP_registerAttributes);
-    regAttribute = (STM32MCP_regAttribute_t *) malloc(STM32MCP_NUMBER_OF_MOTORS * singleMotorServerSize);
-    uint8_t n = 0;
-    while(n != STM32MCP_NUMBER_OF_MOTORS)
-    {
-        memcpy(regAttribute + n*singleMotorServerSize , STM32MCP_registerAttributes, singleMotorServerSize);
-        n++;
-    }
-    //free the original array if not used
-    //free(STM32MCP_registerAttributes);
     //Initialize the receiving buffer and relevant variables
     rxObj = (STM32MCP_rxMsgObj_t *) malloc(sizeof(STM32MCP_rxMsgObj_t));
     rxObj->currIndex = 0;
@@ -273,38 +263,37 @@ void STM32MCP_toggleCommunication()
 /*********************************************************************
  * @fn      STM32MCP_findRegister
  *
- * @brief   It is used to find register in the register file
+ * @brief   It is used to find register in the register file.
+ *          The register table is shared by the motors
  *
  * @param   motorID:        The motor that will be selected
  *          regID:          The register that you want to read
  *
  * @return  return the starting memory address of that register
  */
-STM32MCP_regAttribute_t *STM32MCP_findRegister(uint8_t motorID, uint8_t regID)
+const STM32MCP_regAttribute_t *STM32MCP_findRegister(uint8_t motorID, uint8_t regID)
 {
     if((motorID >> 5) > STM32MCP_NUMBER_OF_MOTORS)
     {
-        return ( (STM32MCP_regAttribute_t *)NULL);
+        return ( (const STM32MCP_regAttribute_t *)NULL);
     }
     else if((motorID >> 5) <= 0)
     {
-        return ( (STM32MCP_regAttribute_t *)NULL);
+        return ( (const STM32MCP_regAttribute_t *)NULL);
     }
     else
     {
         uint8_t n = 0;
-        uint8_t singleMotorServerSize = sizeof(STM32MCP_registerAttributes);
-        STM32MCP_regAttribute_t *startingAddress = regAttribute + ((motorID >> 5) - 1 ) * singleMotorServerSize;
-        while(n != singleMotorServerSize)
+        while(n != STM32MCP_REGISTER_TABLE_SIZE)
         {
-            if((startingAddress + n) ->regID == regID)
+            if(STM32MCP_registerAttributes[n].regID == regID)
             {
-                return (STM32MCP_regAttribute_t *)(startingAddress + n);
+                return &STM32MCP_registerAttributes[n];
             }
             n++;
         }
     }
-    return ( (STM32MCP_regAttribute_t *)NULL);
+    return ( (const STM32MCP_regAttribute_t *)NULL);
 }
 /*********************************************************************
  * @fn      STM32MCP_setRegisterFrame
@@ -727,9 +716,13 @@ void STM32MCP_setDynamicCurrent(int32_t allowableSpeed, int32_t IQValue)
 void STM32MCP_setRegisterAttribute(uint8_t motorID, uint8_t regID, uint8_t payloadLength, uint8_t *payload)
 {
     //Do not do memory allocation, since it points to the server register. If you free it, the whole server will crake down
-    STM32MCP_regAttribute_t *MCP_Register = STM32MCP_findRegister(motorID, regID);
+    const STM32MCP_regAttribute_t *MCP_Register = STM32MCP_findRegister(motorID, regID);
     if(MCP_Register != NULL)
     {
+        if(payloadLength > MCP_Register->payloadLength)
+        {
+            payloadLength = MCP_Register->payloadLength;
+        }
         memcpy(MCP_Register->payload, payload, payloadLength);
     }
 }
@@ -744,15 +737,15 @@ void STM32MCP_setRegisterAttribute(uint8_t motorID, uint8_t regID, uint8_t paylo
  *
  * @return  A register Attribute
  */
-STM32MCP_regAttribute_t *STM32MCP_getRegisterAttribute(uint8_t motorID, uint8_t regID)
+const STM32MCP_regAttribute_t *STM32MCP_getRegisterAttribute(uint8_t motorID, uint8_t regID)
 {
     //Do not do memory allocation, since it points to the server register. If you free it, the whole server will crake down
-    STM32MCP_regAttribute_t *MCP_Register = STM32MCP_findRegister(motorID, regID);
+    const STM32MCP_regAttribute_t *MCP_Register = STM32MCP_findRegister(motorID, regID);
     if(MCP_Register != NULL)
     {
         return MCP_Register;
     }
-    return (STM32MCP_regAttribute_t *)NULL;
+    return (const STM32MCP_regAttribute_t *)NULL;
 }
 /*********************************************************************
  * @fn      STM32MCP_setBoardInfo
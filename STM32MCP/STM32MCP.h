@@ -397,7 +397,7 @@ extern void STM32MCP_startCommunication();
 extern void STM32MCP_closeCommunication();
 extern void STM32MCP_toggleCommunication();
 /*==============================================================*/
-extern STM32MCP_regAttribute_t *STM32MCP_findRegister(uint8_t motorID, uint8_t regID);
+extern const STM32MCP_regAttribute_t *STM32MCP_findRegister(uint8_t motorID, uint8_t regID);
 /*=========================================================API functions=============================================================*/
 extern void STM32MCP_setRegisterFrame(uint8_t motorID, uint8_t regID, uint8_t payloadLength, uint8_t *payload);
 extern void STM32MCP_getRegisterFrame(uint8_t motorID, uint8_t regID);
@@ -414,7 +414,7 @@ extern void STM32MCP_setDynamicCurrent(int32_t allowableSpeed, int32_t IQValue);
 /*====================================================================================================================================*/
 /*=================================================Functions to set the internal registers============================================*/
 extern void STM32MCP_setRegisterAttribute(uint8_t motorID, uint8_t regID, uint8_t payloadLength, uint8_t *payload);
-extern STM32MCP_regAttribute_t *STM32MCP_getRegisterAttribute(uint8_t motorID, uint8_t regID);
+extern const STM32MCP_regAttribute_t *STM32MCP_getRegisterAttribute(uint8_t motorID, uint8_t regID);
 extern void STM32MCP_setBoardInfo(uint8_t *msg, uint8_t size);
 /*====================================================================================================================================*/
 /*===============================================Functions to be added to callback functions==========================================*/
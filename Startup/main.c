@@ -66,6 +66,8 @@
 #include "lightControl.h"
 #include "ledControl.h"
 #include "generalPurposeTimer.h"
+#include "dataAnalysis.h"
+#include "blackBox.h"
 
 /* Header files required to enable instruction fetch cache */
 #include <inc/hw_memmap.h>
@@ -224,6 +226,8 @@ int main()
   SimplePeripheral_createTask();
   /* Priority 4 */
   GPtimer_createTask();
+  /* Priority 1 */
+  dataAnalysis_createTask();
 
   /* enable interrupts and start SYS/BIOS */
   BIOS_start();
@@ -270,6 +274,8 @@ int main()
  */
 void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 {
+  blackBox_event(BLACK_BOX_TYPE_ASSERT, assertCause, assertSubcause);
+
 #if !defined(Display_DISABLE_ALL)
   // Open the display if the app has not already done so
   if ( !dispHandle )
@@ -306,6 +312,7 @@ void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 #if !defined(Display_DISABLE_ALL)
 
 #endif // ! Display_DISABLE_ALL
+      blackBox_panic();
       HAL_ASSERT_SPINLOCK;
       break;
 
@@ -313,6 +320,7 @@ void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 #if !defined(Display_DISABLE_ALL)
 
 #endif // ! Display_DISABLE_ALL
+      blackBox_panic();
       HAL_ASSERT_SPINLOCK;
       break;
 
@@ -320,6 +328,7 @@ void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 #if !defined(Display_DISABLE_ALL)
 
 #endif // ! Display_DISABLE_ALL
+      blackBox_panic();
       HAL_ASSERT_SPINLOCK;
       break;
 
@@ -327,6 +336,7 @@ void AssertHandler(uint8 assertCause, uint8 assertSubcause)
 #if !defined(Display_DISABLE_ALL)
 
 #endif // ! Display_DISABLE_ALL
+      blackBox_panic();
       HAL_ASSERT_SPINLOCK;
   }
 
@@ -351,6 +361,9 @@ void AssertHandler(uint8 assertCause, uint8 assertSubcause)
  */
 void smallErrorHook(Error_Block *eb)
 {
+  uint16_t code = Error_getCode(eb);
+  blackBox_event(BLACK_BOX_TYPE_RTOS_ERROR, (uint8_t) code, (uint8_t) (code >> 8));
+  blackBox_panic();
   for (;;);
 }
 
@@ -44,8 +44,8 @@
 uint8_t udhalcheck = 0;
 void UDHAL_init()
 {
-    //UDHAL_NVSINT_init();          // nvs internal
-    //UDHAL_NVSINT_params_init();   // nvs internal
+    UDHAL_NVSINT_init();            // nvs internal - shared record log (usage, checkpoint, snapshot, settings, rollups, trips, efficiency map), black box
+    UDHAL_NVSINT_params_init();     // nvs internal
     udhalcheck = 1;
 
     UDHAL_GPIO_init();              // GPIO --> single button
@@ -10,43 +10,60 @@
 #include <stdint.h>
 #include <ti/drivers/NVS.h>
 #include <ti/drivers/nvs/NVSCC26XX.h>
+#include <inc/hw_memmap.h>
+#include <driverlib/vims.h>
+#include <driverlib/flash.h>
 #include "Board.h"
 #include "UDHAL_NVSINT.h"
-#include "Application/dataAnalysis.h"
+#include "Application/writeBehind.h"
+#include "Application/blackBox.h"
 
 NVS_Handle nvsHandle;
 NVS_Attrs regionAttrs;
 NVS_Params nvsParams;
 
-uint8_t nvsOpenStatus = 0;
+uint8_t nvsOpenStatus = UDHAL_NVSINT_STATUS_CLOSED;
+
+// The layout must fit the region of the stock board file - UDHAL_NVSINT_open checks the actual region
+typedef char UDHAL_NVSINT_layoutCheck[(UDHAL_NVSINT_LAYOUT_END <= UDHAL_NVSINT_STOCK_REGION_SIZE) ? 1 : -1];
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
 static void UDHAL_NVSINT_open(void);
-static void UDHAL_NVSINT_erase(void);
-static void UDHAL_NVSINT_write(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
+static void UDHAL_NVSINT_erase(size_t nvsOffset);
+static void UDHAL_NVSINT_program(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
 static void UDHAL_NVSINT_read(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize);
 static void UDHAL_NVSINT_close(void);
+static void UDHAL_NVSINT_recordLogRead(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize);
+static void UDHAL_NVSINT_recordLogProgram(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
+static void UDHAL_NVSINT_recordLogErase(size_t nvsOffset);
+static void UDHAL_NVSINT_blackBoxRead(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize);
+static void UDHAL_NVSINT_blackBoxProgram(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
+static void UDHAL_NVSINT_blackBoxErase(size_t nvsOffset);
+static void UDHAL_NVSINT_blackBoxPanicProgram(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
 
 /*********************************************************************
  * Marco
  */
-///*
-static dataAnalysis_NVS_Manager_t nvsManager =
+static nvsLog_nvsManager_t recordLogNvsManager =
 {
-     UDHAL_NVSINT_open,
-     UDHAL_NVSINT_erase,
-     UDHAL_NVSINT_write,
-     UDHAL_NVSINT_read,
-     UDHAL_NVSINT_close
+     UDHAL_NVSINT_recordLogRead,
+     UDHAL_NVSINT_recordLogProgram,
+     UDHAL_NVSINT_recordLogErase
+};
+static blackBox_nvsManager_t blackBoxNvsManager =
+{
+     UDHAL_NVSINT_blackBoxRead,
+     UDHAL_NVSINT_blackBoxProgram,
+     UDHAL_NVSINT_blackBoxErase,
+     UDHAL_NVSINT_blackBoxPanicProgram
 };
-
-//*/
 /*********************************************************************
  * @fn      UDHAL_NVSINT_init
  *
- * @brief   It is used to initialize nvsinternal
+ * @brief   It is used to initialize nvsinternal.  The NVS functions are registered with the
+ *          modules once the region is open, see UDHAL_NVSINT_open.
  *
  * @param   None
  *
@@ -54,9 +71,7 @@ static dataAnalysis_NVS_Manager_t nvsManager =
  */
 void UDHAL_NVSINT_init()
 {
-    nvsOpenStatus = 1;
     NVS_init();
-    //dataAnalysis_registerNVSINT(&nvsManager);
 }
 
 /*********************************************************************
@@ -70,14 +85,17 @@ void UDHAL_NVSINT_init()
  */
 void UDHAL_NVSINT_params_init()
 {
-   // NVS_Params_init(&nvsParams);
-   // UDHAL_NVSINT_open();
+    NVS_Params_init(&nvsParams);
+    UDHAL_NVSINT_open();
 }
 
 /*********************************************************************
  * @fn      UDHAL_NVSINT_open
  *
- * @brief   It is used to open nvsinternal
+ * @brief   It is used to open nvsinternal and register the NVS functions of each area.  A region
+ *          smaller than the layout is closed again and nothing is registered, so the record log and
+ *          the black box run without storage instead of writing past the region;
+ *          UDHAL_NVSINT_getStatus tells why.
  *
  * @param   ptrnvsParams
  *
@@ -88,15 +106,36 @@ void UDHAL_NVSINT_open()
 {
     nvsHandle = NVS_open(Board_NVSINTERNAL, &nvsParams);
     if (nvsHandle == NULL) {
-        nvsOpenStatus = 0;
-    }
-    else {
-        nvsOpenStatus = 1;
+        nvsOpenStatus = UDHAL_NVSINT_STATUS_CLOSED;
+        return;
     }
     // Populate a NVS_Attrs structure with properties specific
     // to a NVS_Handle such as region base address, region size,
     // and sector size.
     NVS_getAttrs(nvsHandle, &regionAttrs);
+    if ((regionAttrs.regionSize < UDHAL_NVSINT_LAYOUT_END) || (regionAttrs.sectorSize != UDHAL_NVSINT_SECTOR_SIZE))
+    {
+        UDHAL_NVSINT_close();
+        nvsOpenStatus = UDHAL_NVSINT_STATUS_TOO_SMALL;
+        return;
+    }
+    nvsOpenStatus = UDHAL_NVSINT_STATUS_OPEN;
+    writeBehind_registerNVS(&recordLogNvsManager);
+    blackBox_registerNVS(&blackBoxNvsManager);
+}
+
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_getStatus
+ *
+ * @brief   It is used to tell whether the NVS areas are in use
+ *
+ * @param   None
+ *
+ * @return  UDHAL_NVSINT_STATUS_xxx
+ */
+uint8_t UDHAL_NVSINT_getStatus()
+{
+    return nvsOpenStatus;
 }
 
 /*********************************************************************
@@ -104,36 +143,38 @@ void UDHAL_NVSINT_open()
  *
  * @brief   It is used to erase nvsinternal sector
  *
- * @param   None
+ * @param   nvsOffset - offset of the sector
  *
  * @return  None
  */
 
-void UDHAL_NVSINT_erase()
+void UDHAL_NVSINT_erase(size_t nvsOffset)
 {
-    if (nvsOpenStatus == 1)
+    if (nvsOpenStatus == UDHAL_NVSINT_STATUS_OPEN)
     {
         // Erase the entire flash sector - Erase sets all bits to 1.
-        NVS_erase(nvsHandle, 0, regionAttrs.sectorSize);
+        NVS_erase(nvsHandle, nvsOffset, regionAttrs.sectorSize);
     }
 }
 
 /*********************************************************************
- * @fn      UDHAL_NVSINT_write
+ * @fn      UDHAL_NVSINT_program
  *
- * @brief   It is used to write to nvsinternal
+ * @brief   It is used to program erased nvsinternal flash, without erasing the sector
  *
- * @param   None
+ * @param   nvsOffset - offset in the region
+ *          ptrwriteBuffer - data
+ *          writeBufferSize - data size
  *
  * @return  None
  */
 
-void UDHAL_NVSINT_write(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
+void UDHAL_NVSINT_program(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
 {
-    if (nvsOpenStatus == 1)
+    if (nvsOpenStatus == UDHAL_NVSINT_STATUS_OPEN)
     {
         NVS_write(nvsHandle, nvsOffset, ptrwriteBuffer, writeBufferSize,
-                        NVS_WRITE_ERASE | NVS_WRITE_POST_VERIFY);
+                        NVS_WRITE_POST_VERIFY);
     }
 }
 
@@ -149,7 +190,7 @@ void UDHAL_NVSINT_write(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBuff
 
 void UDHAL_NVSINT_read(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize)
 {
-    if (nvsOpenStatus == 1)
+    if (nvsOpenStatus == UDHAL_NVSINT_STATUS_OPEN)
     {
         NVS_read(nvsHandle, nvsOffset, ptrreadBuffer, readBufferSize);
     }
@@ -169,3 +210,140 @@ void UDHAL_NVSINT_close()
     NVS_close(nvsHandle);
 }
 
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_areaRead
+ *
+ * @brief   It is used to read from a log area.
+ *          The buffer is filled with 0xFF (blank flash) if the data is outside the area or the region.
+ *
+ * @param   areaOffset - offset of the area in the region
+ *          areaSize - size of the area
+ *          nvsOffset - offset in the area
+ *          ptrreadBuffer - destination
+ *          readBufferSize - data size
+ *
+ * @return  None
+ */
+static void UDHAL_NVSINT_areaRead(size_t areaOffset, size_t areaSize, size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize)
+{
+    memset(ptrreadBuffer, 0xFF, readBufferSize);
+    if ((nvsOpenStatus == UDHAL_NVSINT_STATUS_OPEN) && (nvsOffset + readBufferSize <= areaSize) &&
+        (areaOffset + nvsOffset + readBufferSize <= regionAttrs.regionSize))
+    {
+        UDHAL_NVSINT_read(areaOffset + nvsOffset, ptrreadBuffer, readBufferSize);
+    }
+}
+
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_areaProgram
+ *
+ * @brief   It is used to program erased flash in a log area
+ *
+ * @param   areaOffset - offset of the area in the region
+ *          areaSize - size of the area
+ *          nvsOffset - offset in the area
+ *          ptrwriteBuffer - data
+ *          writeBufferSize - data size
+ *
+ * @return  None
+ */
+static void UDHAL_NVSINT_areaProgram(size_t areaOffset, size_t areaSize, size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
+{
+    if ((nvsOffset + writeBufferSize <= areaSize) &&
+        (areaOffset + nvsOffset + writeBufferSize <= regionAttrs.regionSize))
+    {
+        UDHAL_NVSINT_program(areaOffset + nvsOffset, ptrwriteBuffer, writeBufferSize);
+    }
+}
+
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_areaErase
+ *
+ * @brief   It is used to erase a sector of a log area
+ *
+ * @param   areaOffset - offset of the area in the region
+ *          areaSize - size of the area
+ *          nvsOffset - offset of the sector in the area
+ *
+ * @return  None
+ */
+static void UDHAL_NVSINT_areaErase(size_t areaOffset, size_t areaSize, size_t nvsOffset)
+{
+    if ((nvsOffset < areaSize) &&
+        (areaOffset + nvsOffset + UDHAL_NVSINT_SECTOR_SIZE <= regionAttrs.regionSize))
+    {
+        UDHAL_NVSINT_erase(areaOffset + nvsOffset);
+    }
+}
+
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_recordLogRead / Program / Erase
+ *
+ * @brief   Shared record log area access for writeBehind
+ */
+static void UDHAL_NVSINT_recordLogRead(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize)
+{
+    UDHAL_NVSINT_areaRead(UDHAL_NVSINT_RECORD_LOG_OFFSET, UDHAL_NVSINT_RECORD_LOG_SIZE, nvsOffset, ptrreadBuffer, readBufferSize);
+}
+static void UDHAL_NVSINT_recordLogProgram(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
+{
+    UDHAL_NVSINT_areaProgram(UDHAL_NVSINT_RECORD_LOG_OFFSET, UDHAL_NVSINT_RECORD_LOG_SIZE, nvsOffset, ptrwriteBuffer, writeBufferSize);
+}
+static void UDHAL_NVSINT_recordLogErase(size_t nvsOffset)
+{
+    UDHAL_NVSINT_areaErase(UDHAL_NVSINT_RECORD_LOG_OFFSET, UDHAL_NVSINT_RECORD_LOG_SIZE, nvsOffset);
+}
+
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_blackBoxRead / Program / Erase
+ *
+ * @brief   Black box area access for blackBox
+ */
+static void UDHAL_NVSINT_blackBoxRead(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize)
+{
+    UDHAL_NVSINT_areaRead(UDHAL_NVSINT_BLACK_BOX_OFFSET, UDHAL_NVSINT_BLACK_BOX_SIZE, nvsOffset, ptrreadBuffer, readBufferSize);
+}
+static void UDHAL_NVSINT_blackBoxProgram(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
+{
+    UDHAL_NVSINT_areaProgram(UDHAL_NVSINT_BLACK_BOX_OFFSET, UDHAL_NVSINT_BLACK_BOX_SIZE, nvsOffset, ptrwriteBuffer, writeBufferSize);
+}
+static void UDHAL_NVSINT_blackBoxErase(size_t nvsOffset)
+{
+    UDHAL_NVSINT_areaErase(UDHAL_NVSINT_BLACK_BOX_OFFSET, UDHAL_NVSINT_BLACK_BOX_SIZE, nvsOffset);
+}
+
+/*********************************************************************
+ * @fn      UDHAL_NVSINT_blackBoxPanicProgram
+ *
+ * @brief   It is used to program erased flash in the black box area from an assert or RTOS error
+ *          hook.  The NVS driver is not used: its lock may be held by the task that failed, and
+ *          the hook may run in an interrupt.  The flash cache is disabled while programming, as
+ *          the NVS driver does.
+ *
+ * @param   nvsOffset - offset in the area
+ *          ptrwriteBuffer - data
+ *          writeBufferSize - data size
+ *
+ * @return  None
+ */
+static void UDHAL_NVSINT_blackBoxPanicProgram(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
+{
+    uint32_t mode;
+    if ((nvsOpenStatus != UDHAL_NVSINT_STATUS_OPEN) || (nvsOffset + writeBufferSize > UDHAL_NVSINT_BLACK_BOX_SIZE) ||
+        (UDHAL_NVSINT_BLACK_BOX_OFFSET + nvsOffset + writeBufferSize > regionAttrs.regionSize))
+    {
+        return;
+    }
+    mode = VIMSModeGet(VIMS_BASE);
+    if (mode != VIMS_MODE_DISABLED)
+    {
+        VIMSModeSet(VIMS_BASE, VIMS_MODE_DISABLED);
+        while (VIMSModeGet(VIMS_BASE) != VIMS_MODE_DISABLED);
+    }
+    FlashProgram((uint8_t *) ptrwriteBuffer, (uint32_t) regionAttrs.regionBase + UDHAL_NVSINT_BLACK_BOX_OFFSET + nvsOffset,
+                 writeBufferSize);
+    if (mode != VIMS_MODE_DISABLED)
+    {
+        VIMSModeSet(VIMS_BASE, mode);
+    }
+}
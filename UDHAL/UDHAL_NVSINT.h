@@ -34,6 +34,20 @@ extern "C"
 /*********************************************************************
  * CONSTANTS
  */
+/* Internal NVS region layout.  Every record is appended to the shared record log, with a tag per owner; the logs
+ * only program erased flash and erase a sector when they wrap.  The layout fits the stock 4 sector region. */
+#define UDHAL_NVSINT_SECTOR_SIZE                0x1000
+#define UDHAL_NVSINT_STOCK_REGION_SIZE          0x4000      // Board_NVSINTERNAL region of the CC2640R2 board file
+#define UDHAL_NVSINT_RECORD_LOG_OFFSET          0x0000      // sectors 0 and 1: shared record log (writeBehind)
+#define UDHAL_NVSINT_RECORD_LOG_SIZE            (WRITE_BEHIND_SECTORS * UDHAL_NVSINT_SECTOR_SIZE)
+#define UDHAL_NVSINT_BLACK_BOX_OFFSET           0x2000      // sectors 2 and 3: blackBox ring
+#define UDHAL_NVSINT_BLACK_BOX_SIZE             (BLACK_BOX_SECTORS * UDHAL_NVSINT_SECTOR_SIZE)
+#define UDHAL_NVSINT_LAYOUT_END                 (UDHAL_NVSINT_BLACK_BOX_OFFSET + UDHAL_NVSINT_BLACK_BOX_SIZE)   // region size needed
+
+// UDHAL_NVSINT_getStatus
+#define UDHAL_NVSINT_STATUS_CLOSED              0x00        // not opened yet, or NVS_open failed
+#define UDHAL_NVSINT_STATUS_OPEN                0x01
+#define UDHAL_NVSINT_STATUS_TOO_SMALL           0x02        // region smaller than UDHAL_NVSINT_LAYOUT_END, or other sectors - closed, nothing is stored
 /*********************************************************************
  * MACROS
  */
@@ -43,6 +57,7 @@ extern "C"
 
 extern void UDHAL_NVSINT_init(void);
 extern void UDHAL_NVSINT_params_init(void);
+extern uint8_t UDHAL_NVSINT_getStatus(void);
 
 /*********************************************************************
 *********************************************************************/
@@ -15,6 +15,7 @@
 #include <stdint.h>
 #include <ti/drivers/UART.h>
 #include "STM32MCP/STM32MCP.h"
+#include "brakeLatency.h"
 #include "Board.h"
 /*********************************************************************
  * LOCAL VARIABLES
@@ -103,6 +104,7 @@ static void UDHAL_UART_open()
  */
 static void UDHAL_UART_write(uint8_t *message, uint8_t size)
 {
+    brakeLatency_markUartWrite(message);
     UART_write(UART_handle, message, size);
 }
 /*********************************************************************
@@ -0,0 +1,342 @@
+/******************************************************************************
+
+ @file  fixedPointTest.c
+
+ @brief Host tests of the fixedPoint.h helpers against exact integer or
+        double precision references: rounding, error bounds, saturation, the
+        exact range of the reciprocal division and the timer tick conversion.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <math.h>
+#include "fixedPoint.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define TEST_RANDOM_CASES               2000000
+
+#define CHECK(cond)     do { if (!(cond)) { printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; return; } } while (0)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int failures = 0;
+static uint64_t randomState = 0x2545F4914F6CDD1DULL;
+
+/*********************************************************************
+ * @fn      test_random
+ *
+ * @brief   xorshift64 - the same sequence on every run
+ */
+static uint64_t test_random( void )
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+/*********************************************************************
+ * @fn      test_roundHalfAway
+ *
+ * @brief   Exact reference: n / d rounded half away from zero, d > 0
+ */
+static int64_t test_roundHalfAway( int64_t n, int64_t d )
+{
+    int64_t q = n / d;
+    int64_t r = n % d;
+    if (2 * (r < 0 ? -r : r) >= d)
+    {
+        q += (n < 0) ? -1 : 1;
+    }
+    return q;
+}
+/*********************************************************************
+ * @fn      test_roundShift
+ */
+static void test_roundShift( void )
+{
+    uint32_t ii;
+    uint8_t  shift;
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        int64_t x = (int64_t) (test_random() >> 2) - ((int64_t) 1 << 61);
+        shift = (uint8_t) (1 + test_random() % 60);
+        CHECK(fixedPoint_roundShift(x, shift) == test_roundHalfAway(x, (int64_t) 1 << shift));
+    }
+    for (shift = 1; shift <= 16; shift++)                           // the ties
+    {
+        int64_t half = (int64_t) 1 << (shift - 1);
+        CHECK(fixedPoint_roundShift(half, shift) == 1);
+        CHECK(fixedPoint_roundShift(-half, shift) == -1);
+        CHECK(fixedPoint_roundShift(half - 1, shift) == 0);
+        CHECK(fixedPoint_roundShift(-half + 1, shift) == 0);
+    }
+}
+/*********************************************************************
+ * @fn      test_q16Mul
+ *
+ * @brief   Error <= 0.5 LSB inside the range, saturation outside it
+ */
+static void test_q16Mul( void )
+{
+    uint32_t ii;
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        q16_t a = (q16_t) test_random();
+        q16_t b = (q16_t) (test_random() >> (32 + test_random() % 32));
+        long double exact = (long double) a * b / 65536.0L;
+        q16_t p = fixedPoint_q16Mul(a, b);
+        if (exact > INT32_MAX)
+        {
+            CHECK(p == INT32_MAX);
+        }
+        else if (exact < INT32_MIN)
+        {
+            CHECK(p == INT32_MIN);
+        }
+        else
+        {
+            CHECK(fabsl((long double) p - exact) <= 0.5L);
+        }
+    }
+    CHECK(fixedPoint_q16Mul(FIXEDPOINT_Q16(1.5), FIXEDPOINT_Q16(-2.0)) == FIXEDPOINT_Q16(-3.0));
+    CHECK(fixedPoint_q16Mul(INT32_MIN, INT32_MIN) == INT32_MAX);
+}
+/*********************************************************************
+ * @fn      test_q16MulInt
+ *
+ * @brief   Error <= 0.5 against the Q16.16 factor, <= 0.5 + |x| 2^-17 against the real factor
+ */
+static void test_q16MulInt( void )
+{
+    static const double factors[] = {0.2156, 0.9, 3.6, 1.0 / 3.0, 27.77777};
+    uint32_t ii;
+    uint8_t  jj;
+    for (jj = 0; jj < sizeof(factors) / sizeof(factors[0]); jj++)
+    {
+        q16_t k = (q16_t) FIXEDPOINT_ROUND(factors[jj] * 65536.0);
+        for (ii = 0; ii < TEST_RANDOM_CASES / 8; ii++)
+        {
+            int32_t x = (int32_t) (test_random() >> (33 + jj));
+            x = (test_random() & 1) ? -x : x;
+            long double exact = (long double) x * factors[jj];
+            long double quantised = (long double) x * k / 65536.0L;
+            int32_t p = fixedPoint_q16MulInt(x, k);
+            if (fabsl(quantised) >= 2147483647.5L)
+            {
+                CHECK(p == ((quantised > 0) ? INT32_MAX : INT32_MIN));
+                continue;
+            }
+            CHECK(fabsl((long double) p - quantised) <= 0.5L);
+            CHECK(fabsl((long double) p - exact) <= 0.5L + fabsl((long double) x) / 131072.0L);
+        }
+    }
+}
+/*********************************************************************
+ * @fn      test_q15Mul
+ *
+ * @brief   Every product of two Q15 values that are a multiple of 3 LSB apart, and -1 x -1
+ */
+static void test_q15Mul( void )
+{
+    int32_t a;
+    int32_t b;
+    for (a = INT16_MIN; a <= INT16_MAX; a += 3)
+    {
+        for (b = INT16_MIN; b <= INT16_MAX; b += 97)
+        {
+            int64_t expected = test_roundHalfAway((int64_t) a * b, 32768);
+            if (expected > FIXEDPOINT_Q15_MAX)
+            {
+                expected = FIXEDPOINT_Q15_MAX;
+            }
+            CHECK(fixedPoint_q15Mul((q15_t) a, (q15_t) b) == expected);
+        }
+    }
+    CHECK(fixedPoint_q15Mul(INT16_MIN, INT16_MIN) == FIXEDPOINT_Q15_MAX);
+}
+/*********************************************************************
+ * @fn      test_divRecip
+ *
+ * @brief   floor(x / d) exactly while x * d < 2^32, at most 1 above it for any x
+ */
+static void test_divRecip( void )
+{
+    uint32_t ii;
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        uint32_t d = (uint32_t) (2 + test_random() % ((ii & 1) ? 100 : 0xFFFFFFFDULL));
+        uint32_t recip = FIXEDPOINT_RECIP32(d);
+        uint32_t x = (uint32_t) test_random();
+        uint32_t q = fixedPoint_divRecip(x, recip);
+        if ((uint64_t) x * d < 0x100000000ULL)
+        {
+            CHECK(q == x / d);
+        }
+        else
+        {
+            CHECK((q == x / d) || (q == x / d + 1));
+        }
+        x = (uint32_t) (0xFFFFFFFFUL / d);                          // largest exact dividend
+        CHECK(fixedPoint_divRecip(x, recip) == x / d);
+    }
+}
+/*********************************************************************
+ * @fn      test_windowRecip
+ *
+ * @brief   The window means of dataAnalysis_windowMean: truncated, sum x FIXEDPOINT_RECIP32(N), and
+ *          rounded, (2 x sum + N) x FIXEDPOINT_RECIP32(2N), equal the plain divisions for every sum up
+ *          to 65535 x N and at DATA_ANALYSIS_WINDOW_SUM_MAX, for window lengths 2 to 64
+ */
+static void test_windowRecip( void )
+{
+    uint32_t n;
+    uint32_t sum;
+    for (n = 2; n <= 64; n++)
+    {
+        uint32_t recip = FIXEDPOINT_RECIP32(n);
+        uint32_t recip2N = FIXEDPOINT_RECIP32(2 * n);
+        uint32_t sumMax = (0xFFFFFFFFUL / (4 * n)) - n;             // DATA_ANALYSIS_WINDOW_SUM_MAX
+        for (sum = 0; sum <= 65535 * n; sum++)
+        {
+            CHECK(fixedPoint_divRecip(sum, recip) == sum / n);
+            CHECK(fixedPoint_divRecip(2 * sum + n, recip2N) == (2 * sum + n) / (2 * n));
+        }
+        for (sum = sumMax - 4096; sum <= sumMax; sum++)
+        {
+            CHECK(fixedPoint_divRecip(sum, recip) == sum / n);
+            CHECK(fixedPoint_divRecip(2 * sum + n, recip2N) == (2 * sum + n) / (2 * n));
+        }
+    }
+}
+/*********************************************************************
+ * @fn      test_mulRecipRound
+ *
+ * @brief   Error <= 0.5 against the Q0.32 ratio, <= 0.5 + |x| 2^-33 against the real ratio
+ */
+static void test_mulRecipRound( void )
+{
+    uint32_t ii;
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        double ratio = (double) (test_random() >> 11) / 9007199254740992.0;            // [0, 1)
+        uint32_t r = (ratio * 4294967296.0 >= 4294967295.0) ? 0xFFFFFFFF : FIXEDPOINT_Q32(ratio);
+        int32_t x = (int32_t) test_random();
+        long double exact = (long double) x * ratio;
+        int32_t p = fixedPoint_mulRecipRound(x, r);
+        CHECK(p == test_roundHalfAway((int64_t) x * r, (int64_t) 1 << 32));
+        CHECK(fabsl((long double) p - exact) <= 0.5L + fabsl((long double) x) / 8589934592.0L + 1e-9L);
+    }
+}
+/*********************************************************************
+ * @fn      test_divRound
+ *
+ * @brief   Half up unsigned, half away from zero signed; every dividend up to 4095 and random ones
+ */
+static void test_divRound( void )
+{
+    uint32_t n;
+    uint32_t d;
+    uint32_t ii;
+    for (n = 0; n < 4096; n++)
+    {
+        for (d = 1; d < 256; d++)
+        {
+            CHECK(fixedPoint_divRound(n, d) == (uint32_t) test_roundHalfAway(n, d));
+            CHECK(fixedPoint_divRound(n, d) == (uint32_t) roundf((float) n / (float) d));
+            CHECK(fixedPoint_divRoundSigned(-(int32_t) n, (int32_t) d) == -(int32_t) test_roundHalfAway(n, d));
+        }
+    }
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        n = (uint32_t) test_random();
+        d = (uint32_t) (test_random() >> (32 + test_random() % 32));
+        d = (d == 0) ? 1 : d;
+        CHECK(fixedPoint_divRound(n, d) == (uint32_t) test_roundHalfAway(n, d));
+        CHECK(fixedPoint_divRoundSigned((int32_t) (n >> 1), (int32_t) (d >> 1 | 1)) ==
+              test_roundHalfAway((int64_t) (n >> 1), (int64_t) (d >> 1 | 1)));
+    }
+}
+/*********************************************************************
+ * @fn      test_ticksToUs
+ *
+ * @brief   Rounded down, exact at 1 MHz, 0 for an unknown frequency, saturated when the time in
+ *          micro-seconds does not fit 32 bits
+ */
+static void test_ticksToUs( void )
+{
+    static const uint32_t freqs[] = {32768, 65536, 1000000, 3000000, 24000000, 48000000};
+    uint32_t ii;
+    uint8_t ff;
+    CHECK(fixedPoint_ticksToUs(123456, 0) == 0);
+    CHECK(fixedPoint_ticksToUs(0xFFFFFFFF, 1000000) == 0xFFFFFFFF);
+    CHECK(fixedPoint_ticksToUs(48, 48000000) == 1);
+    CHECK(fixedPoint_ticksToUs(47, 48000000) == 0);
+    CHECK(fixedPoint_ticksToUs(0xFFFFFFFF, 65536) == 0xFFFFFFFF);
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        uint32_t ticks = (uint32_t) (test_random() >> (32 + test_random() % 32));
+        for (ff = 0; ff < sizeof(freqs) / sizeof(freqs[0]); ff++)
+        {
+            uint64_t us = ((uint64_t) ticks * 1000000) / freqs[ff];
+            CHECK(fixedPoint_ticksToUs(ticks, freqs[ff]) == ((us > 0xFFFFFFFF) ? 0xFFFFFFFF : us));
+        }
+    }
+}
+/*********************************************************************
+ * @fn      test_sqrt32
+ *
+ * @brief   floor(sqrt(x)) at every perfect square and its neighbours, and random values
+ */
+static void test_sqrt32( void )
+{
+    uint32_t r;
+    uint32_t ii;
+    for (r = 1; r <= 0xFFFF; r++)
+    {
+        uint32_t x = r * r;
+        CHECK(fixedPoint_sqrt32(x) == r);
+        CHECK(fixedPoint_sqrt32(x - 1) == r - 1);
+    }
+    CHECK(fixedPoint_sqrt32(0) == 0);
+    CHECK(fixedPoint_sqrt32(0xFFFFFFFF) == 0xFFFF);
+    for (ii = 0; ii < TEST_RANDOM_CASES; ii++)
+    {
+        uint32_t x = (uint32_t) test_random();
+        uint64_t root = fixedPoint_sqrt32(x);
+        CHECK((root * root <= x) && ((root + 1) * (root + 1) > x));
+    }
+}
+
+int main( void )
+{
+    static const struct
+    {
+        const char *name;
+        void (*fxn)(void);
+    }tests[] =
+    {
+        {"roundShift", test_roundShift},
+        {"q16Mul", test_q16Mul},
+        {"q16MulInt", test_q16MulInt},
+        {"q15Mul", test_q15Mul},
+        {"divRecip", test_divRecip},
+        {"windowRecip", test_windowRecip},
+        {"mulRecipRound", test_mulRecipRound},
+        {"divRound", test_divRound},
+        {"ticksToUs", test_ticksToUs},
+        {"sqrt32", test_sqrt32},
+    };
+    uint8_t ii;
+
+    for (ii = 0; ii < sizeof(tests) / sizeof(tests[0]); ii++)
+    {
+        int before = failures;
+        tests[ii].fxn();
+        printf("%-20s %s\n", tests[ii].name, (failures == before) ? "ok" : "FAILED");
+    }
+    return (failures == 0) ? 0 : 1;
+}
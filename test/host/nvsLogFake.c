@@ -0,0 +1,112 @@
+/******************************************************************************
+
+ @file  nvsLogFake.c
+
+ @brief This file contains the RAM backed flash used by the host tests.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <assert.h>
+#include "nvsLogFake.h"
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int32_t bytesLeft = NVS_LOG_FAKE_NEVER;              // bytes programmed before the power loss
+
+/**********************************************************************
+ *  Local functions
+ */
+static void nvsLogFake_read(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize);
+static void nvsLogFake_program(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize);
+static void nvsLogFake_erase(size_t nvsOffset);
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+nvsLog_nvsManager_t nvsLogFake_nvsManager =
+{
+     nvsLogFake_read,
+     nvsLogFake_program,
+     nvsLogFake_erase
+};
+uint8_t nvsLogFake_flash[NVS_LOG_FAKE_SIZE];
+uint32_t nvsLogFake_erases = 0;
+uint32_t nvsLogFake_programmed = 0;
+
+/*********************************************************************
+ * @fn      nvsLogFake_blank
+ *
+ * @brief   Erase the whole fake flash, clear the counters and the power loss
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void nvsLogFake_blank( void )
+{
+    memset(nvsLogFake_flash, 0xFF, sizeof(nvsLogFake_flash));
+    nvsLogFake_erases = 0;
+    nvsLogFake_programmed = 0;
+    bytesLeft = NVS_LOG_FAKE_NEVER;
+}
+/*********************************************************************
+ * @fn      nvsLogFake_failAfter
+ *
+ * @brief   Lose the power after the given number of bytes programmed: the rest of that program
+ *          and every later one leave the flash unchanged
+ *
+ * @param   bytes - bytes still programmed, NVS_LOG_FAKE_NEVER to restore the power
+ *
+ * @return  none
+ */
+void nvsLogFake_failAfter( int32_t bytes )
+{
+    bytesLeft = bytes;
+}
+/*********************************************************************
+ * @fn      nvsLogFake_read
+ */
+static void nvsLogFake_read(size_t nvsOffset, void *ptrreadBuffer, size_t readBufferSize)
+{
+    assert(nvsOffset + readBufferSize <= NVS_LOG_FAKE_SIZE);
+    memcpy(ptrreadBuffer, &nvsLogFake_flash[nvsOffset], readBufferSize);
+}
+/*********************************************************************
+ * @fn      nvsLogFake_program
+ */
+static void nvsLogFake_program(size_t nvsOffset, void *ptrwriteBuffer, size_t writeBufferSize)
+{
+    const uint8_t *data = (const uint8_t *) ptrwriteBuffer;
+    size_t ii;
+    assert(nvsOffset + writeBufferSize <= NVS_LOG_FAKE_SIZE);
+    for (ii = 0; ii < writeBufferSize; ii++)
+    {
+        if (bytesLeft == 0)
+        {
+            return;
+        }
+        if (bytesLeft > 0)
+        {
+            bytesLeft--;
+        }
+        nvsLogFake_flash[nvsOffset + ii] &= data[ii];       // a program only clears bits
+        nvsLogFake_programmed++;
+    }
+}
+/*********************************************************************
+ * @fn      nvsLogFake_erase
+ */
+static void nvsLogFake_erase(size_t nvsOffset)
+{
+    assert((nvsOffset % NVS_LOG_SECTOR_SIZE) == 0);
+    assert(nvsOffset < NVS_LOG_FAKE_SIZE);
+    if (bytesLeft == 0)
+    {
+        return;
+    }
+    memset(&nvsLogFake_flash[nvsOffset], 0xFF, NVS_LOG_SECTOR_SIZE);
+    nvsLogFake_erases++;
+}
@@ -0,0 +1,54 @@
+/**********************************************************************************************
+ * nvsLogFake.h
+ *
+ * Description:    RAM backed NVS manager for host tests of nvsLog and the modules built on it.
+ *
+ *                 Flash behaviour is kept: an erase sets a whole sector to 0xFF, a program can
+ *                 only clear bits.  A power loss is injected with nvsLogFake_failAfter: the
+ *                 programs stop after the given number of bytes, leaving a torn record behind.
+ *
+ **********************************************************************************************/
+
+#ifndef TEST_HOST_NVSLOGFAKE_H_
+#define TEST_HOST_NVSLOGFAKE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include "nvsLog.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define NVS_LOG_FAKE_SECTORS            4
+#define NVS_LOG_FAKE_SIZE               (NVS_LOG_FAKE_SECTORS * NVS_LOG_SECTOR_SIZE)
+#define NVS_LOG_FAKE_NEVER              (-1)            // nvsLogFake_failAfter: no power loss
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+extern nvsLog_nvsManager_t nvsLogFake_nvsManager;
+extern uint8_t nvsLogFake_flash[NVS_LOG_FAKE_SIZE];
+extern uint32_t nvsLogFake_erases;
+extern uint32_t nvsLogFake_programmed;                  // bytes programmed
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+extern void nvsLogFake_blank( void );
+extern void nvsLogFake_failAfter( int32_t bytes );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEST_HOST_NVSLOGFAKE_H_ */
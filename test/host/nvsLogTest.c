@@ -0,0 +1,335 @@
+/******************************************************************************
+
+ @file  nvsLogTest.c
+
+ @brief Host tests of nvsLog on the RAM backed flash: wrap around, power loss
+        in the middle of a record, CRC rejection and sequence number rollover.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <string.h>
+#include "nvsLog.h"
+#include "nvsLogFake.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define TEST_SECTORS                    2
+#define TEST_TAG_DATA                   0
+#define TEST_TAG_ONCE                   2
+#define TEST_TAG_OTHER                  3
+#define TEST_RECORDS                    200             // a little over three sectors of test records
+#define TEST_RECORDS_PER_SECTOR         ((NVS_LOG_SECTOR_SIZE - sizeof(nvsLog_sectorHeader_t)) / NVS_LOG_RECORD_SIZE(sizeof(testRecord_t)))
+
+#define CHECK(cond)     do { if (!(cond)) { printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+    uint32_t value;
+    uint8_t  fill[56];
+}testRecord_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int failures = 0;
+static nvsLog_t testLog;
+
+/*********************************************************************
+ * @fn      testLog_powerCycle
+ *
+ * @brief   Mount the log again, as at power on
+ */
+static void testLog_powerCycle( void )
+{
+    memset(&testLog, 0xA5, sizeof(testLog));
+    nvsLog_init(&testLog, &nvsLogFake_nvsManager, TEST_SECTORS);
+}
+/*********************************************************************
+ * @fn      testLog_append
+ *
+ * @brief   Append a test record holding value
+ */
+static uint8_t testLog_append( uint8_t tag, uint32_t value )
+{
+    testRecord_t record;
+    memset(&record, (uint8_t) value, sizeof(record));
+    record.value = value;
+    return nvsLog_append(&testLog, tag, &record, sizeof(record));
+}
+/*********************************************************************
+ * @fn      testLog_latest
+ *
+ * @brief   Value of the newest record of a tag, 0xFFFFFFFF if there is none
+ */
+static uint32_t testLog_latest( uint8_t tag )
+{
+    testRecord_t record;
+    if (nvsLog_readLatest(&testLog, tag, &record, sizeof(record)) != sizeof(record))
+    {
+        return 0xFFFFFFFF;
+    }
+    return record.value;
+}
+/*********************************************************************
+ * @fn      testLog_stream
+ *
+ * @brief   Read every record oldest first into values, check that each record reads back whole
+ *          and that the sequence numbers follow each other
+ *
+ * @return  number of records read
+ */
+static uint16_t testLog_stream( uint32_t *values, uint16_t maxValues )
+{
+    nvsLog_cursor_t cursor;
+    testRecord_t record;
+    testRecord_t expected;
+    uint32_t previousSequence = 0;
+    uint16_t count = 0;
+
+    nvsLog_readFirst(&testLog, &cursor);
+    while (nvsLog_readNext(&testLog, &cursor, &record, sizeof(record)) == 1)
+    {
+        CHECK(cursor.length == sizeof(record));
+        memset(&expected, (uint8_t) record.value, sizeof(expected));
+        expected.value = record.value;
+        CHECK(memcmp(&record, &expected, sizeof(record)) == 0);
+        if (count > 0)
+        {
+            CHECK(cursor.sequence == previousSequence + 1);
+        }
+        previousSequence = cursor.sequence;
+        if (count < maxValues)
+        {
+            values[count] = record.value;
+        }
+        count++;
+    }
+    return count;
+}
+/*********************************************************************
+ * @fn      test_wrap
+ *
+ * @brief   Append over three sectors: the oldest sector is erased each time the log wraps onto it,
+ *          a record left there is reported expiring before it is lost, and a power on finds the
+ *          newest records and carries on the sequence
+ */
+static void test_wrap( void )
+{
+    nvsLog_sectorHeader_t sectorHeader;
+    uint32_t values[TEST_RECORDS];
+    uint32_t eraseCounts = 0;
+    uint8_t  onceExpired = 0;
+    uint16_t count;
+    uint16_t ii;
+    uint8_t  sector;
+
+    nvsLogFake_blank();
+    testLog_powerCycle();
+    CHECK(testLog_latest(TEST_TAG_DATA) == 0xFFFFFFFF);
+    CHECK(testLog_append(TEST_TAG_ONCE, 1000) == 1);
+    for (ii = 0; ii < TEST_RECORDS; ii++)
+    {
+        if (nvsLog_isExpiring(&testLog, TEST_TAG_ONCE) == 1)
+        {
+            onceExpired = 1;
+            CHECK(testLog_latest(TEST_TAG_ONCE) == 1000);          // still readable until the sector is erased
+        }
+        CHECK(testLog_append(TEST_TAG_DATA, ii) == 1);
+    }
+    CHECK(onceExpired == 1);
+    CHECK(testLog_latest(TEST_TAG_ONCE) == 0xFFFFFFFF);
+    CHECK(testLog_latest(TEST_TAG_DATA) == TEST_RECORDS - 1);
+
+    testLog_powerCycle();
+    CHECK(testLog_latest(TEST_TAG_DATA) == TEST_RECORDS - 1);
+    CHECK(testLog_latest(TEST_TAG_ONCE) == 0xFFFFFFFF);
+    CHECK(testLog.sequence == TEST_RECORDS + 1);
+    count = testLog_stream(values, TEST_RECORDS);
+    CHECK(count > TEST_RECORDS_PER_SECTOR);                         // at least the whole older sector
+    CHECK(count <= 2 * TEST_RECORDS_PER_SECTOR);
+    for (ii = 0; (ii < count) && (ii < TEST_RECORDS); ii++)
+    {
+        CHECK(values[ii] == (uint32_t) (TEST_RECORDS - count + ii));
+    }
+
+    for (sector = 0; sector < TEST_SECTORS; sector++)
+    {
+        memcpy(&sectorHeader, &nvsLogFake_flash[sector * NVS_LOG_SECTOR_SIZE], sizeof(sectorHeader));
+        CHECK(sectorHeader.magic == NVS_LOG_MAGIC);
+        eraseCounts += sectorHeader.eraseCount;
+    }
+    CHECK(eraseCounts == nvsLogFake_erases);
+    CHECK(nvsLogFake_erases == (TEST_RECORDS + 1 + TEST_RECORDS_PER_SECTOR - 1) / TEST_RECORDS_PER_SECTOR);
+}
+/*********************************************************************
+ * @fn      test_reserve
+ *
+ * @brief   An erase made ahead by nvsLog_reserve leaves the next append a program only, also across a
+ *          power on
+ */
+static void test_reserve( void )
+{
+    uint32_t erases;
+    uint16_t ii;
+
+    nvsLogFake_blank();
+    testLog_powerCycle();
+    for (ii = 0; ii < TEST_RECORDS_PER_SECTOR; ii++)
+    {
+        CHECK(testLog_append(TEST_TAG_DATA, ii) == 1);
+    }
+    CHECK(nvsLog_hasRoom(&testLog, sizeof(testRecord_t)) == 0);
+    erases = nvsLogFake_erases;
+    CHECK(nvsLog_reserve(&testLog, sizeof(testRecord_t)) == 1);
+    CHECK(nvsLogFake_erases == erases + 1);
+    CHECK(nvsLog_reserve(&testLog, sizeof(testRecord_t)) == 0);
+
+    testLog_powerCycle();                                           // the empty, formatted sector takes the next record
+    CHECK(nvsLog_hasRoom(&testLog, sizeof(testRecord_t)) == 1);
+    CHECK(testLog_append(TEST_TAG_DATA, ii) == 1);
+    CHECK(nvsLogFake_erases == erases + 1);
+    CHECK(testLog_latest(TEST_TAG_DATA) == ii);
+}
+/*********************************************************************
+ * @fn      test_powerLoss
+ *
+ * @brief   Lose the power part way through a record: before it, in its header and in its data.
+ *          The torn record is never returned, the record before it is, and the next append
+ *          starts after it without mixing with it.
+ */
+static void test_powerLoss( void )
+{
+    static const int32_t cuts[] = {0, 1, 3, 6, sizeof(nvsLog_recordHeader_t), sizeof(nvsLog_recordHeader_t) + 5,
+                                   NVS_LOG_RECORD_SIZE(sizeof(testRecord_t)) - 1};
+    uint32_t values[8];
+    uint16_t firstOffset;
+    uint16_t count;
+    uint8_t  ii;
+
+    for (ii = 0; ii < sizeof(cuts) / sizeof(cuts[0]); ii++)
+    {
+        nvsLogFake_blank();
+        testLog_powerCycle();
+        CHECK(testLog_append(TEST_TAG_DATA, 1) == 1);
+        CHECK(testLog_append(TEST_TAG_OTHER, 7) == 1);
+        firstOffset = testLog.latest[TEST_TAG_DATA];
+
+        nvsLogFake_failAfter(cuts[ii]);
+        testLog_append(TEST_TAG_DATA, 2);
+        nvsLogFake_failAfter(NVS_LOG_FAKE_NEVER);
+
+        testLog_powerCycle();
+        CHECK(testLog_latest(TEST_TAG_DATA) == 1);
+        CHECK(testLog_latest(TEST_TAG_OTHER) == 7);
+        CHECK(testLog_append(TEST_TAG_DATA, 3) == 1);
+        if (cuts[ii] > 0)
+        {
+            CHECK(testLog.latest[TEST_TAG_DATA] / NVS_LOG_SECTOR_SIZE != firstOffset / NVS_LOG_SECTOR_SIZE);
+        }
+
+        testLog_powerCycle();
+        CHECK(testLog_latest(TEST_TAG_DATA) == 3);
+        CHECK(testLog_latest(TEST_TAG_OTHER) == 7);
+        count = testLog_stream(values, 8);
+        CHECK(count == 3);
+        CHECK((values[0] == 1) && (values[1] == 7) && (values[2] == 3));
+        CHECK(testLog.sequence == 3);                               // the torn record never counted
+    }
+}
+/*********************************************************************
+ * @fn      test_crcReject
+ *
+ * @brief   A bit error in the data or in the header of a record: the record is rejected, and with it
+ *          the rest of its sector
+ */
+static void test_crcReject( void )
+{
+    static const uint8_t flipAt[] = {sizeof(nvsLog_recordHeader_t) + 10, 5};      // data byte, sequence byte
+    uint32_t values[8];
+    uint16_t offset;
+    uint8_t  ii;
+
+    for (ii = 0; ii < sizeof(flipAt); ii++)
+    {
+        nvsLogFake_blank();
+        testLog_powerCycle();
+        CHECK(testLog_append(TEST_TAG_DATA, 1) == 1);
+        CHECK(testLog_append(TEST_TAG_DATA, 2) == 1);
+        offset = testLog.latest[TEST_TAG_DATA];
+        CHECK(testLog_append(TEST_TAG_OTHER, 9) == 1);
+        nvsLogFake_flash[offset + flipAt[ii]] ^= 0x04;
+
+        testLog_powerCycle();
+        CHECK(testLog_latest(TEST_TAG_DATA) == 1);
+        CHECK(testLog_latest(TEST_TAG_OTHER) == 0xFFFFFFFF);
+        CHECK(testLog_stream(values, 8) == 1);
+        CHECK(values[0] == 1);
+        CHECK(testLog_append(TEST_TAG_DATA, 4) == 1);
+        testLog_powerCycle();
+        CHECK(testLog_latest(TEST_TAG_DATA) == 4);
+    }
+}
+/*********************************************************************
+ * @fn      test_sequenceRollover
+ *
+ * @brief   Sequence numbers wrapping from 0xFFFFFFFF to 0: the newest sector and the next number are
+ *          still found at every power on
+ */
+static void test_sequenceRollover( void )
+{
+    const uint32_t start = 0xFFFFFFFF - TEST_RECORDS_PER_SECTOR - 10;
+    uint32_t values[TEST_RECORDS];
+    uint16_t count;
+    uint16_t ii;
+
+    nvsLogFake_blank();
+    testLog_powerCycle();
+    testLog.sequence = start;
+    for (ii = 0; ii < TEST_RECORDS; ii++)
+    {
+        CHECK(testLog_append(TEST_TAG_DATA, ii) == 1);
+        if ((ii % 16) == 15)
+        {
+            testLog_powerCycle();
+            CHECK(testLog_latest(TEST_TAG_DATA) == ii);
+            CHECK(testLog.sequence == (uint32_t) (start + ii + 1));
+        }
+    }
+    testLog_powerCycle();
+    CHECK(testLog_latest(TEST_TAG_DATA) == TEST_RECORDS - 1);
+    CHECK(testLog.sequence == (uint32_t) (start + TEST_RECORDS));
+    count = testLog_stream(values, TEST_RECORDS);
+    CHECK(count > TEST_RECORDS_PER_SECTOR);
+    CHECK(values[count - 1] == TEST_RECORDS - 1);
+}
+
+int main( void )
+{
+    static const struct
+    {
+        const char *name;
+        void (*fxn)(void);
+    }tests[] =
+    {
+        {"wrap", test_wrap},
+        {"reserve", test_reserve},
+        {"powerLoss", test_powerLoss},
+        {"crcReject", test_crcReject},
+        {"sequenceRollover", test_sequenceRollover},
+    };
+    uint8_t ii;
+
+    for (ii = 0; ii < sizeof(tests) / sizeof(tests[0]); ii++)
+    {
+        int before = failures;
+        tests[ii].fxn();
+        printf("%-20s %s\n", tests[ii].name, (failures == before) ? "ok" : "FAILED");
+    }
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/******************************************************************************
+
+ @file  writeBehindTest.c
+
+ @brief Host tests of the write behind cache on the RAM backed flash: the
+        power off commit only programs, the erase ahead waits for its pacing
+        step, and the newest record of every entry survives the log wrapping.
+
+ *****************************************************************************/
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdio.h>
+#include <string.h>
+#include "writeBehind.h"
+#include "nvsJob.h"
+#include "nvsLogFake.h"
+/*********************************************************************
+ * CONSTANTS
+ */
+#define TEST_STEPS                      6000            // analytics samples, the log wraps about 20 times
+#define TEST_POWER_OFF_PERIOD           97              // samples between power offs
+#define TEST_LENGTH_MAX                 392
+
+#define CHECK(cond)     do { if (!(cond)) { printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int failures = 0;
+static uint8_t claimAllowed = 1;
+static uint32_t claims = 0;
+static uint32_t blockErases = 0;                    // erases made between nvsJob_blockStart and nvsJob_blockEnd
+static uint32_t blockStartErases = 0;
+static uint8_t inBlock = 0;
+
+// Longest records of the entries registered by the application
+static const uint16_t testMaxLength[WRITE_BEHIND_ENTRIES] = {136, 28, 80, 32, 324, 236, 392};
+static uint8_t testData[WRITE_BEHIND_ENTRIES][TEST_LENGTH_MAX];
+static uint8_t testGeneration[WRITE_BEHIND_ENTRIES];
+static writeBehind_entry_t testEntry[WRITE_BEHIND_ENTRIES];
+
+/*********************************************************************
+ * nvsJob stubs: the pacing is controlled by the test, the blocking
+ * window is checked to cover every erase
+ */
+uint8_t nvsJob_claimStep( void )
+{
+    claims++;
+    return claimAllowed;
+}
+void nvsJob_blockStart( void )
+{
+    inBlock = 1;
+    blockStartErases = nvsLogFake_erases;
+}
+void nvsJob_blockEnd( void )
+{
+    inBlock = 0;
+    blockErases += nvsLogFake_erases - blockStartErases;
+}
+
+/*********************************************************************
+ * @fn      testEntry_fill
+ *
+ * @brief   Write a new value to the record of an entry in RAM
+ */
+static void testEntry_fill( uint8_t ii )
+{
+    uint16_t jj;
+    testGeneration[ii]++;
+    for (jj = 0; jj < testEntry[ii].length; jj++)
+    {
+        testData[ii][jj] = (uint8_t) (ii * 31 + testGeneration[ii] * 7 + jj);
+    }
+}
+/*********************************************************************
+ * @fn      testEntry_update
+ *
+ * @brief   Change the record of an entry in RAM and mark it dirty
+ */
+static void testEntry_update( uint8_t ii )
+{
+    testEntry_fill(ii);
+    writeBehind_markDirty(&testEntry[ii]);
+}
+/*********************************************************************
+ * @fn      testEntry_isSaved
+ *
+ * @brief   Whether the newest record of an entry in flash is its record in RAM
+ */
+static uint8_t testEntry_isSaved( uint8_t ii )
+{
+    uint8_t record[TEST_LENGTH_MAX];
+    uint16_t length = nvsLog_readLatest(writeBehind_getLog(), testEntry[ii].tag, record, sizeof(record));
+    return ((length == testEntry[ii].length) && (memcmp(record, testData[ii], length) == 0)) ? 1 : 0;
+}
+/*********************************************************************
+ * @fn      testEntry_sample
+ *
+ * @brief   One analytics sample: the entries are updated at different rates, then the cache
+ *          makes at most one flash operation
+ */
+static void testEntry_sample( uint32_t step )
+{
+    testEntry_update(2);                                        // snapshot, every sample
+    if ((step % 16) == 0)
+    {
+        testEntry_update(0);
+    }
+    if ((step % 53) == 0)
+    {
+        testEntry_update(4);
+    }
+    if ((step % 211) == 0)
+    {
+        testEntry_update(6);
+    }
+    writeBehind_taskFxn();
+}
+
+/*********************************************************************
+ * @fn      test_commitOnlyPrograms
+ *
+ * @brief   Ride with a power off every few samples: the commit writes every dirty record without an
+ *          erase, and after a power on the newest record of each entry, including those never
+ *          updated while riding, is the one in RAM
+ */
+static void test_commitOnlyPrograms( void )
+{
+    uint32_t step;
+    uint32_t powerOffs = 0;
+    uint32_t erases;
+    uint32_t programmed;
+    uint8_t ii;
+
+    for (step = 1; step <= TEST_STEPS; step++)
+    {
+        testEntry_sample(step);
+        if ((step % TEST_POWER_OFF_PERIOD) == 0)
+        {
+            for (ii = 0; ii < WRITE_BEHIND_ENTRIES; ii++)
+            {
+                testEntry_update(ii);
+            }
+            erases = nvsLogFake_erases;
+            programmed = nvsLogFake_programmed;
+            writeBehind_requestCommit();
+            writeBehind_taskFxn();
+            CHECK(nvsLogFake_erases == erases);
+            CHECK(nvsLogFake_programmed > programmed);
+            writeBehind_init();                                 // power on
+            for (ii = 0; ii < WRITE_BEHIND_ENTRIES; ii++)
+            {
+                CHECK(testEntry[ii].dirty == 0);
+                CHECK(testEntry_isSaved(ii) == 1);
+            }
+            powerOffs++;
+        }
+    }
+    CHECK(powerOffs == TEST_STEPS / TEST_POWER_OFF_PERIOD);
+    CHECK(nvsLogFake_erases > 2 * WRITE_BEHIND_SECTORS);
+    CHECK(nvsLogFake_erases == blockErases);
+}
+/*********************************************************************
+ * @fn      test_erasePaced
+ *
+ * @brief   When the sector is short of room for every entry, nothing is written until the pacing
+ *          allows the erase ahead; the erase is then the only operation of the sample
+ */
+static void test_erasePaced( void )
+{
+    uint32_t step = 1;
+    uint32_t erases;
+    uint32_t programmed;
+    uint8_t ii;
+
+    claimAllowed = 0;
+    claims = 0;
+    while ((claims == 0) && (step < TEST_STEPS))             // until the sector is short of room
+    {
+        testEntry_sample(step++);
+    }
+    CHECK(claims == 1);
+    erases = nvsLogFake_erases;
+    programmed = nvsLogFake_programmed;
+    for (ii = 0; ii < 10; ii++)
+    {
+        testEntry_sample(step++);
+    }
+    CHECK(claims == 11);
+    CHECK(nvsLogFake_erases == erases);
+    CHECK(nvsLogFake_programmed == programmed);
+
+    claimAllowed = 1;
+    writeBehind_taskFxn();
+    CHECK(nvsLogFake_erases == erases + 1);
+    CHECK(inBlock == 0);
+    CHECK(nvsLogFake_erases == blockErases);
+
+    writeBehind_requestCommit();
+    writeBehind_taskFxn();
+    CHECK(nvsLogFake_erases == erases + 1);
+    writeBehind_init();
+    for (ii = 0; ii < WRITE_BEHIND_ENTRIES; ii++)
+    {
+        CHECK(testEntry_isSaved(ii) == 1);
+    }
+}
+
+int main( void )
+{
+    static const struct
+    {
+        const char *name;
+        void (*fxn)(void);
+    }tests[] =
+    {
+        {"commitOnlyPrograms", test_commitOnlyPrograms},
+        {"erasePaced", test_erasePaced},
+    };
+    uint8_t ii;
+
+    nvsLogFake_blank();
+    writeBehind_registerNVS(&nvsLogFake_nvsManager);
+    writeBehind_init();
+    for (ii = 0; ii < WRITE_BEHIND_ENTRIES; ii++)
+    {
+        testEntry[ii].tag = ii;
+        testEntry[ii].data = testData[ii];
+        testEntry[ii].length = testMaxLength[ii];
+        testEntry[ii].maxLength = testMaxLength[ii];
+        testEntry[ii].carry = NULL;
+        if (writeBehind_register(&testEntry[ii]) != 1)
+        {
+            printf("register %d FAILED\n", ii);
+            return 1;
+        }
+        testEntry_update(ii);
+    }
+    nvsLogFake_erases = 0;                                  // the format at first mount is not paced
+    blockErases = 0;
+
+    for (ii = 0; ii < sizeof(tests) / sizeof(tests[0]); ii++)
+    {
+        int before = failures;
+        tests[ii].fxn();
+        printf("%-20s %s\n", tests[ii].name, (failures == before) ? "ok" : "FAILED");
+    }
+    return (failures == 0) ? 0 : 1;
+}